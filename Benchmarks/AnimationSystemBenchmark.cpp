@@ -0,0 +1,296 @@
+#include "AnimatedSprite.h"
+#include "AnimationSystem.h"
+#include "Benchmark.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+//Compares per-object AnimatedSprite::update() against AnimationSystem::update() for crowds of animated sprites,
+//the single-threaded AnimationSystem::update() against the ThreadPool version, and fine against coarse time steps
+//for animations with variable frame durations.  Finally, measures an update where most sprites are dormant.  Also
+//checks that callbacks may re-animate and remove their own sprite.
+namespace
+{
+    const int sNumObjects = 16;
+    const int sNumAnimationsPerObject = 4;
+    const int sNumFrames = 60;
+    const sf::Time sDeltaTime = sf::microseconds(16667);
+
+
+    void buildAnimations()
+    {
+        AnimatedSprite::sAnimations.clear();
+        AnimatedSprite::sFrameDurations.clear();
+        for(int object = 0; object < sNumObjects; ++object)
+        {
+            AnimatedSprite::AnimationSequenceSet sequenceSet;
+            AnimatedSprite::FrameDurationSet durationSet;
+            for(int animation = 0; animation < sNumAnimationsPerObject; ++animation)
+            {
+                AnimatedSprite::AnimationSequence sequence;
+                AnimatedSprite::FrameDurations durations;
+                for(int frame = 0; frame < 4 + (object + animation) % 9; ++frame)
+                {
+                    sequence.push_back(sf::IntRect(frame * 32, animation * 32, 32, 32));
+                    durations.push_back(sf::milliseconds(30 + (object * 7 + frame * 13) % 90));
+                }
+                sequenceSet.push_back(sequence);
+                durationSet.push_back(durations);
+            }
+            AnimatedSprite::sAnimations.push_back(sequenceSet);
+            AnimatedSprite::sFrameDurations.push_back(durationSet);
+        }
+        AnimatedSprite::sAnimationTable.build(AnimatedSprite::sAnimations, AnimatedSprite::sFrameDurations);
+    }
+
+
+    //Spread the frame rates so that only a fraction of the sprites change frame on any given update.
+    sf::Time timePerFrame(int sprite)
+    {
+        return sf::milliseconds(40 + sprite % 7 * 15);
+    }
+
+
+    //Returns false on a mismatch.
+    bool benchmarkSpriteCount(int numSprites)
+    {
+        unsigned numCallbacks = 0;
+        auto callback = [&numCallbacks](){ ++numCallbacks; };
+
+        std::vector<AnimatedSprite> sprites;
+        sprites.reserve(numSprites);
+        AnimationSystem system;
+        system.reserve(numSprites);
+        for(int i = 0; i < numSprites; ++i)
+        {
+            sprites.emplace_back(i % sNumObjects);
+            sprites.back().setContinuouslyLoopingAnimation(i % sNumAnimationsPerObject, timePerFrame(i), AnimatedSprite::EachLoopEnd, callback);
+            AnimationSystem::SpriteId id = system.addSprite(i % sNumObjects);
+            system.setContinuouslyLoopingAnimation(id, i % sNumAnimationsPerObject, timePerFrame(i), AnimatedSprite::EachLoopEnd, callback);
+        }
+
+        std::string suffix = " (" + std::to_string(numSprites) + " sprites)";
+        benchmark::print(benchmark::measure("AnimatedSprite::update" + suffix, sNumFrames, [&]()
+        {
+            for(auto& sprite : sprites)
+                sprite.update(sDeltaTime);
+        }));
+        benchmark::print(benchmark::measure("AnimationSystem::update" + suffix, sNumFrames, [&]()
+        {
+            system.update(sDeltaTime);
+        }));
+
+        //Both paths were advanced by the same number of frames, so they must agree.
+        for(int i = 0; i < numSprites; ++i)
+        {
+            if(sprites[i].getTextureRect() != system.getTextureRect(i))
+            {
+                std::printf("Mismatch between AnimatedSprite and AnimationSystem for sprite %d\n", i);
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    //Finite loop counts so that loop-end and completion callbacks are both exercised.
+    void populate(AnimationSystem& system, int numSprites, std::vector<AnimationSystem::SpriteId>& callbackLog)
+    {
+        system.reserve(numSprites);
+        for(int i = 0; i < numSprites; ++i)
+        {
+            AnimationSystem::SpriteId id = system.addSprite(i % sNumObjects);
+            system.setAnimation(id, i % sNumAnimationsPerObject, timePerFrame(i), 1 + i % 5, 
+                                AnimatedSprite::CallbackConditions(AnimatedSprite::EachLoopEnd | AnimatedSprite::AnimationCompletion),
+                                [&callbackLog, id](){ callbackLog.push_back(id); });
+        }
+    }
+
+
+    //Returns false on a mismatch.
+    bool benchmarkThreadCount(int numSprites, unsigned numThreads)
+    {
+        std::vector<AnimationSystem::SpriteId> serialLog;
+        std::vector<AnimationSystem::SpriteId> parallelLog;
+        AnimationSystem serialSystem;
+        AnimationSystem parallelSystem;
+        populate(serialSystem, numSprites, serialLog);
+        populate(parallelSystem, numSprites, parallelLog);
+        ThreadPool threadPool(numThreads);
+
+        std::string suffix = " (" + std::to_string(numSprites) + " sprites, " + std::to_string(numThreads + 1) + " threads)";
+        benchmark::print(benchmark::measure("AnimationSystem::update serial" + suffix, sNumFrames, [&]()
+        {
+            serialSystem.update(sDeltaTime);
+        }));
+        benchmark::print(benchmark::measure("AnimationSystem::update parallel" + suffix, sNumFrames, [&]()
+        {
+            parallelSystem.update(sDeltaTime, threadPool);
+        }));
+
+        bool identical = serialLog == parallelLog;
+        for(int i = 0; identical && i < numSprites; ++i)
+        {
+            identical = serialSystem.getTextureRect(i) == parallelSystem.getTextureRect(i)
+                     && serialSystem.isFinished(i) == parallelSystem.isFinished(i);
+        }
+        if(identical == false)
+            std::printf("Mismatch between serial and parallel AnimationSystem::update\n");
+        return identical;
+    }
+
+
+    //A server stepping at one tick per second must end up exactly where a client stepping 16 times per second does.
+    //Returns false on a mismatch.
+    bool benchmarkCoarseTicks(int numSprites)
+    {
+        const sf::Int64 numFineTicksPerCoarseTick = 16;
+        const sf::Time coarseTick = sf::seconds(1);
+        const sf::Time fineTick = coarseTick / numFineTicksPerCoarseTick;
+        
+        std::vector<std::uint64_t> fineCallbacks(numSprites, 0);
+        std::vector<std::uint64_t> coarseCallbacks(numSprites, 0);
+        AnimationSystem fineSystem;
+        AnimationSystem coarseSystem;
+        for(int i = 0; i < numSprites; ++i)
+        {
+            auto conditions = AnimatedSprite::CallbackConditions(AnimatedSprite::EachLoopEnd | AnimatedSprite::AnimationCompletion);
+            AnimationSystem::SpriteId id = fineSystem.addSprite(i % sNumObjects);
+            fineSystem.setAnimation(id, i % sNumAnimationsPerObject, 1 + i % 20, conditions, [&fineCallbacks, id](){ ++fineCallbacks[id]; });
+            id = coarseSystem.addSprite(i % sNumObjects);
+            coarseSystem.setAnimation(id, i % sNumAnimationsPerObject, 1 + i % 20, conditions, [&coarseCallbacks, id](){ ++coarseCallbacks[id]; });
+        }
+
+        std::string suffix = " (" + std::to_string(numSprites) + " sprites)";
+        benchmark::print(benchmark::measure("AnimationSystem::update 16 fine ticks" + suffix, 10, [&]()
+        {
+            for(int tick = 0; tick < numFineTicksPerCoarseTick; ++tick)
+                fineSystem.update(fineTick);
+        }));
+        benchmark::print(benchmark::measure("AnimationSystem::update 1 coarse tick" + suffix, 10, [&]()
+        {
+            coarseSystem.update(coarseTick);
+        }));
+
+        bool identical = fineCallbacks == coarseCallbacks;
+        for(int i = 0; identical && i < numSprites; ++i)
+            identical = fineSystem.getTextureRect(i) == coarseSystem.getTextureRect(i) && fineSystem.isFinished(i) == coarseSystem.isFinished(i);
+        if(identical == false)
+            std::printf("Mismatch between fine and coarse AnimationSystem::update\n");
+        return identical;
+    }
+
+
+    //Nine in ten sprites are culled.  Waking them afterwards must give the same result as never culling them.
+    //Returns false on a mismatch.
+    bool benchmarkDormantSprites(int numSprites)
+    {
+        std::vector<std::uint64_t> awakeCallbacks(numSprites, 0);
+        std::vector<std::uint64_t> lazyCallbacks(numSprites, 0);
+        AnimationSystem awakeSystem;
+        AnimationSystem lazySystem;
+        for(int i = 0; i < numSprites; ++i)
+        {
+            auto conditions = AnimatedSprite::CallbackConditions(AnimatedSprite::EachLoopEnd | AnimatedSprite::AnimationCompletion);
+            AnimationSystem::SpriteId id = awakeSystem.addSprite(i % sNumObjects);
+            awakeSystem.setAnimation(id, i % sNumAnimationsPerObject, 1 + i % 20, conditions, [&awakeCallbacks, id](){ ++awakeCallbacks[id]; });
+            id = lazySystem.addSprite(i % sNumObjects);
+            lazySystem.setAnimation(id, i % sNumAnimationsPerObject, 1 + i % 20, conditions, [&lazyCallbacks, id](){ ++lazyCallbacks[id]; });
+            if(i % 10 != 0)
+                lazySystem.setDormant(id, true);
+        }
+
+        std::string suffix = " (" + std::to_string(numSprites) + " sprites)";
+        benchmark::print(benchmark::measure("AnimationSystem::update all awake" + suffix, sNumFrames, [&]()
+        {
+            awakeSystem.update(sDeltaTime);
+        }));
+        benchmark::print(benchmark::measure("AnimationSystem::update 90% dormant" + suffix, sNumFrames, [&]()
+        {
+            lazySystem.update(sDeltaTime);
+        }));
+
+        bool identical = true;
+        for(int i = 0; identical && i < numSprites; ++i)
+            identical = awakeSystem.getTextureRect(i) == lazySystem.getTextureRect(i);
+        for(int i = 0; i < numSprites; ++i)
+            lazySystem.setDormant(i, false);
+        lazySystem.update(sf::Time::Zero);
+        identical = identical && awakeCallbacks == lazyCallbacks;
+        for(int i = 0; identical && i < numSprites; ++i)
+            identical = awakeSystem.getTextureRect(i) == lazySystem.getTextureRect(i) && awakeSystem.isFinished(i) == lazySystem.isFinished(i);
+        if(identical == false)
+            std::printf("Mismatch between awake and dormant sprites in AnimationSystem\n");
+        return identical;
+    }
+
+
+    //Callbacks that re-animate or remove their own sprite, and add others, while they run.  They capture a string
+    //so that they are stored on the heap, where running a destroyed callback would show.  Returns false on a mismatch.
+    bool checkReentrantCallbacks()
+    {
+        AnimationSystem system;
+        const std::string tag(64, 'x');
+        std::size_t numTagBytes = 0;
+        int numReanimatedCalls = 0;
+        int numRemovedCalls = 0;
+        int numSwitchCalls = 0;
+        AnimationSystem::SpriteId reanimated = system.addSprite(0);
+        AnimationSystem::SpriteId removed = system.addSprite(0);
+        AnimationSystem::SpriteId switched = system.addSprite(0);
+        system.setContinuouslyLoopingAnimation(reanimated, 0, sf::milliseconds(10), AnimatedSprite::EachLoopEnd, [&, tag]()
+        {
+            system.setContinuouslyLoopingAnimation(reanimated, 1, sf::milliseconds(10), AnimatedSprite::EachLoopEnd, [&numReanimatedCalls](){ ++numReanimatedCalls; });
+            numTagBytes += tag.size();
+        });
+        system.setContinuouslyLoopingAnimation(removed, 0, sf::milliseconds(10), AnimatedSprite::EachLoopEnd, [&, tag]()
+        {
+            system.removeSprite(removed);
+            for(int i = 0; i < 1024; ++i)
+                system.addSprite(i % sNumObjects);
+            numTagBytes += tag.size();
+            ++numRemovedCalls;
+        });
+        system.setContinuouslyLoopingAnimation(switched, 0, sf::milliseconds(10), AnimatedSprite::AnimationSwitch, [&, tag]()
+        {
+            system.setContinuouslyLoopingAnimation(switched, 2, sf::milliseconds(10));
+            numTagBytes += tag.size();
+            ++numSwitchCalls;
+        });
+        system.setContinuouslyLoopingAnimation(switched, 3, sf::milliseconds(10));
+        for(int frame = 0; frame < 100; ++frame)
+            system.update(sf::milliseconds(10));
+
+        bool identical = numTagBytes == 3 * tag.size() && numRemovedCalls == 1 && numSwitchCalls == 1 && numReanimatedCalls > 0
+                      && system.contains(reanimated) && system.getSpriteCount() == 2 + 1024;
+        if(identical == false)
+            std::printf("Mismatch in callbacks that re-animate or remove their own sprite in AnimationSystem\n");
+        return identical;
+    }
+}
+
+
+int main()
+{
+    buildAnimations();
+    if(checkReentrantCallbacks() == false)
+        return 1;
+    for(int numSprites : {1000, 10000, 100000})
+    {
+        if(benchmarkSpriteCount(numSprites) == false)
+            return 1;
+    }
+    for(unsigned numThreads : {1u, 3u, 7u, 15u})
+    {
+        if(benchmarkThreadCount(100000, numThreads) == false)
+            return 1;
+    }
+    if(benchmarkCoarseTicks(100000) == false)
+        return 1;
+    if(benchmarkDormantSprites(100000) == false)
+        return 1;
+    return 0;
+}
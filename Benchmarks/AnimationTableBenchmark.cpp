@@ -0,0 +1,129 @@
+#include "AnimationTable.h"
+#include "Benchmark.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+//Compares nested-vector animation storage against the flat AnimationTable, both for startup and for frame lookups.
+//Also checks that a table file whose frame end times are out of order is rejected.
+namespace
+{
+    const int sNumObjects = 2000;
+    const int sNumAnimationsPerObject = 8;
+    const int sNumLookups = 1000000;
+    const char* sTableFilename = "AnimationTableBenchmark.anim";
+
+
+    AnimationTable::NestedAnimations buildNestedAnimations()
+    {
+        AnimationTable::NestedAnimations animations(sNumObjects);
+        for(int object = 0; object < sNumObjects; ++object)
+        {
+            animations[object].resize(sNumAnimationsPerObject);
+            for(int animation = 0; animation < sNumAnimationsPerObject; ++animation)
+            {
+                for(int frame = 0; frame < 4 + (object + animation) % 13; ++frame)
+                    animations[object][animation].push_back(sf::IntRect(frame * 32, animation * 32, 32, 32));
+            }
+        }
+        return animations;
+    }
+
+
+    bool checkUnsortedFrameEndTimes()
+    {
+        AnimationTable table;
+        AnimationTable::NestedAnimations animations(1, std::vector<std::vector<sf::IntRect>>(1, std::vector<sf::IntRect>(3)));
+        AnimationTable::NestedFrameDurations durations(1, std::vector<std::vector<sf::Time>>(1, {sf::milliseconds(10), sf::milliseconds(20), sf::milliseconds(30)}));
+        table.build(animations, durations);
+        if(table.saveToFile(sTableFilename) == false)
+            return false;
+        std::ifstream file(sTableFilename, std::ios::binary);
+        std::vector<char> image((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        std::remove(sTableFilename);
+
+        //The frame end times are the last part of the image; swapping the last two unsorts them.
+        bool acceptsSorted = table.loadFromMemory(image.data(), image.size());
+        std::uint32_t* endTimes = reinterpret_cast<std::uint32_t*>(image.data() + image.size()) - 3;
+        std::swap(endTimes[1], endTimes[2]);
+        bool rejectsUnsorted = table.loadFromMemory(image.data(), image.size()) == false;
+        if(!acceptsSorted || !rejectsUnsorted)
+        {
+            std::printf("Mismatch: AnimationTable validation of frame end times\n");
+            return false;
+        }
+        return true;
+    }
+}
+
+
+int main()
+{
+    if(checkUnsortedFrameEndTimes() == false)
+        return 1;
+
+    AnimationTable::NestedAnimations nested;
+    benchmark::print(benchmark::measure("Build nested vectors", 20, [&]()
+    {
+        nested = buildNestedAnimations();
+    }));
+
+    AnimationTable builtTable;
+    benchmark::print(benchmark::measure("AnimationTable::build", 20, [&]()
+    {
+        builtTable.build(nested);
+    }));
+    if(builtTable.saveToFile(sTableFilename) == false)
+    {
+        std::printf("Failed to write %s\n", sTableFilename);
+        return 1;
+    }
+
+    AnimationTable loadedTable;
+    benchmark::print(benchmark::measure("AnimationTable::loadFromFile (mmap)", 20, [&]()
+    {
+        loadedTable.loadFromFile(sTableFilename);
+    }));
+
+    //Pseudo-random but reproducible lookups, so that both containers see the same access pattern.
+    std::vector<std::uint32_t> lookups(sNumLookups);
+    std::uint32_t state = 12345;
+    for(auto& lookup : lookups)
+    {
+        state = state * 1664525u + 1013904223u;
+        lookup = state;
+    }
+
+    long long nestedSum = 0;
+    benchmark::print(benchmark::measure("Frame lookup, nested vectors", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+        {
+            auto& sequence = nested[lookup % sNumObjects][(lookup >> 16) % sNumAnimationsPerObject];
+            nestedSum += sequence[(lookup >> 8) % sequence.size()].left;
+        }
+    }));
+    long long flatSum = 0;
+    benchmark::print(benchmark::measure("Frame lookup, AnimationTable", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+        {
+            const AnimationTable::Sequence& sequence = loadedTable.getSequence(lookup % sNumObjects, (lookup >> 16) % sNumAnimationsPerObject);
+            flatSum += loadedTable.getFrames(sequence)[(lookup >> 8) % sequence.numFrames].left;
+        }
+    }));
+
+    std::remove(sTableFilename);
+    if(nestedSum != flatSum)
+    {
+        std::printf("Mismatch between nested vectors and AnimationTable\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "AssetArchive.h"
+#include "Benchmark.h"
+#include "ResourceHolder.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+//Compares startup loading of many small assets from loose files against an AssetArchive, stored and compressed.
+//The files are in the page cache after the first iteration, so this measures system call and copying
+//overhead rather than disk reads, which an archive also reduces on a cold start.  Also checks that an archive
+//claiming an impossible decompressed size is rejected.
+namespace
+{
+    const int sNumFiles = 1000;
+    const std::size_t sFileSize = 16 * 1024;
+    const char* sStoredArchiveFilename = "AssetArchiveBenchmark_stored.pak";
+    const char* sCompressedArchiveFilename = "AssetArchiveBenchmark_lz.pak";
+
+
+    std::string getLooseFilename(int file)
+    {
+        return "AssetArchiveBenchmark_" + std::to_string(file) + ".bin";
+    }
+
+
+    //Stands in for a decoder, which reads each byte of its input once.
+    struct Resource
+    {
+        bool loadFromFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::binary);
+            std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            return loadFromMemory(data.data(), data.size());
+        }
+
+
+        bool loadFromMemory(const void* data, std::size_t sizeInBytes)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            checksum = 0;
+            for(std::size_t i = 0; i < sizeInBytes; ++i)
+                checksum = checksum * 31 + bytes[i];
+            return sizeInBytes > 0;
+        }
+
+        std::uint32_t checksum;
+    };
+
+
+    //Image-like data: runs of repeated pixels with some noise, which compresses to about a fifth.
+    std::vector<char> makeFileData(int file)
+    {
+        std::vector<char> data(sFileSize);
+        std::uint32_t state = 12345u + static_cast<std::uint32_t>(file);
+        for(std::size_t i = 0; i < data.size(); i += 4)
+        {
+            state = state * 1664525u + 1013904223u;
+            std::uint32_t pixel = (state >> 28) == 0 ? state : static_cast<std::uint32_t>(i / 64) * 0x01010101u;
+            for(std::size_t byte = 0; byte < 4; ++byte)
+                data[i + byte] = static_cast<char>(pixel >> (byte * 8));
+        }
+        return data;
+    }
+
+
+    //An Lz entry whose index claims more bytes than its data could decompress to must not open, or getData()
+    //would allocate whatever the file says.
+    bool checkOversizedEntry()
+    {
+        const char* filename = "AssetArchiveBenchmark_oversized.pak";
+        if(AssetArchive::write(filename, {AssetArchive::SourceEntry{"entry", makeFileData(0), AssetArchive::Lz}}) == false)
+            return false;
+        AssetArchive archive;
+        bool acceptsValid = archive.open(filename) && archive.getCompression(0) == AssetArchive::Lz;
+        archive.close();
+
+        //The first index entry follows the 16 byte header; its decompressed size follows its offset and stored size.
+        std::vector<char> file;
+        {
+            std::ifstream input(filename, std::ios::binary);
+            file.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        }
+        std::uint64_t oversized = std::uint64_t(1) << 40;
+        std::memcpy(file.data() + 16 + 2 * sizeof(std::uint64_t), &oversized, sizeof(oversized));
+        std::ofstream(filename, std::ios::binary | std::ios::trunc).write(file.data(), static_cast<std::streamsize>(file.size()));
+        bool rejectsOversized = archive.open(filename) == false;
+        std::remove(filename);
+        if(!acceptsValid || !rejectsOversized)
+        {
+            std::printf("Mismatch: AssetArchive validation of decompressed sizes\n");
+            return false;
+        }
+        return true;
+    }
+
+
+    std::uint32_t sumChecksums(const ResourceHolder<int, Resource>& holder)
+    {
+        std::uint32_t sum = 0;
+        for(int file = 0; file < sNumFiles; ++file)
+            sum += holder.get(file).checksum;
+        return sum;
+    }
+}
+
+
+int main()
+{
+    if(checkOversizedEntry() == false)
+        return 1;
+
+    std::vector<AssetArchive::SourceEntry> storedEntries;
+    std::vector<AssetArchive::SourceEntry> compressedEntries;
+    for(int file = 0; file < sNumFiles; ++file)
+    {
+        std::vector<char> data = makeFileData(file);
+        std::ofstream(getLooseFilename(file), std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+        storedEntries.push_back(AssetArchive::SourceEntry{getLooseFilename(file), data, AssetArchive::Stored});
+        compressedEntries.push_back(AssetArchive::SourceEntry{getLooseFilename(file), data, AssetArchive::Lz});
+    }
+    if(AssetArchive::write(sStoredArchiveFilename, storedEntries) == false || AssetArchive::write(sCompressedArchiveFilename, compressedEntries) == false)
+    {
+        std::printf("Failed to write the archives\n");
+        return 1;
+    }
+
+    std::uint32_t looseSum = 0;
+    benchmark::print(benchmark::measure("Load " + std::to_string(sNumFiles) + " loose files", 10, [&]()
+    {
+        ResourceHolder<int, Resource> holder;
+        for(int file = 0; file < sNumFiles; ++file)
+            holder.load(file, getLooseFilename(file));
+        looseSum = sumChecksums(holder);
+    }));
+    std::uint32_t storedSum = 0;
+    benchmark::print(benchmark::measure("Load " + std::to_string(sNumFiles) + " stored archive entries", 10, [&]()
+    {
+        AssetArchive archive;
+        archive.open(sStoredArchiveFilename);
+        ResourceHolder<int, Resource> holder;
+        for(int file = 0; file < sNumFiles; ++file)
+            holder.loadFromArchive(file, archive, getLooseFilename(file));
+        storedSum = sumChecksums(holder);
+    }));
+    std::uint32_t compressedSum = 0;
+    benchmark::print(benchmark::measure("Load " + std::to_string(sNumFiles) + " lz archive entries", 10, [&]()
+    {
+        AssetArchive archive;
+        archive.open(sCompressedArchiveFilename);
+        ResourceHolder<int, Resource> holder;
+        for(int file = 0; file < sNumFiles; ++file)
+            holder.loadFromArchive(file, archive, getLooseFilename(file));
+        compressedSum = sumChecksums(holder);
+    }));
+
+    std::ifstream storedFile(sStoredArchiveFilename, std::ios::binary | std::ios::ate);
+    std::ifstream compressedFile(sCompressedArchiveFilename, std::ios::binary | std::ios::ate);
+    std::printf("Archive sizes: stored %lld bytes, lz %lld bytes\n", static_cast<long long>(storedFile.tellg()), static_cast<long long>(compressedFile.tellg()));
+    bool passed = storedSum == looseSum && compressedSum == looseSum;
+    if(passed == false)
+        std::printf("Mismatch between loose files and archive entries\n");
+
+    for(int file = 0; file < sNumFiles; ++file)
+        std::remove(getLooseFilename(file).c_str());
+    storedFile.close();
+    compressedFile.close();
+    std::remove(sStoredArchiveFilename);
+    std::remove(sCompressedArchiveFilename);
+    return passed ? 0 : 1;
+}
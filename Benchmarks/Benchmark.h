@@ -0,0 +1,108 @@
+#ifndef Benchmark_h
+#define Benchmark_h
+
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Minimal timing helpers shared by the benchmark programs.  A benchmark runs its body
+a number of times and reports the median and best time per iteration, which is
+less sensitive to scheduler noise than the mean.  Results can also be written as
+JSON, for tracking regressions between releases.
+----------------------------------------------------------------------------------*/
+namespace benchmark
+{
+    struct Result
+    {
+        std::string name;
+        double medianMicroseconds;
+        double bestMicroseconds;
+        int iterations;
+        double itemsPerIteration;  //for throughput, zero if not meaningful
+    };
+
+
+    //Call body() iterations times, timing each call separately.
+    template<typename T_Body>
+    Result measure(const std::string& name, int iterations, T_Body&& body)
+    {
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for(int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        std::sort(samples.begin(), samples.end());
+        return Result{name, samples[samples.size() / 2], samples.front(), iterations, 0.0};
+    }
+
+
+    inline void print(const Result& result)
+    {
+        std::printf("%-48s median %12.2f us   best %12.2f us\n", result.name.c_str(), result.medianMicroseconds, result.bestMicroseconds);
+    }
+
+
+    inline void writeJsonString(std::FILE* file, const std::string& text)
+    {
+        std::fputc('"', file);
+        for(char character : text)
+        {
+            if(character == '"' || character == '\\')
+                std::fprintf(file, "\\%c", character);
+            else if(static_cast<unsigned char>(character) < 0x20)
+                std::fprintf(file, "\\u%04x", static_cast<unsigned>(character));
+            else
+                std::fputc(character, file);
+        }
+        std::fputc('"', file);
+    }
+
+
+    //{"suite": name, "results": [{"name", "iterations", "median_us", "best_us"[, "items_per_second"]}, ...]}
+    inline void writeJson(std::FILE* file, const std::string& suiteName, const std::vector<Result>& results)
+    {
+        std::fprintf(file, "{\n  \"suite\": ");
+        writeJsonString(file, suiteName);
+        std::fprintf(file, ",\n  \"results\": [");
+        for(std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Result& result = results[i];
+            std::fprintf(file, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+            writeJsonString(file, result.name);
+            std::fprintf(file, ", \"iterations\": %d, \"median_us\": %.3f, \"best_us\": %.3f", result.iterations, result.medianMicroseconds, result.bestMicroseconds);
+            if(result.itemsPerIteration > 0.0 && result.medianMicroseconds > 0.0)
+                std::fprintf(file, ", \"items_per_second\": %.1f", result.itemsPerIteration * 1e6 / result.medianMicroseconds);
+            std::fputc('}', file);
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+    }
+
+
+    //Make SFML's audio output go to OpenAL Soft's null backend, so that audio benchmarks run on machines
+    //without a sound card, such as CI servers.  Playback then advances in real time without any output.
+    //Must be called before the first audio object is created; an ALSOFT_DRIVERS set by the user wins.
+    inline void useNullAudioDevice()
+    {
+#ifdef _WIN32
+        if(std::getenv("ALSOFT_DRIVERS") == nullptr)
+            _putenv_s("ALSOFT_DRIVERS", "null");
+#else
+        setenv("ALSOFT_DRIVERS", "null", 0);
+#endif
+    }
+}
+
+
+
+#endif
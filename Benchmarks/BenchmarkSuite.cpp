@@ -0,0 +1,401 @@
+#include "AnimatedSprite.h"
+#include "Benchmark.h"
+#include "MusicPlayer.h"
+#include "ResourceHolder.h"
+#include "SoundPlayer.h"
+#include "ThreadedMusicPlayer.h"
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/Clock.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Headless benchmark suite covering the engine's hot paths, for regression tracking
+on CI machines without a display or sound card: AnimatedSprite::update()
+throughput, SoundPlayer playSound() and update() churn, ResourceHolder::get() at
+several sizes, and MusicPlayer Playlist switch latency.  It also checks that
+ResourceHolder lookups by id and by Handle agree, that a looped Playlist of one
+song keeps joining the song to itself from a prefetch, and that a
+ThreadedMusicPlayer stuck on missing songs neither spins nor floods its Events,
+and exits with 1 if any check fails.  Audio goes to OpenAL Soft's null backend
+unless --real-audio is given, and the songs are generated WAV files, so no assets
+are needed.
+
+usage: BenchmarkSuite [--json file] [--filter text] [--real-audio]
+--json also writes the results to file as JSON.
+--filter runs only the benchmarks whose names contain text.
+----------------------------------------------------------------------------------*/
+namespace
+{
+    struct Options
+    {
+        std::string jsonFilename;
+        std::string filter;
+        bool realAudio = false;
+    };
+
+    //Collects the results of the benchmarks that pass the filter.
+    class Suite
+    {
+    public:
+        explicit Suite(const std::string& filter)
+        :mFilter(filter)
+        {
+        }
+
+
+        bool isSelected(const std::string& name) const
+        {
+            return name.find(mFilter) != std::string::npos;
+        }
+
+
+        template<typename T_Body>
+        void run(const std::string& name, int iterations, double itemsPerIteration, T_Body&& body)
+        {
+            if(isSelected(name) == false)
+                return;
+            benchmark::Result result = benchmark::measure(name, iterations, body);
+            result.itemsPerIteration = itemsPerIteration;
+            benchmark::print(result);
+            mResults.push_back(result);
+        }
+
+
+        const std::vector<benchmark::Result>& getResults() const
+        {
+            return mResults;
+        }
+
+    private:
+        std::string mFilter;
+        std::vector<benchmark::Result> mResults;
+    };
+
+
+    const sf::Time sFrameTime = sf::microseconds(16667);
+
+
+    bool parseArguments(int argc, char* argv[], Options& options)
+    {
+        for(int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            if(argument == "--real-audio")
+                options.realAudio = true;
+            else if((argument == "--json" || argument == "--filter") && i + 1 < argc)
+                (argument == "--json" ? options.jsonFilename : options.filter) = argv[++i];
+            else
+                return false;
+        }
+        return true;
+    }
+
+
+    void benchmarkAnimatedSprites(Suite& suite)
+    {
+        const int numObjects = 16;
+        const int numAnimationsPerObject = 4;
+        AnimatedSprite::sAnimations.assign(numObjects, AnimatedSprite::AnimationSequenceSet(numAnimationsPerObject));
+        for(int object = 0; object < numObjects; ++object)
+        {
+            for(int animation = 0; animation < numAnimationsPerObject; ++animation)
+            {
+                for(int frame = 0; frame < 4 + (object + animation) % 9; ++frame)
+                    AnimatedSprite::sAnimations[object][animation].push_back(sf::IntRect(frame * 32, animation * 32, 32, 32));
+            }
+        }
+        AnimatedSprite::sFrameDurations.clear();
+        AnimatedSprite::sAnimationTable.build(AnimatedSprite::sAnimations);
+
+        for(int numSprites : {1000, 10000, 100000})
+        {
+            std::string name = "AnimatedSprite::update, " + std::to_string(numSprites) + " sprites";
+            if(suite.isSelected(name) == false)
+                continue;
+            std::vector<AnimatedSprite> sprites;
+            sprites.reserve(numSprites);
+            for(int i = 0; i < numSprites; ++i)
+            {
+                sprites.emplace_back(i % numObjects);
+                //Spread the frame rates so that only some of the sprites change frame on each update.
+                sprites.back().setContinuouslyLoopingAnimation(i % numAnimationsPerObject, sf::milliseconds(40 + i % 7 * 15));
+            }
+            suite.run(name, 50, numSprites, [&]()
+            {
+                for(auto& sprite : sprites)
+                    sprite.update(sFrameTime);
+            });
+        }
+    }
+
+
+    void benchmarkSoundPlayer(Suite& suite)
+    {
+        const int numBuffers = 8;
+        const int numPlaysPerFrame = 64;
+        std::string name = "SoundPlayer playSound/stopSound/update churn, " + std::to_string(numPlaysPerFrame) + " plays per frame";
+        if(suite.isSelected(name) == false)
+            return;
+
+        std::vector<sf::Int16> samples(4410);
+        for(std::size_t i = 0; i < samples.size(); ++i)
+            samples[i] = static_cast<sf::Int16>(8000.0 * std::sin(i * 0.0627));
+        std::vector<sf::SoundBuffer> buffers(numBuffers);
+        for(auto& buffer : buffers)
+            buffer.loadFromSamples(samples.data(), samples.size(), 1, 44100);
+
+        SoundPlayer soundPlayer(32);
+        SoundPlayer::CoalescingSettings settings;
+        settings.maxInstancesPerBuffer = numPlaysPerFrame;
+        soundPlayer.setCoalescingSettings(settings);
+        std::vector<SoundPlayer::SoundHandle> handles;
+        int frame = 0;
+        //Each frame starts more sounds than there are voices, so that voices are stolen, and stops half of
+        //the previous frame's sounds early; update() then releases the stopped and finished ones.
+        suite.run(name, 200, numPlaysPerFrame, [&]()
+        {
+            for(std::size_t i = 0; i < handles.size(); i += 2)
+                soundPlayer.stopSound(handles[i]);
+            handles.clear();
+            for(int i = 0; i < numPlaysPerFrame; ++i)
+            {
+                SoundInfo info;
+                info.priority = (frame + i) % 4;
+                info.volume = 40.0f + (i % 7) * 10.0f;
+                handles.push_back(soundPlayer.playSound(buffers[(frame + i) % numBuffers], info));
+            }
+            soundPlayer.update(sFrameTime);
+            ++frame;
+        });
+    }
+
+
+    //Stands in for a texture, without needing files or a graphics context.
+    struct Resource
+    {
+        bool loadFromFile(const std::string& filename)
+        {
+            value = static_cast<int>(filename.size());
+            return true;
+        }
+
+        int value;
+    };
+
+
+    //Returns false if the lookups by id and by Handle disagree.
+    bool benchmarkResourceHolder(Suite& suite)
+    {
+        const int numLookups = 100000;
+        for(int numResources : {16, 256, 4096, 65536})
+        {
+            ResourceHolder<int, Resource> holder;
+            std::vector<ResourceHolder<int, Resource>::Handle> handles;
+            for(int id = 0; id < numResources; ++id)
+                handles.push_back(holder.load(id, std::string(id % 61, 'x')));
+            std::vector<std::uint32_t> lookups(numLookups);
+            std::uint32_t state = 12345;
+            for(auto& lookup : lookups)
+            {
+                state = state * 1664525u + 1013904223u;
+                lookup = (state >> 8) % numResources;
+            }
+
+            long long idSum = 0;
+            suite.run("ResourceHolder::get(id), " + std::to_string(numResources) + " resources", 20, numLookups, [&]()
+            {
+                for(std::uint32_t lookup : lookups)
+                    idSum += holder.get(static_cast<int>(lookup)).value;
+            });
+            long long handleSum = 0;
+            suite.run("ResourceHolder::get(Handle), " + std::to_string(numResources) + " resources", 20, numLookups, [&]()
+            {
+                for(std::uint32_t lookup : lookups)
+                    handleSum += holder.get(handles[lookup]).value;
+            });
+            if(suite.isSelected("ResourceHolder::get(id)") && suite.isSelected("ResourceHolder::get(Handle)") && idSum != handleSum)
+            {
+                std::printf("Mismatch between ResourceHolder lookups by id and by Handle\n");
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    std::string writeSong(int song)
+    {
+        //Two seconds of a tone, distinct per song.
+        const unsigned sampleRate = 44100;
+        std::vector<sf::Int16> samples(sampleRate * 2 * 2);
+        for(std::size_t i = 0; i < samples.size(); ++i)
+            samples[i] = static_cast<sf::Int16>(6000.0 * std::sin((i / 2) * (0.02 + song * 0.005)));
+        sf::SoundBuffer buffer;
+        std::string filename = "BenchmarkSuite_song" + std::to_string(song) + ".wav";
+        if(buffer.loadFromSamples(samples.data(), samples.size(), 2, sampleRate) == false || buffer.saveToFile(filename) == false)
+            return std::string();
+        return filename;
+    }
+
+
+    void benchmarkMusicPlayer(Suite& suite)
+    {
+        const int numSongsPerPlaylist = 4;
+        std::string name = "MusicPlayer Playlist switch (loadPlaylist + play)";
+        if(suite.isSelected(name) == false)
+            return;
+
+        std::vector<std::string> songs;
+        for(int song = 0; song < numSongsPerPlaylist * 2; ++song)
+        {
+            songs.push_back(writeSong(song));
+            if(songs.back().empty())
+            {
+                std::printf("Failed to write the songs; skipping %s\n", name.c_str());
+                return;
+            }
+        }
+
+        MusicPlayer<int> musicPlayer;
+        musicPlayer.storePlaylist(0, std::vector<std::string>(songs.begin(), songs.begin() + numSongsPerPlaylist));
+        musicPlayer.storePlaylist(1, std::vector<std::string>(songs.begin() + numSongsPerPlaylist, songs.end()));
+        int playlist = 0;
+        //Alternates between the two Playlists, saving the current music as a game switching between areas would.
+        suite.run(name, 40, 0.0, [&]()
+        {
+            musicPlayer.loadPlaylist(playlist, true, false, true);
+            musicPlayer.play();
+            playlist = 1 - playlist;
+        });
+        suite.run("MusicPlayer resume saved Playlist (popCurrentPlaylist + play)", 20, 0.0, [&]()
+        {
+            musicPlayer.popCurrentPlaylist();
+            musicPlayer.play();
+        });
+        musicPlayer.stopPlaylist();
+
+        for(auto& song : songs)
+            std::remove(song.c_str());
+    }
+
+
+    //The song is joined to itself, so its next play must be prefetched anew after every switch.  Plays in real
+    //time, for two switches.  Returns false if the calling thread had to open the song itself.
+    bool checkSingleSongLoop(Suite& suite)
+    {
+        std::string name = "MusicPlayer looped single-song Playlist";
+        if(suite.isSelected(name) == false)
+            return true;
+        std::string song = writeSong(0);
+        if(song.empty())
+        {
+            std::printf("Failed to write the song; skipping %s\n", name.c_str());
+            return true;
+        }
+
+        MusicPlayer<int> musicPlayer;
+        musicPlayer.storePlaylist(0, std::vector<std::string>{song});
+        musicPlayer.loadPlaylist(0, true, false);
+        musicPlayer.play();
+        //The first play opens the song on the calling thread.
+        musicPlayer.resetStatistics();
+        sf::Clock clock;
+        while(musicPlayer.getStatistics().numGaplessSwitches < 2 && clock.getElapsedTime() < sf::seconds(10.0f))
+        {
+            musicPlayer.update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        const MusicPlayer<int>::Statistics& statistics = musicPlayer.getStatistics();
+        std::printf("%s: %zu gapless switches, %zu prefetch misses\n", name.c_str(), statistics.numGaplessSwitches, statistics.numPrefetchMisses);
+        bool passed = statistics.numGaplessSwitches >= 2 && statistics.numPrefetchMisses == 0;
+        if(passed == false)
+            std::printf("Mismatch: the looped song was not prefetched for every switch\n");
+        musicPlayer.stopPlaylist();
+        std::remove(song.c_str());
+        return passed;
+    }
+
+
+    bool checkMissingSong(Suite& suite)
+    {
+        std::string name = "ThreadedMusicPlayer missing songs";
+        if(suite.isSelected(name) == false)
+            return true;
+        std::string song = writeSong(0);
+        if(song.empty())
+        {
+            std::printf("Failed to write the song; skipping %s\n", name.c_str());
+            return true;
+        }
+
+        //Once the song ends, every update() fails to open the next one, skipping ahead by one missing song.
+        std::vector<std::string> playlist{song};
+        for(int missing = 0; missing < 1000; ++missing)
+            playlist.push_back("BenchmarkSuite_missing" + std::to_string(missing) + ".wav");
+        std::clock_t cpuStart = std::clock();
+        std::size_t numEvents = 0;
+        std::size_t numErrors = 0;
+        {
+            ThreadedMusicPlayer<int> musicPlayer;
+            musicPlayer.storePlaylist(0, std::move(playlist));
+            musicPlayer.loadPlaylist(0, true, false);
+            musicPlayer.play();
+            std::this_thread::sleep_for(std::chrono::seconds(4));
+            ThreadedMusicPlayer<int>::Event event;
+            while(musicPlayer.pollEvent(event))
+            {
+                ++numEvents;
+                numErrors += event.type == ThreadedMusicPlayer<int>::Event::Error;
+            }
+        }
+        double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        std::printf("%s: %zu events, %zu errors, %.2f s of CPU time in 4 s\n", name.c_str(), numEvents, numErrors, cpuSeconds);
+        bool passed = numErrors > 0 && numEvents < 64 && cpuSeconds < 2.0;
+        if(passed == false)
+            std::printf("Mismatch: the music thread kept retrying missing songs without backing off\n");
+        std::remove(song.c_str());
+        return passed;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(parseArguments(argc, argv, options) == false)
+    {
+        std::printf("usage: BenchmarkSuite [--json file] [--filter text] [--real-audio]\n");
+        return 1;
+    }
+    if(options.realAudio == false)
+        benchmark::useNullAudioDevice();
+
+    Suite suite(options.filter);
+    benchmarkAnimatedSprites(suite);
+    benchmarkSoundPlayer(suite);
+    bool passed = benchmarkResourceHolder(suite);
+    benchmarkMusicPlayer(suite);
+    passed = checkSingleSongLoop(suite) && passed;
+    passed = checkMissingSong(suite) && passed;
+
+    if(options.jsonFilename.empty())
+        return passed ? 0 : 1;
+    std::FILE* file = std::fopen(options.jsonFilename.c_str(), "w");
+    if(file == nullptr)
+    {
+        std::printf("Failed to write %s\n", options.jsonFilename.c_str());
+        return 1;
+    }
+    benchmark::writeJson(file, "BenchmarkSuite", suite.getResults());
+    std::fclose(file);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+#include "AnimatedSprite.h"
+#include "AnimationSystem.h"
+#include "FrameArena.h"
+#include "PoolResource.h"
+#include "ResourceHolder.h"
+#include "SoundCommandQueue.h"
+#include "SoundPlayer.h"
+#include "ThreadPool.h"
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+
+//Counts the global heap allocations made by typical steady-state frames of the engine's systems, after enough
+//warm-up frames for their containers and pools to reach their peak sizes.  Exits with 1 if any measured frame
+//allocated, so that it can guard against regressions.  The allocations made inside SFML itself depend on the
+//implementation: SFML 2.5's sf::Sound::setBuffer() allocates, which SoundPlayer avoids by reusing the voice
+//that last played the same buffer, but a mix of more buffers than voices will still allocate there.
+namespace
+{
+    std::atomic<std::uint64_t> sNumAllocations(0);
+    const int sNumWarmUpFrames = 120;
+    const int sNumMeasuredFrames = 600;
+    const sf::Time sDeltaTime = sf::microseconds(16667);
+
+
+    void* countedAllocate(std::size_t bytes)
+    {
+        sNumAllocations.fetch_add(1, std::memory_order_relaxed);
+        void* pointer = std::malloc(bytes > 0 ? bytes : 1);
+        if(pointer == nullptr)
+            throw std::bad_alloc();
+        return pointer;
+    }
+
+
+    //Runs frame(frameIndex) for the warm-up frames, then counts the allocations of the measured ones.
+    template<typename T_Frame>
+    bool check(const char* name, T_Frame&& frame)
+    {
+        int frameIndex = 0;
+        for(; frameIndex < sNumWarmUpFrames; ++frameIndex)
+            frame(frameIndex);
+        std::uint64_t before = sNumAllocations.load();
+        for(; frameIndex < sNumWarmUpFrames + sNumMeasuredFrames; ++frameIndex)
+            frame(frameIndex);
+        std::uint64_t numAllocations = sNumAllocations.load() - before;
+        std::printf("%-48s %8llu allocations in %d frames\n", name, static_cast<unsigned long long>(numAllocations), sNumMeasuredFrames);
+        return numAllocations == 0;
+    }
+
+
+    void buildAnimations()
+    {
+        AnimatedSprite::sAnimations.clear();
+        AnimatedSprite::sFrameDurations.clear();
+        for(int object = 0; object < 4; ++object)
+        {
+            AnimatedSprite::AnimationSequenceSet sequenceSet;
+            AnimatedSprite::FrameDurationSet durationSet;
+            for(int animation = 0; animation < 4; ++animation)
+            {
+                AnimatedSprite::AnimationSequence sequence;
+                AnimatedSprite::FrameDurations durations;
+                for(int frame = 0; frame < 3 + animation; ++frame)
+                {
+                    sequence.push_back(sf::IntRect(frame * 32, animation * 32, 32, 32));
+                    durations.push_back(sf::milliseconds(40 + frame * 20));
+                }
+                sequenceSet.push_back(sequence);
+                durationSet.push_back(durations);
+            }
+            AnimatedSprite::sAnimations.push_back(sequenceSet);
+            AnimatedSprite::sFrameDurations.push_back(durationSet);
+        }
+        AnimatedSprite::sAnimationTable.build(AnimatedSprite::sAnimations, AnimatedSprite::sFrameDurations);
+    }
+
+
+    //Stands in for a texture, without needing files or a graphics context.
+    struct Resource
+    {
+        bool loadFromFile(const std::string& filename)
+        {
+            value = static_cast<int>(filename.size());
+            return true;
+        }
+
+        int value;
+    };
+}
+
+
+void* operator new(std::size_t bytes)
+{
+    return countedAllocate(bytes);
+}
+
+
+void* operator new[](std::size_t bytes)
+{
+    return countedAllocate(bytes);
+}
+
+
+void* operator new(std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    sNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(bytes > 0 ? bytes : 1);
+}
+
+
+void* operator new[](std::size_t bytes, const std::nothrow_t&) noexcept
+{
+    sNumAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(bytes > 0 ? bytes : 1);
+}
+
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+
+int main()
+{
+    bool passed = true;
+    buildAnimations();
+    unsigned numCallbacks = 0;
+    auto conditions = AnimatedSprite::CallbackConditions(AnimatedSprite::EachLoopEnd | AnimatedSprite::AnimationCompletion);
+
+    //Restarting animations copies the callback into the sprite.
+    std::vector<AnimatedSprite> sprites;
+    sprites.reserve(256);
+    for(int i = 0; i < 256; ++i)
+    {
+        sprites.emplace_back(i % 4);
+        sprites.back().setContinuouslyLoopingAnimation(i % 4, sf::milliseconds(50));
+    }
+    passed &= check("AnimatedSprite::setAnimation and update", [&](int frame)
+    {
+        for(std::size_t i = frame % 8; i < sprites.size(); i += 8)
+            sprites[i].setAnimation((i + frame) % 4, sf::milliseconds(50), 2, conditions, [&numCallbacks, i](){ numCallbacks += static_cast<unsigned>(i); });
+        for(auto& sprite : sprites)
+            sprite.update(sDeltaTime);
+    });
+
+    AnimationSystem system;
+    for(int i = 0; i < 4096; ++i)
+        system.setAnimation(system.addSprite(i % 4), i % 4, 1 + i % 3, conditions, [&numCallbacks](){ ++numCallbacks; });
+    passed &= check("AnimationSystem::setAnimation and update", [&](int frame)
+    {
+        for(AnimationSystem::SpriteId id = frame % 16; id < system.getSpriteCount(); id += 16)
+            system.setAnimation(id, (id + frame) % 4, 1 + id % 3, conditions, [&numCallbacks, id](){ numCallbacks += id; });
+        system.setDormant(frame % 4096, frame % 2 == 0);
+        system.update(sDeltaTime);
+    });
+
+    //Enough sprites for the update to be split into a chunk per thread and more.
+    AnimationSystem threadedSystem;
+    ThreadPool threadPool(4);
+    for(int i = 0; i < 65536; ++i)
+        threadedSystem.setAnimation(threadedSystem.addSprite(i % 4), i % 4, 1 + i % 3, conditions, [&numCallbacks](){ ++numCallbacks; });
+    passed &= check("AnimationSystem::update on a ThreadPool", [&](int frame)
+    {
+        for(AnimationSystem::SpriteId id = frame % 64; id < threadedSystem.getSpriteCount(); id += 64)
+            threadedSystem.setAnimation(id, (id + frame) % 4, 1 + id % 3, conditions, [&numCallbacks, id](){ numCallbacks += id; });
+        threadedSystem.update(sDeltaTime, threadPool);
+    });
+
+    std::vector<sf::Int16> samples(4410);
+    for(std::size_t i = 0; i < samples.size(); ++i)
+        samples[i] = static_cast<sf::Int16>(8000.0 * std::sin(i * 0.0627));
+    std::vector<sf::SoundBuffer> buffers(4);
+    for(auto& buffer : buffers)
+        buffer.loadFromSamples(samples.data(), samples.size(), 1, 44100);
+    PoolResource soundPool;
+    SoundPlayer soundPlayer(32, SoundPlayer::StealPolicy::LowestPriority, &soundPool);
+    std::vector<SoundPlayer::SoundHandle> handles;
+    handles.reserve(8);
+    passed &= check("SoundPlayer queueSound/playSound/stopSound/update", [&](int frame)
+    {
+        for(auto handle : handles)
+            soundPlayer.stopSound(handle);
+        handles.clear();
+        for(int i = 0; i < 8; ++i)
+        {
+            SoundInfo info;
+            info.priority = (frame + i) % 4;
+            soundPlayer.queueSound(buffers[(frame + i) % buffers.size()], info);
+            if(i % 2 == 0)
+                handles.push_back(soundPlayer.playSound(buffers[i % buffers.size()], info));
+        }
+        soundPlayer.update(sDeltaTime);
+    });
+
+    //The queue's ticket map shares the SoundPlayer's pool, since both live on the consumer side.
+    SoundCommandQueue soundCommands(256, &soundPool);
+    std::vector<SoundCommandQueue::Ticket> tickets;
+    tickets.reserve(8);
+    passed &= check("SoundCommandQueue push/execute", [&](int frame)
+    {
+        for(std::size_t i = 0; i < tickets.size(); ++i)
+        {
+            if(i % 2 == 0)
+                soundCommands.stopSound(tickets[i]);
+            else
+                soundCommands.setVolume(tickets[i], 50.0f + static_cast<float>(frame % 50));
+        }
+        tickets.clear();
+        for(int i = 0; i < 8; ++i)
+        {
+            SoundInfo info;
+            info.priority = (frame + i) % 4;
+            tickets.push_back(soundCommands.playSound(buffers[(frame + i) % buffers.size()], info));
+            soundCommands.setPosition(tickets.back(), sf::Vector3f(static_cast<float>(i), 0.0f, 0.0f));
+        }
+        soundCommands.execute(soundPlayer);
+        soundPlayer.update(sDeltaTime);
+    });
+
+    ResourceHolder<int, Resource> resources;
+    std::vector<ResourceHolder<int, Resource>::Handle> resourceHandles;
+    for(int id = 0; id < 64; ++id)
+        resourceHandles.push_back(resources.load(id, std::string(id + 1, 'x')));
+    int checksum = 0;
+    passed &= check("ResourceHolder::get by id and by handle", [&](int frame)
+    {
+        for(int id = 0; id < 64; ++id)
+            checksum += resources.get((id + frame) % 64).value + resources.get(resourceHandles[id]).value;
+    });
+
+    FrameArena frameArena;
+    passed &= check("FrameArena scratch containers", [&](int frame)
+    {
+        AnimationSystem::Vector<int> scratch(&frameArena);
+        for(int i = 0; i < 1000 + frame % 500; ++i)
+            scratch.push_back(i);
+        AnimationSystem::Vector<AnimationSystem::Vector<int>> nested(&frameArena);
+        nested.emplace_back(scratch.begin(), scratch.end(), &frameArena);
+        checksum += nested.back().back();
+        frameArena.reset();
+    });
+
+    std::printf("%u callbacks, checksum %d\n", numCallbacks, checksum);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "Benchmark.h"
+#include "ResourceCache.h"
+#include "ResourceHolder.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+//Loads a mod-like asset set, where each file is registered under several ids in two holders, with and without a
+//shared ResourceCache, synchronously and through loadManifest().  Some files are byte-identical copies under
+//other names, which only the content-keyed cache merges.  Exits with 1 if a check fails.
+namespace
+{
+    const int sNumFiles = 64;
+    const int sNumIdsPerFile = 4;
+    const int sNumCopies = 16;  //the last files are copies of the first ones
+    const std::size_t sFileSize = 256 * 1024;
+
+
+    std::string getFilename(int file)
+    {
+        return "ResourceCacheBenchmark_" + std::to_string(file) + ".bin";
+    }
+
+
+    //Stands in for a decoded image: keeps its bytes and reads each of them once.
+    struct Resource
+    {
+        bool loadFromFile(const std::string& filename)
+        {
+            std::ifstream file(filename, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            checksum = 0;
+            for(char byte : data)
+                checksum = checksum * 31 + static_cast<unsigned char>(byte);
+            return !data.empty();
+        }
+
+        std::vector<char> data;
+        std::uint32_t checksum;
+    };
+}
+
+
+template<>
+struct ResourceSize<Resource>
+{
+    static std::size_t get(const Resource& resource)
+    {
+        return sizeof(Resource) + resource.data.size();
+    }
+};
+
+
+namespace
+{
+    using Holder = ResourceHolder<int, Resource>;
+
+
+    std::string toString(const ResourceCache<Resource>::Statistics& statistics)
+    {
+        return std::to_string(statistics.numRequests) + " requests, " + std::to_string(statistics.numLoads) + " loads, "
+             + std::to_string(statistics.numShared) + " shared, " + std::to_string(statistics.bytesSaved / 1024) + " KiB and "
+             + std::to_string(statistics.loadTimeSaved.asMilliseconds()) + " ms saved";
+    }
+
+
+    Holder::Manifest makeManifest()
+    {
+        Holder::Manifest manifest;
+        for(int file = 0; file < sNumFiles; ++file)
+        {
+            for(int id = 0; id < sNumIdsPerFile; ++id)
+                manifest.push_back(Holder::ManifestEntry{file * sNumIdsPerFile + id, getFilename(file)});
+        }
+        return manifest;
+    }
+
+
+    //Also checks that every id got the contents of its file, clearing passed if not.
+    std::size_t loadBoth(Holder& first, Holder& second, ThreadPool* threadPool, bool& passed)
+    {
+        Holder::Manifest manifest = makeManifest();
+        for(Holder* holder : {&first, &second})
+        {
+            if(threadPool)
+                holder->loadManifest(*threadPool, manifest);
+            else
+            {
+                for(const auto& entry : manifest)
+                    holder->load(entry.id, entry.filename);
+            }
+        }
+        first.finishAllLoads();
+        second.finishAllLoads();
+        std::uint32_t expected = first.get(0).checksum;
+        if(second.get(0).checksum != expected || second.get(sNumIdsPerFile - 1).checksum != expected)
+        {
+            std::printf("Mismatch between the ids of one file\n");
+            passed = false;
+        }
+        return first.getStatistics().residentBytes + second.getStatistics().residentBytes;
+    }
+}
+
+
+int main()
+{
+    bool passed = true;
+    for(int file = 0; file < sNumFiles; ++file)
+    {
+        std::vector<char> data(sFileSize);
+        std::uint32_t state = 12345u + static_cast<std::uint32_t>(file < sNumFiles - sNumCopies ? file : file - (sNumFiles - sNumCopies));
+        for(char& byte : data)
+        {
+            state = state * 1664525u + 1013904223u;
+            byte = static_cast<char>(state >> 24);
+        }
+        std::ofstream(getFilename(file), std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    std::string suffix = " (" + std::to_string(sNumFiles) + " files, " + std::to_string(sNumIdsPerFile) + " ids each, 2 holders)";
+    benchmark::print(benchmark::measure("load without cache" + suffix, 5, [&]()
+    {
+        Holder first, second;
+        loadBoth(first, second, nullptr, passed);
+    }));
+
+    ResourceCache<Resource>::Statistics statistics;
+    std::size_t residentBytes = 0;
+    std::size_t bytesSaved = 0;
+    benchmark::print(benchmark::measure("load with path cache" + suffix, 5, [&]()
+    {
+        ResourceCache<Resource> cache;
+        Holder first, second;
+        first.setCache(&cache);
+        second.setCache(&cache);
+        residentBytes = loadBoth(first, second, nullptr, passed);
+        bytesSaved = cache.getResidentBytesSaved();
+        statistics = cache.getStatistics();
+        if(&first.get(0) != &second.get(1))
+        {
+            std::printf("Duplicate not shared by the path cache\n");
+            passed = false;
+        }
+    }));
+    std::printf("    %s; %zu KiB counted by the holders, %zu KiB of it shared\n", toString(statistics).c_str(), residentBytes / 1024, bytesSaved / 1024);
+
+    benchmark::print(benchmark::measure("load with content cache" + suffix, 5, [&]()
+    {
+        ResourceCache<Resource> cache(ResourceCache<Resource>::KeyMode::Contents);
+        Holder first, second;
+        first.setCache(&cache);
+        second.setCache(&cache);
+        loadBoth(first, second, nullptr, passed);
+        statistics = cache.getStatistics();
+        if(&first.get(0) != &second.get((sNumFiles - sNumCopies) * sNumIdsPerFile))
+        {
+            std::printf("Copy not shared by the content cache\n");
+            passed = false;
+        }
+    }));
+    std::printf("    %s\n", toString(statistics).c_str());
+
+    ThreadPool threadPool(4);
+    benchmark::print(benchmark::measure("loadManifest without cache" + suffix, 5, [&]()
+    {
+        Holder first, second;
+        loadBoth(first, second, &threadPool, passed);
+    }));
+    benchmark::print(benchmark::measure("loadManifest with path cache" + suffix, 5, [&]()
+    {
+        ResourceCache<Resource> cache;
+        Holder first, second;
+        first.setCache(&cache);
+        second.setCache(&cache);
+        loadBoth(first, second, &threadPool, passed);
+        statistics = cache.getStatistics();
+        if(statistics.numLoads != static_cast<std::uint64_t>(sNumFiles))
+        {
+            std::printf("Concurrent requests for one file were not merged into one load\n");
+            passed = false;
+        }
+    }));
+    std::printf("    %s\n", toString(statistics).c_str());
+
+    for(int file = 0; file < sNumFiles; ++file)
+        std::remove(getFilename(file).c_str());
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include "Benchmark.h"
+#include "ResourceHolder.h"
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+//Compares get() on the former std::map storage against ResourceHolder's handles, integer ids and dense enum ids.
+namespace
+{
+    const int sNumResources = 512;
+    const int sNumLookups = 1000000;
+
+
+    //Stands in for a texture, without needing files or a graphics context.
+    struct Resource
+    {
+        bool loadFromFile(const std::string& filename)
+        {
+            value = static_cast<int>(filename.size());
+            return true;
+        }
+
+        int value;
+    };
+
+
+    enum class DenseId
+    {
+        First,
+        Count = sNumResources
+    };
+}
+
+
+int main()
+{
+    std::map<int, std::unique_ptr<Resource>> resourceMap;
+    ResourceHolder<int, Resource> intHolder;
+    ResourceHolder<DenseId, Resource> enumHolder;
+    std::vector<ResourceHolder<int, Resource>::Handle> handles;
+    for(int id = 0; id < sNumResources; ++id)
+    {
+        std::string filename(id % 61, 'x');
+        resourceMap[id].reset(new Resource());
+        resourceMap[id]->loadFromFile(filename);
+        handles.push_back(intHolder.load(id, filename));
+        enumHolder.load(static_cast<DenseId>(id), filename);
+    }
+
+    //Pseudo-random but reproducible lookups, so that every container sees the same access pattern.
+    std::vector<std::uint32_t> lookups(sNumLookups);
+    std::uint32_t state = 12345;
+    for(auto& lookup : lookups)
+    {
+        state = state * 1664525u + 1013904223u;
+        lookup = (state >> 8) % sNumResources;
+    }
+
+    long long mapSum = 0;
+    benchmark::print(benchmark::measure("get, std::map of unique_ptr", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+            mapSum += resourceMap.find(static_cast<int>(lookup))->second->value;
+    }));
+    long long idSum = 0;
+    benchmark::print(benchmark::measure("ResourceHolder::get(int id)", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+            idSum += intHolder.get(static_cast<int>(lookup)).value;
+    }));
+    long long handleSum = 0;
+    benchmark::print(benchmark::measure("ResourceHolder::get(Handle)", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+            handleSum += intHolder.get(handles[lookup]).value;
+    }));
+    long long enumSum = 0;
+    benchmark::print(benchmark::measure("ResourceHolder::get(enum id)", 10, [&]()
+    {
+        for(std::uint32_t lookup : lookups)
+            enumSum += enumHolder.get(static_cast<DenseId>(lookup)).value;
+    }));
+
+    if(idSum != mapSum || handleSum != mapSum || enumSum != mapSum)
+    {
+        std::printf("Mismatch between std::map and ResourceHolder\n");
+        return 1;
+    }
+    return 0;
+}
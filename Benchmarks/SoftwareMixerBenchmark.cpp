@@ -0,0 +1,120 @@
+#include "Benchmark.h"
+#include "SoftwareMixer.h"
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+//Measures SoftwareMixer::mix() for one 1024-frame block against the number of mono and of stereo voices, for each
+//kernel the CPU supports, and checks that the kernels produce the same mix.  Runs headless: the stream is never played.
+namespace
+{
+    const unsigned sSampleRate = 44100;
+    const std::size_t sBlockSize = 1024;
+    const int sNumBlocks = 40;
+
+
+    //Stereo buffers play the tone a fifth higher on the right, so that swapped channels show up as a mismatch.
+    void fillBuffer(sf::SoundBuffer& buffer, unsigned sampleRate, float frequency, unsigned channelCount)
+    {
+        //Long enough that no voice ends during the measurement, even at the highest pitch.
+        std::vector<sf::Int16> samples(sampleRate * 4 * channelCount);
+        for(std::size_t i = 0; i < samples.size(); ++i)
+        {
+            double channelFrequency = i % channelCount == 0 ? frequency : frequency * 1.5;
+            samples[i] = static_cast<sf::Int16>(8000.0 * std::sin(6.283185307 * channelFrequency * (i / channelCount) / sampleRate));
+        }
+        buffer.loadFromSamples(samples.data(), samples.size(), channelCount, sampleRate);
+    }
+
+
+    //Some of the buffers need resampling.
+    std::vector<sf::SoundBuffer> makeBuffers(unsigned channelCount)
+    {
+        std::vector<sf::SoundBuffer> buffers(4);
+        fillBuffer(buffers[0], sSampleRate, 440.0f, channelCount);
+        fillBuffer(buffers[1], sSampleRate, 660.0f, channelCount);
+        fillBuffer(buffers[2], 22050, 330.0f, channelCount);
+        fillBuffer(buffers[3], 48000, 550.0f, channelCount);
+        return buffers;
+    }
+
+
+    //Half of the voices play unpitched and the rest at assorted pitches.
+    void startVoices(SoftwareMixer& mixer, const std::vector<sf::SoundBuffer>& buffers, int numVoices)
+    {
+        for(int i = 0; i < numVoices; ++i)
+        {
+            float pitch = i % 2 == 0 ? 1.0f : 0.5f + (i % 7) * 0.15f;
+            mixer.playSound(buffers[i % buffers.size()], 5.0f, pitch, (i % 21) / 10.0f - 1.0f);
+        }
+    }
+
+
+    const char* getKernelName(SoftwareMixer::Kernel kernel)
+    {
+        switch(kernel)
+        {
+            case SoftwareMixer::Kernel::Scalar: return "scalar";
+            case SoftwareMixer::Kernel::SSE2: return "SSE2";
+            case SoftwareMixer::Kernel::AVX2: return "AVX2";
+        }
+        return "";
+    }
+}
+
+
+int main()
+{
+    const SoftwareMixer::Kernel kernels[] = {SoftwareMixer::Kernel::Scalar, SoftwareMixer::Kernel::SSE2, SoftwareMixer::Kernel::AVX2};
+    double blockMicroseconds = 1e6 * sBlockSize / sSampleRate;
+    std::vector<sf::Int16> output(sBlockSize * 2);
+    bool passed = true;
+    for(unsigned channelCount : {1u, 2u})
+    {
+        std::vector<sf::SoundBuffer> buffers = makeBuffers(channelCount);
+        const char* channels = channelCount == 1 ? "mono" : "stereo";
+        for(int numVoices : {64, 256, 1024, 4096})
+        {
+            std::vector<sf::Int16> referenceOutput;
+            for(SoftwareMixer::Kernel kernel : kernels)
+            {
+                if(SoftwareMixer::isKernelSupported(kernel) == false)
+                    continue;
+                SoftwareMixer mixer(4096, sSampleRate, sBlockSize);
+                mixer.setKernel(kernel);
+                startVoices(mixer, buffers, numVoices);
+
+                std::string name = std::string("SoftwareMixer::mix ") + getKernelName(kernel) + " (" + std::to_string(numVoices) + " " + channels + " voices)";
+                benchmark::Result result = benchmark::measure(name, sNumBlocks, [&]()
+                {
+                    mixer.mix(output.data(), sBlockSize);
+                });
+                benchmark::print(result);
+                std::printf("  %.2f%% of the block's %.0f us of playback\n", 100.0 * result.medianMicroseconds / blockMicroseconds, blockMicroseconds);
+
+                //Every kernel saw the same voices for the same number of blocks, so the last blocks must agree
+                //up to the rounding of single precision positions.
+                if(referenceOutput.empty())
+                {
+                    referenceOutput = output;
+                    continue;
+                }
+                for(std::size_t i = 0; i < output.size(); ++i)
+                {
+                    if(std::abs(output[i] - referenceOutput[i]) > numVoices / 16 + 2)
+                    {
+                        std::printf("Mismatch between the %s kernel and the scalar kernel at sample %zu\n", getKernelName(kernel), i);
+                        passed = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return passed ? 0 : 1;
+}
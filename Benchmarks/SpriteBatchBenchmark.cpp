@@ -0,0 +1,139 @@
+#include "AnimatedSprite.h"
+#include "AnimationSystem.h"
+#include "Benchmark.h"
+#include "SpriteBatch.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+//Measures SpriteBatch::update(), which only rewrites changed quads, against rebuilding every quad each frame.
+//Runs headless: no texture is ever created on the GPU and nothing is drawn.  Also checks that a sprite
+//removed from the AnimationSystem drops out of the batch, even when a new sprite reuses its id.
+namespace
+{
+    const int sNumTextures = 8;
+    const int sNumFrames = 60;
+    const sf::Time sDeltaTime = sf::microseconds(16667);
+
+
+    void buildAnimations()
+    {
+        AnimatedSprite::sAnimations.assign(1, AnimatedSprite::AnimationSequenceSet(4));
+        for(int animation = 0; animation < 4; ++animation)
+        {
+            for(int frame = 0; frame < 8; ++frame)
+                AnimatedSprite::sAnimations[0][animation].push_back(sf::IntRect(frame * 32, animation * 32, 32, 32));
+        }
+        AnimatedSprite::sAnimationTable.build(AnimatedSprite::sAnimations);
+    }
+
+
+    bool checkReusedIds()
+    {
+        sf::Texture texture;
+        AnimationSystem system;
+        SpriteBatch batch(system);
+        AnimationSystem::SpriteId removed = system.addSprite(0);
+        AnimationSystem::SpriteId kept = system.addSprite(0);
+        system.setContinuouslyLoopingAnimation(removed, 0, sf::milliseconds(50));
+        system.setContinuouslyLoopingAnimation(kept, 1, sf::milliseconds(50));
+        batch.addSprite(removed, texture);
+        batch.addSprite(kept, texture);
+        batch.update();
+
+        //The new sprite takes over the removed sprite's id, but not its quad.
+        system.removeSprite(removed);
+        AnimationSystem::SpriteId reused = system.addSprite(0);
+        system.setContinuouslyLoopingAnimation(reused, 2, sf::milliseconds(50));
+        bool unbatched = reused == removed && !batch.contains(reused) && batch.contains(kept);
+        system.update(sDeltaTime);
+        batch.update();
+        unbatched = unbatched && batch.getVertices(0).size() == 6 && !batch.contains(reused);
+
+        batch.addSprite(reused, texture);
+        batch.update();
+        const std::vector<sf::Vertex>& vertices = batch.getVertices(0);
+        bool rebatched = vertices.size() == 12 && batch.contains(reused)
+                         && vertices[0].texCoords.y == system.getTextureRect(kept).top
+                         && vertices[6].texCoords.y == system.getTextureRect(reused).top;
+        if(!unbatched || !rebatched)
+        {
+            std::printf("Mismatch: SpriteBatch kept the quad of a removed sprite whose id was reused\n");
+            return false;
+        }
+        return true;
+    }
+
+
+    bool benchmarkSpriteCount(int numSprites)
+    {
+        std::vector<sf::Texture> textures(sNumTextures);
+        AnimationSystem system;
+        SpriteBatch batch(system);
+        std::vector<sf::Transform> transforms;
+        for(int i = 0; i < numSprites; ++i)
+        {
+            AnimationSystem::SpriteId id = system.addSprite(0);
+            system.setContinuouslyLoopingAnimation(id, i % 4, sf::milliseconds(50 + i % 11 * 10));
+            transforms.push_back(sf::Transform().translate(static_cast<float>(i % 1000), static_cast<float>(i / 1000)));
+            batch.addSprite(id, textures[i % sNumTextures], transforms.back());
+        }
+        batch.update();
+
+        std::size_t numQuadsRewritten = 0;
+        std::string suffix = " (" + std::to_string(numSprites) + " sprites)";
+        benchmark::print(benchmark::measure("SpriteBatch::update changed quads" + suffix, sNumFrames, [&]()
+        {
+            system.update(sDeltaTime);
+            batch.update();
+            numQuadsRewritten += batch.getNumQuadsRewritten();
+        }));
+
+        //Spot check that the batched quads match the sprites' current frames.
+        for(int i = 0; i < numSprites; i += 997)
+        {
+            const sf::Vertex& topLeft = batch.getVertices(i % sNumTextures)[(i / sNumTextures) * 6];
+            if(topLeft.texCoords.x != system.getTextureRect(i).left || topLeft.texCoords.y != system.getTextureRect(i).top)
+            {
+                std::printf("Mismatch between SpriteBatch and AnimationSystem for sprite %d\n", i);
+                return false;
+            }
+        }
+
+        //The per-sprite alternative: recompute every quad from scratch, as a draw per sf::Sprite effectively does.
+        std::vector<sf::Vertex> vertices(numSprites * 6);
+        benchmark::print(benchmark::measure("Rebuild all quads" + suffix, sNumFrames, [&]()
+        {
+            system.update(sDeltaTime);
+            for(int i = 0; i < numSprites; ++i)
+            {
+                const sf::IntRect& rect = system.getTextureRect(i);
+                sf::Vertex* quad = &vertices[i * 6];
+                quad[0] = sf::Vertex(transforms[i].transformPoint(0.0f, 0.0f), sf::Vector2f(float(rect.left), float(rect.top)));
+                quad[1] = sf::Vertex(transforms[i].transformPoint(float(rect.width), 0.0f), sf::Vector2f(float(rect.left + rect.width), float(rect.top)));
+                quad[2] = sf::Vertex(transforms[i].transformPoint(0.0f, float(rect.height)), sf::Vector2f(float(rect.left), float(rect.top + rect.height)));
+                quad[3] = quad[2];
+                quad[4] = quad[1];
+                quad[5] = sf::Vertex(transforms[i].transformPoint(float(rect.width), float(rect.height)), sf::Vector2f(float(rect.left + rect.width), float(rect.top + rect.height)));
+            }
+        }));
+        std::printf("  %zu draw calls instead of %d, %.1f%% of quads rewritten per frame\n", batch.getNumBatches(), numSprites,
+                    100.0 * numQuadsRewritten / (double(numSprites) * sNumFrames));
+        return true;
+    }
+}
+
+
+int main()
+{
+    buildAnimations();
+    if(checkReusedIds() == false)
+        return 1;
+    for(int numSprites : {1000, 10000, 100000})
+    {
+        if(benchmarkSpriteCount(numSprites) == false)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#ifndef AnimatedSprite_h
+#define AnimatedSprite_h
+
+
+
+#include "AnimationTable.h"
+#include "SmallFunction.h"
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/System/Time.hpp>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+A sprite class that offers animation capabilities by allowing the underlying sprite's
+texture to change over time.  A single animation is called an animationSequence, which
+is a sequence of the locations in a texture that the sprite will cycle through each
+animation frame.  An entity may have many animationSequences (e.g. run, jump, etc.)
+and these are grouped together in an AnimationSequenceSet.  AnimatedSprite 
+contains a static pointer to a vector of all AnimationSequenceSets, called sAnimations, 
+allowing all AnimatedSprite objects to access any AnimationSequence.  sAnimations is 
+implemented as a doubly-nested vector, so each level of access(Object, Animation, Frame) is 
+accessed via an integer or enum.  sAnimations is only the editable form; at runtime 
+the sprites read their frames from sAnimationTable, a flattened copy that is either 
+built from sAnimations via sAnimationTable.build(sAnimations) or loaded from a file.
+If the table is still empty when the first sprite is constructed, it is built from
+sAnimations and sFrameDurations then, so code that only fills sAnimations keeps
+working.  Later edits to sAnimations are not picked up until the table is rebuilt,
+and rebuilding or reloading the table invalidates the animations of existing sprites.
+Frames either all last a fixed timePerFrame or, when no timePerFrame is given, last
+the durations stored in the table (see sFrameDurations).  Time left over after a
+frame change carries over, and update() may cross any number of frames and loops.
+----------------------------------------------------------------------------------*/
+class AnimatedSprite : public sf::Sprite
+{
+public:
+    enum CallbackConditions{  //bitflags specifying when the callback is called
+        Never = 0,
+        EachLoopEnd = 1, //at the end of each animation loop
+        AnimationCompletion = 2, //at the end of all animation loops
+        AnimationSwitch = 4 //if a new animation is set
+    };
+
+    using AnimationSequence = std::vector<sf::IntRect>;
+    using AnimationSequenceSet = std::vector<AnimationSequence>;
+    using FrameDurations = std::vector<sf::Time>; //one per frame of the matching AnimationSequence
+    using FrameDurationSet = std::vector<FrameDurations>;
+    //Stores lambdas capturing up to four pointers without allocating.
+    using Callback = SmallFunction<void()>;
+    static std::vector<AnimationSequenceSet> sAnimations;
+    //Optional, same nesting as sAnimations.  Pass to sAnimationTable.build() along with sAnimations.
+    static std::vector<FrameDurationSet> sFrameDurations;
+    static AnimationTable sAnimationTable;
+
+
+public:
+    //Build sAnimationTable from sAnimations and sFrameDurations unless it already holds a table.
+    //Sprites and AnimationSystem::addSprite() call this, so it only needs calling explicitly to 
+    //control when the table is built.
+    static void buildAnimationTableIfEmpty();
+
+    AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId);
+    AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId, const sf::Texture& texture);
+    AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId, const sf::Texture& texture, const sf::IntRect& textureSubRectangle);
+        
+    void setAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, unsigned numLoops, CallbackConditions callbackConditions = Never, Callback callback = [](){});
+    void setContinuouslyLoopingAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, CallbackConditions callbackConditions = Never, Callback callback = [](){});
+    //Same as above, but each frame lasts the duration stored for it in sAnimationTable.
+    void setAnimation(std::vector<AnimationSequence>::size_type animationId, unsigned numLoops, CallbackConditions callbackConditions = Never, Callback callback = [](){});
+    void setContinuouslyLoopingAnimation(std::vector<AnimationSequence>::size_type animationId, CallbackConditions callbackConditions = Never, Callback callback = [](){});
+    //Update the elapsed time, and possibly update the sprite's texture rect.  Runs in constant time
+    //(logarithmic in the number of frames for stored durations), plus one callback per loop end crossed.
+    //Return true if the animation is finished; otherwise false.
+    bool update(sf::Time deltaTime);
+    //Manually call the callback.
+    void executeCallback();
+    
+    
+private:
+    void beginAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, unsigned numLoops, bool continuouslyLooping, CallbackConditions callbackConditions, Callback&& callback);
+    std::uint32_t getFrameAt(sf::Time elapsedLoopTime) const;
+    
+    
+private:
+    std::vector<AnimationSequenceSet>::size_type mObjectId;  //used to access the proper element in the sAnimations vector
+    const sf::IntRect* mCurrentSequence;  //frames of the current animation in sAnimationTable
+    const std::uint32_t* mCurrentFrameEndTimes;
+    std::uint32_t mNumFrames;
+    std::uint32_t mCurrentFrame;
+    sf::Time mTimePerFrame;  //zero when the frame durations come from sAnimationTable
+    sf::Time mLoopDuration;
+    sf::Time mElapsedLoopTime;  //time since the start of the current loop
+    bool mContinuouslyLooping;
+    bool mFinished;
+    unsigned mNumLoopsRemaining;
+    Callback mCallback;
+    CallbackConditions mCallbackConditions;
+};
+
+
+
+#endif
\ No newline at end of file
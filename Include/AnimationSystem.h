@@ -0,0 +1,176 @@
+#ifndef AnimationSystem_h
+#define AnimationSystem_h
+
+
+
+#include "AnimatedSprite.h"
+#include "MemoryResource.h"
+#include "ThreadPool.h"
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Data-oriented counterpart of AnimatedSprite for scenes with many animated entities.
+Animation state is stored as a structure of arrays rather than one object per
+sprite, so update() advances every animation in a single pass over contiguous
+memory.  Sprites are addressed by a SpriteId that stays valid until the sprite is
+removed; internally the state is kept densely packed by swapping removed entries
+with the last one.  Frames come from AnimatedSprite::sAnimationTable and callbacks
+follow AnimatedSprite::CallbackConditions, but callbacks are deferred until the
+whole pass has finished, so they may safely add, remove or re-animate sprites.
+The pass can also be split across a ThreadPool; workers only record callback
+events into per-chunk buffers, which are merged in chunk order and dispatched on
+the calling thread, so the results and callback order match the single-threaded
+update exactly.  Like AnimatedSprite, frames last either a fixed timePerFrame or the
+durations stored in the table, and any deltaTime is resolved in constant or
+logarithmic time per sprite whose frame changes, with the remainder carried over.
+Sprites that are culled can be made dormant: update() skips them entirely and only
+the time they went dormant is recorded.  Their exact frame is computed on demand
+when queried, and when they wake they catch up in one step, queuing the callbacks
+that came due meanwhile according to the LazyCallbackPolicy.  Awake sprites are kept
+in front of dormant ones, so the cost of update() scales with the awake sprites.
+----------------------------------------------------------------------------------*/
+class AnimationSystem : sf::NonCopyable
+{
+public:
+    using SpriteId = std::uint32_t;
+    using CallbackConditions = AnimatedSprite::CallbackConditions;
+    using ObjectId = std::vector<AnimatedSprite::AnimationSequenceSet>::size_type;
+    using AnimationId = std::vector<AnimatedSprite::AnimationSequence>::size_type;
+    using Callback = AnimatedSprite::Callback;
+    template<typename T_Value>
+    using Vector = std::vector<T_Value, PolymorphicAllocator<T_Value>>;
+    //How the callbacks that came due while a sprite was dormant are delivered once it wakes.
+    enum class LazyCallbackPolicy{
+        DeliverAll, //every callback, in the order an awake sprite would have received them
+        Coalesce //at most one loop end callback and one completion callback
+    };
+
+
+public:
+    //Every container of the system allocates from memoryResource, which must outlive it.
+    explicit AnimationSystem(MemoryResource* memoryResource = MemoryResource::getDefault());
+    SpriteId addSprite(ObjectId objectId);
+    void removeSprite(SpriteId id);
+    bool contains(SpriteId id) const;
+    //Increases whenever the id is freed, so that an id and its generation keep naming one sprite after the id is reused.
+    std::uint32_t getGeneration(SpriteId id) const;
+    bool hasAnimation(SpriteId id) const;
+    std::size_t getSpriteCount() const;
+    //Reserve storage for the given number of sprites to avoid reallocation while adding them.
+    void reserve(std::size_t numSprites);
+
+    void setAnimation(SpriteId id, AnimationId animationId, sf::Time timePerFrame, unsigned numLoops, CallbackConditions callbackConditions = AnimatedSprite::Never, Callback callback = [](){});
+    void setContinuouslyLoopingAnimation(SpriteId id, AnimationId animationId, sf::Time timePerFrame, CallbackConditions callbackConditions = AnimatedSprite::Never, Callback callback = [](){});
+    //Same as above, but each frame lasts the duration stored for it in AnimatedSprite::sAnimationTable.
+    void setAnimation(SpriteId id, AnimationId animationId, unsigned numLoops, CallbackConditions callbackConditions = AnimatedSprite::Never, Callback callback = [](){});
+    void setContinuouslyLoopingAnimation(SpriteId id, AnimationId animationId, CallbackConditions callbackConditions = AnimatedSprite::Never, Callback callback = [](){});
+    //Advance every animation by deltaTime, then run the callbacks whose conditions were met.
+    void update(sf::Time deltaTime);
+    //Same as update(), but the pass is split across the pool's threads.  Callbacks still run on the calling thread.
+    void update(sf::Time deltaTime, ThreadPool& threadPool);
+    //Dormant sprites are not updated.  Waking a sprite brings it up to date, and its pending callbacks
+    //are dispatched by the next update().
+    void setDormant(SpriteId id, bool dormant);
+    bool isDormant(SpriteId id) const;
+    std::size_t getAwakeSpriteCount() const;
+    void setLazyCallbackPolicy(LazyCallbackPolicy policy);
+    //For dormant sprites, isFinished() and getTextureRect() compute the current state without waking the sprite.
+    bool isFinished(SpriteId id) const;
+    const sf::IntRect& getTextureRect(SpriteId id) const;
+    //Sprites whose texture rect changed in the last update() or since, e.g. by setAnimation() or waking up, and
+    //sprites removed since.  May contain duplicates and ids that were reused since.
+    const Vector<SpriteId>& getChangedSprites() const;
+    //Manually call the callback.
+    void executeCallback(SpriteId id);
+
+
+private:
+    enum Flags : std::uint8_t{
+        HasAnimation = 1,
+        ContinuouslyLooping = 2,
+        Finished = 4,
+        Dormant = 8
+    };
+
+    struct CallbackEvent
+    {
+        SpriteId id;
+        std::uint32_t generation;  //of the id when the event was queued
+        CallbackConditions condition;
+        std::uint64_t count;  //number of times the callback is due, e.g. several loop ends in one update
+    };
+
+    struct PlaybackPosition
+    {
+        std::int64_t elapsedMicroseconds;
+        std::int64_t frameEndMicroseconds;
+        std::uint32_t frame;
+        unsigned loopsRemaining;
+        std::uint64_t numLoopEnds;  //loop ends crossed to get here, including the final one if finished
+        bool finished;
+    };
+
+
+private:
+    std::uint32_t denseIndex(SpriteId id) const;
+    void beginAnimation(std::uint32_t index, AnimationId animationId, sf::Time timePerFrame, unsigned numLoops, bool continuouslyLooping, CallbackConditions callbackConditions, Callback&& callback);
+    void advanceRange(std::size_t begin, std::size_t end, std::int64_t deltaMicroseconds, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites);
+    //Bring the frame of a sprite whose current frame has ended up to date with its elapsed time.
+    void resolveFrame(std::uint32_t index, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites);
+    //Where the sprite would be after deltaMicroseconds more, without modifying it.
+    PlaybackPosition computePosition(std::uint32_t index, std::int64_t deltaMicroseconds) const;
+    void applyPosition(std::uint32_t index, const PlaybackPosition& position, bool coalesceCallbacks, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites);
+    void forgetReportedChanges();
+    void swapEntries(std::uint32_t first, std::uint32_t second);
+    //Call the sprite's callback, which may re-animate or remove its own sprite and add others.
+    void runCallback(SpriteId id);
+    void dispatchCallbacks();
+
+
+private:
+    static const std::uint32_t sInvalidIndex = 0xFFFFFFFF;
+    //Below this many sprites per chunk, the cost of waking workers outweighs the gain.
+    static const std::size_t sMinSpritesPerChunk = 4096;
+
+    //Per-sprite state, indexed by dense index.  Indices below mNumAwake belong to awake sprites.
+    Vector<SpriteId> mSpriteIds;
+    Vector<ObjectId> mObjectIds;
+    Vector<const sf::IntRect*> mFirstFrames;  //first rect of the current animation in sAnimationTable
+    Vector<const std::uint32_t*> mFrameEndTimes;
+    Vector<std::uint32_t> mFrameCounts;
+    Vector<std::uint32_t> mFrameIndices;
+    Vector<std::int64_t> mElapsedMicroseconds;  //time since the start of the current loop
+    Vector<std::int64_t> mFrameEndMicroseconds;  //elapsed time at which the current frame ends
+    Vector<std::int64_t> mMicrosecondsPerFrame;  //zero when the frame durations come from the table
+    Vector<std::int64_t> mLoopMicroseconds;
+    Vector<std::int64_t> mRunningMasks;  //all bits set while the animation is running, otherwise zero
+    Vector<unsigned> mLoopsRemaining;
+    Vector<std::uint8_t> mFlags;
+    Vector<std::uint8_t> mCallbackConditions;
+    Vector<std::uint8_t> mFrameDue;  //scratch space written by the first pass of update()
+    Vector<std::int64_t> mDormantSince;  //value of mClockMicroseconds when the sprite went dormant
+    Vector<Callback> mCallbacks;
+
+    //SpriteId to dense index mapping.
+    Vector<std::uint32_t> mDenseIndices;
+    Vector<std::uint32_t> mIdGenerations;  //bumped when an id is freed
+    Vector<SpriteId> mFreeIds;
+    Vector<CallbackEvent> mPendingCallbacks;
+    Vector<Vector<CallbackEvent>> mChunkCallbacks;
+    Vector<SpriteId> mChangedSprites;
+    std::size_t mNumReportedChanges;  //leading entries of mChangedSprites that the last update() reported
+    Vector<Vector<SpriteId>> mChunkChanges;
+    std::uint32_t mNumAwake;
+    std::int64_t mClockMicroseconds;  //total time passed to update()
+    LazyCallbackPolicy mLazyCallbackPolicy;
+};
+
+
+
+#endif
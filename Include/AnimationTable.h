@@ -0,0 +1,119 @@
+#ifndef AnimationTable_h
+#define AnimationTable_h
+
+
+
+#include "MappedFile.h"
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Immutable, flattened form of the nested AnimationSequenceSet vectors.  All frames
+of all objects live in one contiguous rect array; each animation is a Sequence
+(offset and length into that array), and each object is a range of Sequences.
+A frame lookup by objectId and animationId is therefore two array indexings into
+contiguous memory.  Next to the rects, each frame optionally stores the time at which
+it ends relative to the start of its sequence (a prefix sum of the frame durations),
+so the frame shown at any point in a loop is found with a binary search.  Each object
+also records the index of the texture page holding its frames, for atlases that span
+several textures.  The in-memory layout is identical to the file layout, so a saved
+table is loaded by memory-mapping the file and pointing into it, with no parsing or
+per-animation allocations.  Files are written in the host's byte order.
+----------------------------------------------------------------------------------*/
+class AnimationTable : sf::NonCopyable
+{
+public:
+    struct Sequence
+    {
+        std::uint32_t firstFrame;  //index into the frame array
+        std::uint32_t numFrames;
+    };
+    //Same nesting as AnimatedSprite::sAnimations: Object, Animation, Frame.
+    using NestedAnimations = std::vector<std::vector<std::vector<sf::IntRect>>>;
+    using NestedFrameDurations = std::vector<std::vector<std::vector<sf::Time>>>;
+
+
+public:
+    static const std::uint32_t sMaxLoopMicroseconds = 0xFFFFFFFF;
+
+
+public:
+    AnimationTable();
+    //Replace the contents of the table with a flattened copy of animations.  frameDurations may be
+    //empty, or cover only some sequences; sequences without durations can only be played with a 
+    //fixed time per frame.  texturePages holds one page index per object, or is empty if all use page 0.
+    //End times are stored in 32 bits, so a sequence may last at most sMaxLoopMicroseconds (about 71 minutes).
+    void build(const NestedAnimations& animations, const NestedFrameDurations& frameDurations = NestedFrameDurations(), const std::vector<std::uint32_t>& texturePages = std::vector<std::uint32_t>());
+    bool saveToFile(const std::string& filename) const;
+    //Memory-map a file written by saveToFile().  Returns false if the file is missing or malformed.
+    bool loadFromFile(const std::string& filename);
+    //Copies the data, so the memory may be released afterwards.
+    bool loadFromMemory(const void* data, std::size_t sizeInBytes);
+    bool isEmpty() const;
+    std::size_t getNumObjects() const;
+    std::size_t getNumAnimations(std::size_t objectId) const;
+    //Index of the texture holding the object's frames.
+    std::uint32_t getTexturePage(std::size_t objectId) const;
+    std::size_t getNumFrames() const;
+    const Sequence& getSequence(std::size_t objectId, std::size_t animationId) const;
+    //Pointer to the first of the sequence's frames; the rest follow contiguously.
+    const sf::IntRect* getFrames(const Sequence& sequence) const;
+    bool hasFrameDurations(const Sequence& sequence) const;
+    //Sum of the sequence's frame durations, or zero if it has none.
+    sf::Time getLoopDuration(const Sequence& sequence) const;
+    //Microseconds from the start of the sequence to the end of each of its frames.
+    const std::uint32_t* getFrameEndTimes(const Sequence& sequence) const;
+    //Index of the frame shown elapsedMicroseconds into a loop, in O(log numFrames).
+    static std::uint32_t findFrame(const std::uint32_t* frameEndTimes, std::uint32_t numFrames, std::int64_t elapsedMicroseconds);
+    //Wrap a playback position that has reached loopDuration back into the loop, in O(1).  Returns the
+    //number of loop ends crossed, consuming loopsRemaining unless continuouslyLooping.  If the final loop
+    //ends, finished is set, the count includes the final loop end and elapsedMicroseconds is clamped 
+    //to loopDuration.
+    static std::uint64_t wrapLoops(std::int64_t& elapsedMicroseconds, std::int64_t loopDuration, bool continuouslyLooping, unsigned& loopsRemaining, bool& finished);
+    
+private:
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t numObjects;
+        std::uint32_t numSequences;
+        std::uint32_t numFrames;
+    };
+
+    
+private:
+    //Point the accessors at a table image, checking that its sizes are consistent.
+    bool attach(const char* data, std::size_t sizeInBytes);
+    //Check that the object offsets and sequences only index within the image, and that each sequence's
+    //frame end times are sorted.
+    bool validate() const;
+    void clear();
+
+
+private:
+    static const std::uint32_t sVersion = 3;
+
+    //Owns the table image when it was built or copied from memory; otherwise the image lives in mMappedFile.
+    std::vector<char> mStorage;
+    MappedFile mMappedFile;
+    const char* mImage;
+    std::size_t mImageSize;
+    const FileHeader* mHeader;
+    const std::uint32_t* mObjectOffsets;  //numObjects + 1 entries, indexing mSequences
+    const std::uint32_t* mTexturePages;  //one per object
+    const Sequence* mSequences;
+    const sf::IntRect* mFrames;
+    const std::uint32_t* mFrameEndTimes;  //parallel to mFrames
+};
+
+
+
+#endif
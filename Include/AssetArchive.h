@@ -0,0 +1,104 @@
+#ifndef AssetArchive_h
+#define AssetArchive_h
+
+
+
+#include "MappedFile.h"
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Read-only archive of named assets in a single file, so that loading thousands of
+assets opens one file instead of thousands.  The file is a header, an index of
+entries sorted by name, the entry names, and the entry blobs, each aligned to
+sBlobAlignment bytes.  The archive is memory-mapped, finding an entry is a binary
+search of the index, and the data of an uncompressed entry is a pointer into the
+mapping, which can be handed straight to loadFromMemory().  Entries may instead
+be compressed with a small LZ77 block codec; those are decompressed into a buffer
+supplied by the caller.  Files are written in the host's byte order.  All const
+functions may be called from several threads at once.
+----------------------------------------------------------------------------------*/
+class AssetArchive : sf::NonCopyable
+{
+public:
+    enum Compression
+    {
+        Stored,
+        Lz
+    };
+
+    struct SourceEntry
+    {
+        std::string name;
+        std::vector<char> data;
+        Compression compression;
+    };
+
+    static const std::size_t NoEntry = static_cast<std::size_t>(-1);
+
+
+public:
+    AssetArchive();
+    //Write entries to an archive file.  Names must be unique.  Entries that don't shrink when compressed
+    //are stored uncompressed.
+    static bool write(const std::string& filename, const std::vector<SourceEntry>& entries);
+    //Memory-map an archive written by write().  Returns false if the file is missing or malformed.
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const;
+    std::size_t getNumEntries() const;
+    //Index of the named entry, or NoEntry, in O(log numEntries).
+    std::size_t find(const std::string& name) const;
+    std::string getName(std::size_t entry) const;
+    Compression getCompression(std::size_t entry) const;
+    //Size of the entry's data once decompressed.
+    std::size_t getSize(std::size_t entry) const;
+    //getSize(entry) bytes of entry data.  Uncompressed entries point into the mapping without copying and
+    //stay valid until the archive is closed; compressed ones are decompressed into buffer.  Returns
+    //nullptr if the compressed data is corrupt.
+    const char* getData(std::size_t entry, std::vector<char>& buffer) const;
+
+private:
+    struct FileHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t numEntries;
+        std::uint32_t namesSize;  //bytes of names following the index
+    };
+
+    struct IndexEntry
+    {
+        std::uint64_t offset;  //from the start of the file
+        std::uint64_t storedSize;
+        std::uint64_t size;
+        std::uint32_t nameOffset;  //into the names
+        std::uint16_t nameLength;
+        std::uint16_t compression;
+    };
+
+
+private:
+    const char* getNameData(const IndexEntry& entry) const;
+    //Check that the index, names and blobs lie within the file, that compressed sizes are achievable,
+    //and that the index is sorted.
+    bool validate() const;
+
+
+private:
+    static const std::uint32_t sVersion = 1;
+    static const std::size_t sBlobAlignment = 64;
+
+    MappedFile mMappedFile;
+    const FileHeader* mHeader;
+    const IndexEntry* mIndex;
+    const char* mNames;
+};
+
+
+
+#endif
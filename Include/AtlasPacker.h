@@ -0,0 +1,69 @@
+#ifndef AtlasPacker_h
+#define AtlasPacker_h
+
+
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Packs rectangles into as few fixed-size atlas pages as possible, using the MaxRects
+algorithm with the best-short-side-fit heuristic.  Rectangles are packed in groups,
+and a group always ends up on a single page, so that everything one object draws
+comes from one texture.  A group is tried on each existing page before a new page
+is opened.  Frames are never rotated, since a texture rect cannot express that.
+Only the sizes are packed; loading and copying the pixels is left to the caller.
+----------------------------------------------------------------------------------*/
+class AtlasPacker
+{
+public:
+    struct Placement
+    {
+        std::uint32_t page;
+        sf::IntRect rect;  //excluding the padding
+    };
+
+
+public:
+    //padding is the number of empty pixels kept to the right of and below each rectangle.
+    AtlasPacker(sf::Vector2u pageSize, unsigned padding);
+    //Place every rectangle of the group on the same page.  placements receives one entry per size, in
+    //the same order.  Returns false, placing nothing, if the group does not fit even on an empty page.
+    bool packGroup(const std::vector<sf::Vector2u>& sizes, std::vector<Placement>& placements);
+    std::size_t getNumPages() const;
+    //Smallest size that holds everything placed on the page, to which the page image can be cropped.
+    sf::Vector2u getUsedSize(std::size_t page) const;
+    //Packed rectangle area divided by the total used size of all pages.
+    double getEfficiency() const;
+
+
+private:
+    struct Page
+    {
+        std::vector<sf::IntRect> freeRects;  //maximal empty rectangles, which may overlap
+        sf::Vector2u usedSize;
+        std::uint64_t packedArea;
+    };
+
+
+private:
+    //Place the sizes in order of the given indices, updating page.  Returns false if one did not fit.
+    bool packOnPage(Page& page, const std::vector<sf::Vector2u>& sizes, const std::vector<std::size_t>& order, std::vector<Placement>& placements) const;
+    bool findPosition(const Page& page, int width, int height, sf::Vector2i& position) const;
+    void place(Page& page, const sf::IntRect& rect) const;
+    void pruneFreeRects(Page& page) const;
+
+
+private:
+    sf::Vector2u mPageSize;
+    unsigned mPadding;
+    std::vector<Page> mPages;
+};
+
+
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef FrameArena_h
+#define FrameArena_h
+
+
+
+#include "MemoryResource.h"
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+
+
+/*----------------------------------------------------------------------------------
+Monotonic MemoryResource for data that lives for one frame, like
+std::pmr::monotonic_buffer_resource.  Allocating bumps a pointer, deallocating does
+nothing, and reset() frees everything at once at the end of the frame.  A frame
+that overflows the current block continues in blocks taken from the upstream
+resource; the next reset() replaces them all with one block big enough for the
+whole frame, so once the arena has seen its largest frame it makes no upstream
+allocations.  Not thread safe; use one arena per thread.
+----------------------------------------------------------------------------------*/
+class FrameArena : public MemoryResource, sf::NonCopyable
+{
+public:
+    explicit FrameArena(std::size_t initialCapacity = 64 * 1024, MemoryResource* upstream = MemoryResource::getDefault());
+    ~FrameArena();
+    //Invalidates everything allocated since the last reset().
+    void reset();
+    //Bytes handed out since the last reset(), including alignment padding.
+    std::size_t getBytesUsed() const;
+    std::size_t getCapacity() const;
+    //Most bytes used in one frame, to size initialCapacity.
+    std::size_t getPeakBytesUsed() const;
+
+private:
+    struct Block
+    {
+        Block* previous;
+        std::size_t size;  //usable bytes following the header
+    };
+
+
+private:
+    void* doAllocate(std::size_t bytes, std::size_t alignment) override;
+    void doDeallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    void addBlock(std::size_t size);
+    void releaseBlocks();
+
+
+private:
+    MemoryResource* mUpstream;
+    Block* mCurrentBlock;  //the blocks of this frame, newest first
+    char* mPosition;
+    char* mEnd;
+    std::size_t mCapacity;  //of all blocks
+    std::size_t mBytesUsedInFullBlocks;
+    std::size_t mPeakBytesUsed;
+};
+
+
+
+#endif
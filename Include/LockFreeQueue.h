@@ -0,0 +1,54 @@
+#ifndef LockFreeQueue_h
+#define LockFreeQueue_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+
+/*----------------------------------------------------------------------------------
+Bounded lock-free queue for any number of producer and consumer threads (Dmitry
+Vyukov's bounded MPMC queue).  All slots are allocated by the constructor, so
+tryPush() and tryPop() never allocate or block; they fail instead when the queue is
+full or empty.  Each slot carries a sequence number that tells whether it is ready
+to be written or read in the current lap around the ring, so producers only contend
+on one atomic counter and consumers on another.
+----------------------------------------------------------------------------------*/
+template<typename T_Element>
+class LockFreeQueue : sf::NonCopyable
+{
+public:
+    //capacity must be a power of two.  T_Element must be default constructible.
+    explicit LockFreeQueue(std::size_t capacity);
+    //Returns false, leaving the queue unchanged, if it is full.
+    bool tryPush(const T_Element& element);
+    //Returns false if the queue is empty.
+    bool tryPop(T_Element& element);
+    std::size_t getCapacity() const;
+
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence;
+        T_Element element;
+    };
+
+
+private:
+    static const std::size_t sCacheLineSize = 64;
+
+    std::unique_ptr<Slot[]> mSlots;
+    const std::size_t mMask;
+    //On separate cache lines, so that producers and consumers do not invalidate each other's counter.
+    alignas(sCacheLineSize) std::atomic<std::size_t> mPushPosition;
+    alignas(sCacheLineSize) std::atomic<std::size_t> mPopPosition;
+};
+
+#include "LockFreeQueue.inl"
+
+
+#endif
@@ -0,0 +1,87 @@
+#include "LockFreeQueue.h"
+
+
+template<typename T_Element>
+const std::size_t LockFreeQueue<T_Element>::sCacheLineSize;
+
+
+template<typename T_Element>
+LockFreeQueue<T_Element>::LockFreeQueue(std::size_t capacity)
+:mSlots(new Slot[capacity]),
+mMask(capacity - 1),
+mPushPosition(0),
+mPopPosition(0)
+{
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0 && "LockFreeQueue::LockFreeQueue() requires a power of two capacity of at least 2");
+    for(std::size_t i = 0; i < capacity; ++i)
+        mSlots[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+template<typename T_Element>
+bool LockFreeQueue<T_Element>::tryPush(const T_Element& element)
+{
+    std::size_t position = mPushPosition.load(std::memory_order_relaxed);
+    Slot* slot;
+    while(true)
+    {
+        slot = &mSlots[position & mMask];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+        if(difference == 0)
+        {
+            //The slot is free in this lap; claim it unless another producer got there first.
+            if(mPushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            return false;  //the slot still holds an element from the previous lap
+        }
+        else
+        {
+            position = mPushPosition.load(std::memory_order_relaxed);
+        }
+    }
+    slot->element = element;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+
+template<typename T_Element>
+bool LockFreeQueue<T_Element>::tryPop(T_Element& element)
+{
+    std::size_t position = mPopPosition.load(std::memory_order_relaxed);
+    Slot* slot;
+    while(true)
+    {
+        slot = &mSlots[position & mMask];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+        if(difference == 0)
+        {
+            if(mPopPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+        {
+            return false;  //the slot has not been written in this lap yet
+        }
+        else
+        {
+            position = mPopPosition.load(std::memory_order_relaxed);
+        }
+    }
+    element = std::move(slot->element);
+    //Hand the slot back to producers for the next lap.
+    slot->sequence.store(position + mMask + 1, std::memory_order_release);
+    return true;
+}
+
+
+template<typename T_Element>
+std::size_t LockFreeQueue<T_Element>::getCapacity() const
+{
+    return mMask + 1;
+}
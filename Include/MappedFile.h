@@ -0,0 +1,39 @@
+#ifndef MappedFile_h
+#define MappedFile_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <string>
+
+
+/*----------------------------------------------------------------------------------
+Read-only memory mapping of a whole file.  The contents are paged in by the OS on
+first access, so opening a large file costs a few system calls rather than a read
+of the entire file.  The mapping stays valid until close() or destruction.
+----------------------------------------------------------------------------------*/
+class MappedFile : sf::NonCopyable
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    //Returns false if the file could not be opened or mapped.  Empty files cannot be mapped.
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const;
+    const char* getData() const;
+    std::size_t getSize() const;
+    
+private:
+    const char* mData;
+    std::size_t mSize;
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#endif
+};
+
+
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MemoryResource_h
+#define MemoryResource_h
+
+
+
+#include <cassert>
+#include <cstddef>
+
+
+/*----------------------------------------------------------------------------------
+Source of memory for the engine's containers, so that a game can decide where they
+allocate: the global heap by default, or a FrameArena or PoolResource.  The
+interface mirrors C++17's std::pmr::memory_resource, which the engine can't use
+while it targets C++14: containers take a PolymorphicAllocator, which forwards to
+a MemoryResource chosen at run time without changing the container's type.  Memory
+must be deallocated with the same size and alignment it was allocated with.
+----------------------------------------------------------------------------------*/
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() = default;
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+    void deallocate(void* pointer, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+    //Whether memory allocated from one can be deallocated by the other.
+    bool isEqual(const MemoryResource& other) const;
+    //Allocates with operator new, padding over-aligned requests.  The default resource unless setDefault() is called.
+    static MemoryResource* getNewDeleteResource();
+    //Used by engine classes and allocators constructed without a resource.
+    static MemoryResource* getDefault();
+    //Returns the previous default resource.  A null resource restores getNewDeleteResource().
+    static MemoryResource* setDefault(MemoryResource* resource);
+
+private:
+    virtual void* doAllocate(std::size_t bytes, std::size_t alignment) = 0;
+    virtual void doDeallocate(void* pointer, std::size_t bytes, std::size_t alignment) = 0;
+    virtual bool doIsEqual(const MemoryResource& other) const;
+};
+
+
+inline void* MemoryResource::allocate(std::size_t bytes, std::size_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two in MemoryResource::allocate()");
+    return doAllocate(bytes, alignment);
+}
+
+
+inline void MemoryResource::deallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+    doDeallocate(pointer, bytes, alignment);
+}
+
+
+//Standard allocator that allocates from a MemoryResource, like std::pmr::polymorphic_allocator.  Containers
+//keep their resource when copied, moved or swapped; copies of a container use the default resource.
+template<typename T_Value>
+class PolymorphicAllocator
+{
+public:
+    using value_type = T_Value;
+
+
+public:
+    PolymorphicAllocator()
+    :mResource(MemoryResource::getDefault())
+    {
+    }
+
+
+    PolymorphicAllocator(MemoryResource* resource)
+    :mResource(resource)
+    {
+    }
+
+
+    template<typename T_Other>
+    PolymorphicAllocator(const PolymorphicAllocator<T_Other>& other)
+    :mResource(other.getResource())
+    {
+    }
+
+
+    T_Value* allocate(std::size_t count)
+    {
+        return static_cast<T_Value*>(mResource->allocate(count * sizeof(T_Value), alignof(T_Value)));
+    }
+
+
+    void deallocate(T_Value* pointer, std::size_t count)
+    {
+        mResource->deallocate(pointer, count * sizeof(T_Value), alignof(T_Value));
+    }
+
+
+    PolymorphicAllocator select_on_container_copy_construction() const
+    {
+        return PolymorphicAllocator();
+    }
+
+
+    MemoryResource* getResource() const
+    {
+        return mResource;
+    }
+
+private:
+    MemoryResource* mResource;
+};
+
+
+template<typename T_First, typename T_Second>
+bool operator==(const PolymorphicAllocator<T_First>& first, const PolymorphicAllocator<T_Second>& second)
+{
+    return first.getResource() == second.getResource() || first.getResource()->isEqual(*second.getResource());
+}
+
+
+template<typename T_First, typename T_Second>
+bool operator!=(const PolymorphicAllocator<T_First>& first, const PolymorphicAllocator<T_Second>& second)
+{
+    return !(first == second);
+}
+
+
+
+#endif
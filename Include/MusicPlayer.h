@@ -3,27 +3,51 @@
 
 
 
-#include <SFML\System\NonCopyable.hpp>
-#include <SFML\System\Time.hpp>
+#include "MemoryResource.h"
+#include "MusicStream.h"
+#include "Profiler.h"
+#include "SongCache.h"
+#include "SongOrder.h"
+#include "SongTable.h"
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
 #include <map>
+#include <memory>
+#include <random>
 #include <stack>
 #include <stdexcept>
-#include <tuple>
+#include <string>
 #include <utility>
 #include <vector>
 
 
 /*----------------------------------------------------------------------------------
-A robust music player that stores Playlists and retrieves and plays them.  Playlists
-are moved to the MusicPlayer, not copied, so they should not be used outside of the 
-MusicPlayer after adding them. Due to the limit on the number of simultaneous Music 
-and sf::Sound instances, MusicPlayer uses only one Music instance.  The option 
-exists for saving the current music state in a stack when loading a new Playlist, 
-which allows the user to resume the previous Playlist once finished with the current 
-one.  update() must be called frequently to check if the current song has ended,
-at which point the function will play the next song.
+A robust music player that stores Playlists and retrieves and plays them.  Song
+paths are interned in a SongTable, so Playlists are stored as small SongIds and a
+path shared between them is stored once.  The playback order is a SongOrder seed,
+which makes shuffles reproducible.  The song that will play next is opened and its
+start decoded on a background thread, so changing songs does not wait on the disk.
+When it ends, the current song carries on into the next one in the same stream
+without a gap; if a crossfade is set, a second stream plays the next song only
+while the two overlap.  Songs are read whole into a SongCache and decoded from
+memory.  The option exists for saving the current music state in a stack when
+loading a new Playlist, which allows the user to resume the previous Playlist once
+finished with the current one; a saved state is a few bytes, and its song stays
+pinned in the SongCache, so resuming it costs no disk I/O.  Resuming a shuffled
+Playlist does take time linear in its length, since its order is rebuilt from the
+seed into SongOrder's reused buffer rather than saved.  update() must be called
+frequently to hand over between songs, unless it is driven by the wake callback and
+getNextUpdateDelay(), as ThreadedMusicPlayer does.
 ----------------------------------------------------------------------------------*/
 template<typename T_PlaylistId> //Key used to id the Playlists.
 class MusicPlayer : public sf::NonCopyable
@@ -32,56 +56,147 @@ public:
     enum class Status{Playing, Paused, SongStopped, PlaylistStopped, Empty};
 
     using Playlist = std::vector<std::string>; //Filenames of the comprising songs.
-    //The required information needed to cache and later retrieve a Playlist's state. 
-    using MusicState = std::tuple
-                        <std::vector<std::string*>, //Playlist 
-                        int, //Song position in Playlist
-                        sf::Time, //Elapsed time
-                        bool, //Looped Playlist or not.
-                        bool>; //Set to shuffle or not.
+    using SongId = SongTable::SongId;
+    //The required information needed to cache and later retrieve a Playlist's state.
+    struct MusicState
+    {
+        const std::vector<SongId>* playlist;  //a stored Playlist, which never moves
+        std::uint64_t seed;  //SongOrder seed of the current cycle, zero if not shuffled
+        int songPosition;
+        sf::Time elapsedTime;
+        bool looped;
+        bool pinned;  //song pinned in the SongCache or not
+    };
+
+    //Cumulative since construction or the last resetStatistics().
+    struct Statistics
+    {
+        std::size_t numUpdates{0};
+        sf::Time totalUpdateTime;  //time spent in update() on the calling thread
+        sf::Time maxUpdateTime;
+        std::size_t numSwitches{0};  //song changes started by a call or by update()
+        sf::Time lastSwitchTime;  //time the calling thread spent on the most recent song change
+        sf::Time maxSwitchTime;
+        std::size_t numGaplessSwitches{0};  //changes the stream's thread made without any call
+        std::size_t numCrossfades{0};
+        std::size_t numPrefetchMisses{0};  //songs the calling thread had to open itself
+    };
 
 public:
-    MusicPlayer();
+    //The player's containers allocate from memoryResource, which must outlive it.  Song data is held in the
+    //SongCache instead.
+    explicit MusicPlayer(MemoryResource* memoryResource = MemoryResource::getDefault());
     //Store Playlist for possible future retrieval
     void storePlaylist(const T_PlaylistId& id, Playlist&& playlist);
     //Volume is in the range 0-100
     float getVolume() const;
     void setVolume(float newVolume);
+    //Overlap between songs that end on their own.  Zero, the default, joins them without a gap instead.
+    void setCrossfade(sf::Time duration);
+    sf::Time getCrossfade() const;
     Status getMusicStatus() const;
-    //Check if song is finished and, if so, play the next song.  Should be called often.
+    //Hand over to the next song when the current one ends.  Should be called often.
     void update();
+    //How long update() may wait before it has something to do, provided it also runs whenever the wake
+    //callback is invoked.  Negative if nothing is due until then or until another call.
+    sf::Time getNextUpdateDelay() const;
+    //Invoked from other threads when a prefetch finishes or a stream needs attention.  Must be thread safe.
+    //Set while the player is Empty.
+    void setWakeCallback(std::function<void()> callback);
     void play();
     void pause();
     //Stop music and go to beginning of current song.
     void stopSong();
     //Stop music, shuffle Playlist if shuffle is on, and go to beginning of current Playlist.
     void stopPlaylist();
-    //Go to the next song in the Playlist, keeping previous status.
+    //Go to the next song in the Playlist, keeping previous status.  Finishes a crossfade in progress instead.
     void nextSong();
     void previousSong();
-    //Load a stored Playlist which will start with PlaylistStopped status.  Shuffles it if shuffle argument is true.
-    void loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic = false);
+    //Load a stored Playlist which will start with PlaylistStopped status.  Shuffles it if shuffle argument is true,
+    //with seed if it is nonzero, so that the same seed gives the same order on every run.
+    void loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic = false, std::uint64_t seed = 0);
+    //Seed of the current cycle's shuffle, zero if not shuffling.  Later cycles follow from it.
+    std::uint64_t getShuffleSeed() const;
     int getNumSavedPlaylists() const;
-    //Clear the loaded playlist(but still keep it in storage).  Load the most recently stored Playlist(if any) with Paused status. 
+    //Null while Empty.  Points into the SongTable, so it stays valid.
+    const std::string* getCurrentSong() const;
+    int getCurrentSongIndex() const;
+    //Increases whenever a song is opened or joined, even the same one again.  Meant for detecting changes.
+    std::size_t getNumSongChanges() const;
+    //Clear the loaded playlist(but still keep it in storage).  Load the most recently stored Playlist(if any) with Paused status.
+    //O(n) in the restored Playlist's length if it is shuffled, which rebuilds its order from the seed.
     void popCurrentPlaylist();
-    
+    const Statistics& getStatistics() const;
+    void resetStatistics();
+    //Thread safe.  A budget of zero streams songs from their files instead.
+    SongCache& getSongCache();
+
 private:
-    void openCurrentSongFile();
-    
-    
+    using TrackFuture = std::future<std::unique_ptr<MusicStream::Track>>;
+    template<typename T_Value>
+    using Vector = std::vector<T_Value, PolymorphicAllocator<T_Value>>;
+    static const sf::Int64 sCrossfadeStepMs = 20;  //volume steps when update() is driven by getNextUpdateDelay()
+    static const sf::Int64 sRetryDelayMs = 10;
+
+
+private:
+    //Open the current song in mStream, from the prefetched Track if it is the right one.
+    void openCurrentSong();
+    SongId getSong(int position) const;
+    std::unique_ptr<MusicStream::Track> takeTrack(SongId song);
+    static std::unique_ptr<MusicStream::Track> openTrack(SongCache& songCache, const std::string& filename);
+    //The song after the current one, which is the first of the next cycle when the Playlist wraps.
+    SongId getNextSong() const;
+    //Go back to the first song, switching to the next cycle's order if shuffling.
+    void startNewCycle();
+    //Start opening the next song unless it is already opened or being opened.
+    void prefetchNextSong();
+    void cancelPrefetch();
+    //Queue the prefetched Track in mStream or start a crossfade into it, once it is ready.
+    void usePrefetchedTrack();
+    void startCrossfade();
+    void updateCrossfade();
+    //Make the incoming song the current one.
+    void finishCrossfade();
+    void cancelCrossfade();
+    //The current song ended on its own and the next one is already playing.
+    void advanceToNextSong();
+    void recordSwitch(sf::Time duration);
+
+
 private:
     Status mStatus;
-    std::map<T_PlaylistId, Playlist> mStoredPlaylists;
-    //Playlist iterators.  Used to shuffle without affecting source.
-    std::vector<std::string*> mCurrentPlaylist;
+    SongTable mSongTable;
+    std::map<T_PlaylistId, std::vector<SongId>, std::less<T_PlaylistId>, PolymorphicAllocator<std::pair<const T_PlaylistId, std::vector<SongId>>>> mStoredPlaylists;
+    const std::vector<SongId>* mCurrentPlaylist;  //null while Empty
+    std::uint64_t mSeed;
+    mutable SongOrder mSongOrder;  //the current cycle's permutation, materialized on demand
+    std::mt19937_64 mSeedGenerator;  //for shuffles without a given seed
     int mCurrentSong;
-    sf::Music mMusicStream;
+    //Streams are swapped at the end of a crossfade, so they are held by pointer.
+    std::unique_ptr<MusicStream> mStream;
+    std::unique_ptr<MusicStream> mFadeStream;  //only plays during a crossfade
+    float mVolume;
+    sf::Time mCrossfade;
+    bool mFading;
     bool mLooped;
-    bool mShuffle;
-    std::stack<MusicState> mSavedMusicStates;
+    SongCache mSongCache;  //used by the prefetch tasks, so declared before them
+    //The prefetched song is being opened in mPrefetch, is ready in mPrefetchedTrack or is queued in mStream.
+    SongId mPrefetchSong;
+    TrackFuture mPrefetch;
+    std::future<void> mPrefetchTask;  //wakes the owner after setting mPrefetch
+    std::unique_ptr<MusicStream::Track> mPrefetchedTrack;
+    //Prefetch tasks no longer needed, kept until they finish since destroying them would block.
+    Vector<std::future<void>> mAbandonedPrefetches;
+    std::function<void()> mWakeCallback;
+    std::size_t mNumSongChanges;
+    //On a vector rather than std::stack's default deque, which allocates a block whenever it goes from empty
+    //to one state.
+    std::stack<MusicState, Vector<MusicState>> mSavedMusicStates;
+    Statistics mStatistics;
 };
 
 #include "MusicPlayer.inl"
 //will we need to add code to ensure the music is played unaffected by listener movement.
 
-#endif
\ No newline at end of file
+#endif
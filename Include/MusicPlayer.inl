@@ -1,33 +1,79 @@
 #include "MusicPlayer.h"
 
 
+
+template<typename T_PlaylistId>
+const sf::Int64 MusicPlayer<T_PlaylistId>::sCrossfadeStepMs;
+template<typename T_PlaylistId>
+const sf::Int64 MusicPlayer<T_PlaylistId>::sRetryDelayMs;
+
+
 template<typename T_PlaylistId>
-MusicPlayer<T_PlaylistId>::MusicPlayer()
-:mStatus(Status::Empty)
+MusicPlayer<T_PlaylistId>::MusicPlayer(MemoryResource* memoryResource)
+:mStatus(Status::Empty),
+mStoredPlaylists(std::less<T_PlaylistId>(), memoryResource),
+mCurrentPlaylist(nullptr),
+mSeed(0),
+mSeedGenerator(std::random_device()()),
+mCurrentSong(0),
+mStream(new MusicStream()),
+mFadeStream(new MusicStream()),
+mVolume(100.0f),
+mFading(false),
+mLooped(false),
+mPrefetchSong(SongTable::InvalidSongId),
+mAbandonedPrefetches(memoryResource),
+mNumSongChanges(0),
+mSavedMusicStates(Vector<MusicState>(memoryResource))
 {
-    mMusicStream.setRelativeToListener(true);
+    mStream->setRelativeToListener(true);
+    mFadeStream->setRelativeToListener(true);
 }
 
 
 template<typename T_PlaylistId>
 void MusicPlayer<T_PlaylistId>::storePlaylist(const T_PlaylistId& id, Playlist&& playlist)
 {
-    bool success = mStoredPlaylists.emplace(std::make_pair(id, std::move(playlist))).second;
+    std::vector<SongId> songs;
+    songs.reserve(playlist.size());
+    for(const std::string& song : playlist)
+        songs.push_back(mSongTable.intern(song));
+    playlist.clear();
+    bool success = mStoredPlaylists.emplace(std::make_pair(id, std::move(songs))).second;
     assert(success == true && "emplace() failed in MusicPlayer::storePlaylist()");
+    (void)success;
 }
 
 
 template<typename T_PlaylistId>
 float MusicPlayer<T_PlaylistId>::getVolume() const
 {
-    return mMusicStream.getVolume();
+    return mVolume;
 }
 
 
 template<typename T_PlaylistId>
 void MusicPlayer<T_PlaylistId>::setVolume(float newVolume)
 {
-    mMusicStream.setVolume(newVolume);
+    mVolume = newVolume;
+    //During a crossfade, the next update() scales both streams to the new volume.
+    if(mFading == false)
+        mStream->setVolume(newVolume);
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::setCrossfade(sf::Time duration)
+{
+    assert(duration >= sf::Time::Zero && "Crossfade duration must not be negative in MusicPlayer::setCrossfade()");
+    mCrossfade = duration;
+}
+
+
+template<typename T_PlaylistId>
+sf::Time MusicPlayer<T_PlaylistId>::getCrossfade() const
+{
+    return mCrossfade;
 }
 
 
@@ -41,8 +87,60 @@ typename MusicPlayer<T_PlaylistId>::Status MusicPlayer<T_PlaylistId>::getMusicSt
 template<typename T_PlaylistId>
 void MusicPlayer<T_PlaylistId>::update()
 {
-    if(mStatus == Status::Playing && mMusicStream.getStatus() == sf::Music::Stopped)
-        nextSong();
+    PROFILE_ZONE("MusicPlayer::update");
+    sf::Clock clock;
+    mAbandonedPrefetches.erase(std::remove_if(mAbandonedPrefetches.begin(), mAbandonedPrefetches.end(), [](const std::future<void>& prefetch)
+    {
+        return prefetch.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), mAbandonedPrefetches.end());
+
+    if(mStatus != Status::Empty)
+    {
+        if(mStream->updateTrackChange())
+        {
+            ++mStatistics.numGaplessSwitches;
+            advanceToNextSong();
+        }
+        if(mFading)
+            updateCrossfade();
+        else
+            usePrefetchedTrack();
+        //Only happens when the next song was not ready in time or could not be joined without a gap.
+        if(mStatus == Status::Playing && mFading == false && mStream->getStatus() == sf::SoundStream::Stopped)
+            nextSong();
+    }
+
+    sf::Time updateTime = clock.getElapsedTime();
+    ++mStatistics.numUpdates;
+    mStatistics.totalUpdateTime += updateTime;
+    mStatistics.maxUpdateTime = std::max(mStatistics.maxUpdateTime, updateTime);
+}
+
+
+template<typename T_PlaylistId>
+sf::Time MusicPlayer<T_PlaylistId>::getNextUpdateDelay() const
+{
+    if(mStatus != Status::Playing)
+        return sf::microseconds(-1);
+    if(mFading)
+        return sf::milliseconds(sCrossfadeStepMs);
+    if(mStream->getStatus() == sf::SoundStream::Stopped)
+        return sf::Time::Zero;
+    //The song's end is when the stream switches or stops; the stream's callback only tells that it has read that far.
+    sf::Time delay = mStream->getTrackDuration() - mStream->getTrackOffset();
+    if(mCrossfade != sf::Time::Zero && mPrefetchedTrack)
+        delay -= mCrossfade;
+    return std::max(delay, sf::milliseconds(sRetryDelayMs));
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::setWakeCallback(std::function<void()> callback)
+{
+    assert(mStatus == Status::Empty && "The player must be Empty in MusicPlayer::setWakeCallback()");
+    mWakeCallback = std::move(callback);
+    mStream->setEventCallback(mWakeCallback);
+    mFadeStream->setEventCallback(mWakeCallback);
 }
 
 
@@ -55,9 +153,13 @@ void MusicPlayer<T_PlaylistId>::play()
     case Status::Paused:
     case Status::SongStopped:
     case Status::PlaylistStopped:
-        mMusicStream.play();
+        if(mFading && mStatus == Status::Paused)
+            mFadeStream->play();
+        mStream->play();
         mStatus = Status::Playing;
         break;
+    default:
+        break;
     }
 }
 
@@ -67,7 +169,9 @@ void MusicPlayer<T_PlaylistId>::pause()
 {
     if(mStatus == Status::Playing)
     {
-        mMusicStream.pause();
+        mStream->pause();
+        if(mFading)
+            mFadeStream->pause();
         mStatus = Status::Paused;
     }
 }
@@ -78,8 +182,10 @@ void MusicPlayer<T_PlaylistId>::stopSong()
 {
     if(mStatus != Status::Empty && mStatus != Status::PlaylistStopped)
     {
-        mMusicStream.stop();
+        cancelCrossfade();
+        mStream->stop();
         mStatus = Status::SongStopped;
+        prefetchNextSong();
     }
 }
 
@@ -89,10 +195,9 @@ void MusicPlayer<T_PlaylistId>::stopPlaylist()
 {
     if(mStatus != Status::Empty && mStatus != Status::PlaylistStopped)
     {
-        if(mShuffle)
-            std::random_shuffle(mCurrentPlaylist.begin(), mCurrentPlaylist.end());
-        mCurrentSong = 0;
-        openCurrentSongFile();
+        cancelCrossfade();
+        startNewCycle();
+        openCurrentSong();
         mStatus = Status::PlaylistStopped;
     }
 }
@@ -103,24 +208,33 @@ void MusicPlayer<T_PlaylistId>::nextSong()
 {
     if(mStatus != Status::Empty)
     {
-        ++mCurrentSong;
-        if(mCurrentSong < mCurrentPlaylist.size())
-        {
-            openCurrentSongFile();
-            if(mStatus == Status::Playing)
-                mMusicStream.play();
-        }
-        else if(mLooped == true)
+        sf::Clock clock;
+        if(mFading)
+            finishCrossfade();
+        else
         {
-            if(mShuffle)
-                std::random_shuffle(mCurrentPlaylist.begin(), mCurrentPlaylist.end());
-            mCurrentSong = 0;
-            openCurrentSongFile();
-            if(mStatus == Status::Playing)
-                mMusicStream.play();
+            ++mCurrentSong;
+            if(mCurrentSong < static_cast<int>(mCurrentPlaylist->size()))
+            {
+                openCurrentSong();
+                if(mStatus == Status::Playing)
+                    mStream->play();
+            }
+            else if(mLooped == true)
+            {
+                startNewCycle();
+                openCurrentSong();
+                if(mStatus == Status::Playing)
+                    mStream->play();
+            }
+            else
+            {
+                //stopPlaylist() does nothing if the Playlist is already stopped.
+                --mCurrentSong;
+                stopPlaylist();
+            }
         }
-        else
-            stopPlaylist();
+        recordSwitch(clock.getElapsedTime());
     }
 }
 
@@ -130,54 +244,63 @@ void MusicPlayer<T_PlaylistId>::previousSong()
 {
     if(mStatus != Status::Empty)
     {
+        sf::Clock clock;
+        cancelCrossfade();
         if(mCurrentSong != 0)
         {
             --mCurrentSong;
-            openCurrentSongFile();
+            openCurrentSong();
             if(mStatus == Status::Playing)
-                mMusicStream.play();
+                mStream->play();
         }
         else if(mLooped == true)
         {
-            if(mShuffle)
-                std::random_shuffle(mCurrentPlaylist.begin(), mCurrentPlaylist.end());
-            mCurrentSong = mCurrentPlaylist.size() - 1;
-            openCurrentSongFile();
+            startNewCycle();
+            mCurrentSong = static_cast<int>(mCurrentPlaylist->size()) - 1;
+            openCurrentSong();
             if(mStatus == Status::Playing)
-                mMusicStream.play();
+                mStream->play();
         }
         else
             stopPlaylist();
+        recordSwitch(clock.getElapsedTime());
     }
 }
 
 
 template<typename T_PlaylistId>
-void MusicPlayer<T_PlaylistId>::loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic)
+void MusicPlayer<T_PlaylistId>::loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic, std::uint64_t seed)
 {
-    std::map<T_PlaylistId, Playlist>::iterator playlistToLoadIter = mStoredPlaylists.find(id);
+    typename decltype(mStoredPlaylists)::iterator playlistToLoadIter = mStoredPlaylists.find(id);
     bool playlistFound = playlistToLoadIter == mStoredPlaylists.end() ? false : true;
     assert(playlistFound == true && "Playlist not found in mStoredPlaylists in MusicPlayer::loadPlaylist()");
-    if(saveCurrentMusic == true && mCurrentPlaylist.size())
+    (void)playlistFound;
+    cancelCrossfade();
+    if(saveCurrentMusic == true && mCurrentPlaylist != nullptr)
     {
-        sf::Time elapsedTime = mMusicStream.getPlayingOffset();
-        MusicState stateToBeSaved = std::make_tuple(mCurrentPlaylist, mCurrentSong, elapsedTime, mLooped, mShuffle);
-        mSavedMusicStates.push(stateToBeSaved);
+        sf::Time elapsedTime = mStream->getTrackOffset();
+        bool pinned = mSongCache.pin(mSongTable.getPath(getSong(mCurrentSong)));
+        mSavedMusicStates.push(MusicState{mCurrentPlaylist, mSeed, mCurrentSong, elapsedTime, mLooped, pinned});
     }
-    if(mMusicStream.getStatus() == sf::Music::Playing)
-        mMusicStream.stop();
     mStatus = Status::PlaylistStopped;
-    mCurrentPlaylist.clear();
-    for(auto& song : playlistToLoadIter->second)
+    mCurrentPlaylist = &playlistToLoadIter->second;
+    mSeed = 0;
+    if(shuffle)
     {
-        mCurrentPlaylist.push_back(&song);
+        mSeed = seed;
+        while(mSeed == 0)
+            mSeed = mSeedGenerator();
     }
-    if(shuffle)
-        std::random_shuffle(mCurrentPlaylist.begin(), mCurrentPlaylist.end());
     mCurrentSong = 0;
     mLooped = looped;
-    mShuffle = shuffle;
-    openCurrentSongFile();
+    openCurrentSong();
+}
+
+
+template<typename T_PlaylistId>
+std::uint64_t MusicPlayer<T_PlaylistId>::getShuffleSeed() const
+{
+    return mSeed;
 }
 
 
@@ -188,36 +311,276 @@ int MusicPlayer<T_PlaylistId>::getNumSavedPlaylists() const
 }
 
 
+template<typename T_PlaylistId>
+const std::string* MusicPlayer<T_PlaylistId>::getCurrentSong() const
+{
+    return mStatus == Status::Empty ? nullptr : &mSongTable.getPath(getSong(mCurrentSong));
+}
+
+
+template<typename T_PlaylistId>
+int MusicPlayer<T_PlaylistId>::getCurrentSongIndex() const
+{
+    return mCurrentSong;
+}
+
+
+template<typename T_PlaylistId>
+std::size_t MusicPlayer<T_PlaylistId>::getNumSongChanges() const
+{
+    return mNumSongChanges;
+}
+
+
 template<typename T_PlaylistId>
 void MusicPlayer<T_PlaylistId>::popCurrentPlaylist()
 {
+    cancelCrossfade();
     if(mSavedMusicStates.size())
     {
-        MusicState& mostRecentlySavedState = mSavedMusicStates.top();
-        mCurrentPlaylist = std::get<0>(mostRecentlySavedState);
-        mCurrentSong = std::get<1>(mostRecentlySavedState);
-        sf::Time savedTime = std::get<2>(mostRecentlySavedState);
-        mLooped = std::get<3>(mostRecentlySavedState);
-        mShuffle = std::get<4>(mostRecentlySavedState);
+        MusicState mostRecentlySavedState = mSavedMusicStates.top();
         mSavedMusicStates.pop();
-        openCurrentSongFile();
-        mMusicStream.setPlayingOffset(savedTime);
+        mCurrentPlaylist = mostRecentlySavedState.playlist;
+        mSeed = mostRecentlySavedState.seed;
+        mCurrentSong = mostRecentlySavedState.songPosition;
+        mLooped = mostRecentlySavedState.looped;
+        openCurrentSong();
+        mStream->setPlayingOffset(mostRecentlySavedState.elapsedTime);
+        //The stream now holds the song's data, which keeps it cached.
+        if(mostRecentlySavedState.pinned)
+            mSongCache.unpin(mSongTable.getPath(getSong(mCurrentSong)));
         mStatus = Status::Paused;
     }
     else
     {
-        mCurrentPlaylist.clear();
-        if(mMusicStream.getStatus() == sf::Music::Playing)
-            mMusicStream.stop();
+        mCurrentPlaylist = nullptr;
+        cancelPrefetch();
+        mStream->setTrack(nullptr);
         mStatus = Status::Empty;
     }
 }
 
 
 template<typename T_PlaylistId>
-void MusicPlayer<T_PlaylistId>::openCurrentSongFile()
+const typename MusicPlayer<T_PlaylistId>::Statistics& MusicPlayer<T_PlaylistId>::getStatistics() const
+{
+    return mStatistics;
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::resetStatistics()
+{
+    mStatistics = Statistics();
+}
+
+
+template<typename T_PlaylistId>
+SongCache& MusicPlayer<T_PlaylistId>::getSongCache()
+{
+    return mSongCache;
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::openCurrentSong()
+{
+    PROFILE_ZONE("MusicPlayer::openCurrentSong");
+    PROFILE_FRAME_COUNT("Songs opened", 1);
+    SongId song = getSong(mCurrentSong);
+    if(song == mPrefetchSong && mStream->skipToQueuedTrack())
+        mPrefetchSong = SongTable::InvalidSongId;
+    else
+    {
+        //setTrack() drops the queued Track, which can only be the prefetched one.
+        if(mStream->hasQueuedTrack())
+            cancelPrefetch();
+        mStream->setTrack(takeTrack(song));
+    }
+    ++mNumSongChanges;
+    prefetchNextSong();
+}
+
+
+template<typename T_PlaylistId>
+typename MusicPlayer<T_PlaylistId>::SongId MusicPlayer<T_PlaylistId>::getSong(int position) const
+{
+    return (*mCurrentPlaylist)[mSongOrder.getIndex(mSeed, mCurrentPlaylist->size(), position)];
+}
+
+
+template<typename T_PlaylistId>
+std::unique_ptr<MusicStream::Track> MusicPlayer<T_PlaylistId>::takeTrack(SongId song)
+{
+    if(song == mPrefetchSong)
+    {
+        mPrefetchSong = SongTable::InvalidSongId;
+        //Waiting for a prefetch that is underway still beats starting over.
+        if(mPrefetch.valid())
+            mPrefetchedTrack = mPrefetch.get();
+        if(mPrefetchedTrack)
+            return std::move(mPrefetchedTrack);
+    }
+    ++mStatistics.numPrefetchMisses;
+    return openTrack(mSongCache, mSongTable.getPath(song));
+}
+
+
+template<typename T_PlaylistId>
+std::unique_ptr<MusicStream::Track> MusicPlayer<T_PlaylistId>::openTrack(SongCache& songCache, const std::string& filename)
+{
+    PROFILE_ZONE("MusicPlayer::openTrack");
+    if(songCache.getBudget() == 0)
+        return std::unique_ptr<MusicStream::Track>(new MusicStream::Track(filename));
+    return std::unique_ptr<MusicStream::Track>(new MusicStream::Track(filename, songCache.load(filename)));
+}
+
+
+template<typename T_PlaylistId>
+typename MusicPlayer<T_PlaylistId>::SongId MusicPlayer<T_PlaylistId>::getNextSong() const
+{
+    if(mCurrentPlaylist == nullptr || mCurrentPlaylist->empty())
+        return SongTable::InvalidSongId;
+    if(mCurrentSong + 1 < static_cast<int>(mCurrentPlaylist->size()))
+        return getSong(mCurrentSong + 1);
+    //The next cycle's first song is known without materializing its order.
+    return (*mCurrentPlaylist)[SongOrder::getFirstIndex(SongOrder::getNextCycleSeed(mSeed), mCurrentPlaylist->size())];
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::startNewCycle()
+{
+    mSeed = SongOrder::getNextCycleSeed(mSeed);
+    mCurrentSong = 0;
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::prefetchNextSong()
+{
+    SongId song = getNextSong();
+    if(song == mPrefetchSong)
+        return;
+    cancelPrefetch();
+    if(song == SongTable::InvalidSongId)
+        return;
+    mPrefetchSong = song;
+    std::promise<std::unique_ptr<MusicStream::Track>> promise;
+    mPrefetch = promise.get_future();
+    //The task sets the promise before waking the owner, so the Track is ready by the time update() looks.
+    SongCache* songCache = &mSongCache;
+    mPrefetchTask = std::async(std::launch::async, [songCache](std::string filename, std::promise<std::unique_ptr<MusicStream::Track>> promise,
+                                                               std::function<void()> wakeCallback)
+    {
+        try
+        {
+            promise.set_value(openTrack(*songCache, filename));
+        }
+        catch(...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+        if(wakeCallback)
+            wakeCallback();
+    }, mSongTable.getPath(song), std::move(promise), mWakeCallback);
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::cancelPrefetch()
+{
+    if(mPrefetchTask.valid())
+        mAbandonedPrefetches.push_back(std::move(mPrefetchTask));
+    mPrefetch = TrackFuture();
+    mPrefetchedTrack.reset();
+    mPrefetchSong = SongTable::InvalidSongId;
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::usePrefetchedTrack()
+{
+    if(mPrefetch.valid() && mPrefetch.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        mPrefetchedTrack = mPrefetch.get();
+    if(!mPrefetchedTrack)
+        return;
+    //At the end of an unlooped Playlist the music stops instead; the Track is kept for stopPlaylist().
+    if(mLooped == false && mCurrentSong + 1 >= static_cast<int>(mCurrentPlaylist->size()))
+        return;
+    if(mCrossfade == sf::Time::Zero)
+        mStream->queueTrack(mPrefetchedTrack);
+    else if(mStatus == Status::Playing && mStream->getTrackOffset() >= mStream->getTrackDuration() - mCrossfade)
+        startCrossfade();
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::startCrossfade()
+{
+    mFadeStream->setTrack(std::move(mPrefetchedTrack));
+    mPrefetchSong = SongTable::InvalidSongId;
+    mFadeStream->setVolume(0.0f);
+    mFadeStream->play();
+    mFading = true;
+    ++mStatistics.numCrossfades;
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::updateCrossfade()
+{
+    //Progress follows the incoming song's playing offset, so pausing pauses the fade.
+    float progress = 1.0f;
+    if(mCrossfade != sf::Time::Zero && mFadeStream->getStatus() != sf::SoundStream::Stopped)
+        progress = std::min(1.0f, mFadeStream->getTrackOffset() / mCrossfade);
+    //Equal power, so the overall loudness holds steady through the overlap.
+    mStream->setVolume(mVolume * std::cos(progress * 1.57079633f));
+    mFadeStream->setVolume(mVolume * std::sin(progress * 1.57079633f));
+    if(progress >= 1.0f)
+        finishCrossfade();
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::finishCrossfade()
+{
+    std::swap(mStream, mFadeStream);
+    cancelCrossfade();
+    advanceToNextSong();
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::cancelCrossfade()
+{
+    if(mFading)
+    {
+        mFadeStream->setTrack(nullptr);
+        mStream->setVolume(mVolume);
+        mFading = false;
+    }
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::advanceToNextSong()
+{
+    //The queued Track was the prefetch, and the next song may be the same one again, e.g. in a looped Playlist
+    //of one song, so it must be prefetched anew.
+    mPrefetchSong = SongTable::InvalidSongId;
+    ++mCurrentSong;
+    if(mCurrentSong >= static_cast<int>(mCurrentPlaylist->size()))
+        startNewCycle();
+    ++mNumSongChanges;
+    prefetchNextSong();
+}
+
+
+template<typename T_PlaylistId>
+void MusicPlayer<T_PlaylistId>::recordSwitch(sf::Time duration)
 {
-    bool success = mMusicStream.openFromFile(*mCurrentPlaylist[mCurrentSong]);
-    if(success == false)
-        throw std::runtime_error("The music stream failed to open " + *mCurrentPlaylist[mCurrentSong] + " in MusicPlayer::openCurrentSongFile()." );
-}
\ No newline at end of file
+    ++mStatistics.numSwitches;
+    mStatistics.lastSwitchTime = duration;
+    mStatistics.maxSwitchTime = std::max(mStatistics.maxSwitchTime, duration);
+}
@@ -0,0 +1,104 @@
+#ifndef MusicStream_h
+#define MusicStream_h
+
+
+
+#include <SFML/Audio/InputSoundFile.hpp>
+#include <SFML/Audio/SoundStream.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Streams songs from file like sf::Music, but splits opening a song from playing it.
+A Track does all the disk I/O and decoding needed to start a song, so it can be
+created on a background thread and handed to the stream when needed; it decodes
+either from the file or from its encoded contents in memory.  A second
+Track may be queued behind the current one; if both have the same channel count
+and sample rate, the stream's thread carries on into it in the middle of a chunk,
+so there is no gap between the songs.  updateTrackChange() tells the owner when
+the queued Track has become audible, and an optional callback lets the owner wait
+for the stream instead of polling it.  Only the owning thread may call the member
+functions; the stream's thread only reads the Tracks.
+----------------------------------------------------------------------------------*/
+class MusicStream : public sf::SoundStream
+{
+public:
+    class Track : sf::NonCopyable
+    {
+    public:
+        //Opens the file and decodes the first prebufferLength of it.  Throws std::runtime_error on failure.
+        explicit Track(const std::string& filename, sf::Time prebufferLength = sf::seconds(1.0f));
+        //Decodes the file's encodedData, e.g. from a SongCache, which the Track keeps alive.
+        Track(const std::string& filename, std::shared_ptr<const std::vector<char>> encodedData, sf::Time prebufferLength = sf::seconds(1.0f));
+        const std::string& getFilename() const;
+        unsigned getChannelCount() const;
+        unsigned getSampleRate() const;
+        sf::Time getDuration() const;
+
+    private:
+        friend class MusicStream;
+        void prebuffer(sf::Time prebufferLength);
+        //Returns the number of samples read, which is less than maxCount only at the end of the song.
+        std::size_t read(sf::Int16* samples, std::size_t maxCount);
+        void seek(sf::Time offset);
+
+
+    private:
+        std::string mFilename;
+        std::shared_ptr<const std::vector<char>> mEncodedData;  //null when streaming from the file
+        sf::InputSoundFile mFile;
+        std::vector<sf::Int16> mPrebuffer;  //the first samples of the song, kept for rewinding
+        std::size_t mPrebufferPosition;
+    };
+
+
+public:
+    MusicStream();
+    ~MusicStream();
+    //Stop the stream and replace its Tracks.  track may be null to release the current one.
+    void setTrack(std::unique_ptr<Track> track);
+    //Queue track to follow the current one without a gap.  On success the stream takes ownership, otherwise
+    //track is left untouched: a Track is already queued, there is no current Track or the formats differ.
+    bool queueTrack(std::unique_ptr<Track>& track);
+    bool hasQueuedTrack() const;
+    //Stop the stream and make the queued Track the current one, from its beginning.  Returns false if none is queued.
+    bool skipToQueuedTrack();
+    //If the queued Track has started being heard, make it the current one and return true.  Should be called often.
+    bool updateTrackChange();
+    //Playing offset relative to the start of the current Track.
+    sf::Time getTrackOffset() const;
+    sf::Time getTrackDuration() const;
+    const Track* getTrack() const;
+    //Called on the stream's thread when it moves on to the queued Track or runs out of samples, ahead of
+    //playback by the amount buffered.  Must be thread safe and must not use the stream.  Set while stopped.
+    void setEventCallback(std::function<void()> callback);
+
+protected:
+    virtual bool onGetData(Chunk& data) override;
+    virtual void onSeek(sf::Time timeOffset) override;
+
+
+private:
+    std::unique_ptr<Track> mTrack;
+    std::unique_ptr<Track> mQueuedTrack;
+    //Guards the hand over between the Tracks.  The stream's thread only reads the Track that
+    //mReadTrack points to, so the Tracks themselves are read without holding the lock.
+    mutable std::mutex mMutex;
+    Track* mReadTrack;
+    sf::Uint64 mQueuedTrackStart;  //sample at which the stream's thread moved on to the queued Track
+    sf::Uint64 mNumSamplesRead;  //since the last seek, only touched by the stream's thread while it runs
+    sf::Time mTrackStart;  //playing offset at which the current Track started
+    std::vector<sf::Int16> mSamples;
+    std::function<void()> mEventCallback;
+};
+
+
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef PoolResource_h
+#define PoolResource_h
+
+
+
+#include "MemoryResource.h"
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+
+
+/*----------------------------------------------------------------------------------
+MemoryResource that serves small allocations from pools of fixed-size blocks, like
+std::pmr::unsynchronized_pool_resource.  Requests are rounded up to a power of two
+from 8 to sMaxBlockSize bytes; each size has a free list of blocks carved out of
+chunks taken from the upstream resource, with each chunk twice the size of the
+last.  Freed blocks go back on their free list rather than upstream, so containers
+that repeatedly insert and erase nodes, such as std::map, stop allocating once
+their pools have grown to the peak.  Larger requests go straight upstream.
+Memory is returned upstream by release() or the destructor.  Not thread safe.
+----------------------------------------------------------------------------------*/
+class PoolResource : public MemoryResource, sf::NonCopyable
+{
+public:
+    static const std::size_t sMaxBlockSize = 512;
+
+
+public:
+    explicit PoolResource(MemoryResource* upstream = MemoryResource::getDefault());
+    ~PoolResource();
+    //Return every chunk upstream, invalidating all memory allocated from the pools.
+    void release();
+    //Bytes of chunks taken from upstream, not counting large requests.
+    std::size_t getPooledBytes() const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct Chunk
+    {
+        Chunk* previous;
+        std::size_t size;  //including this header
+    };
+
+    struct Pool
+    {
+        FreeBlock* freeBlocks;
+        std::size_t nextChunkBlocks;  //blocks in the next chunk
+    };
+
+
+private:
+    void* doAllocate(std::size_t bytes, std::size_t alignment) override;
+    void doDeallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+    //Index of the pool serving the request, or sNumPools if it goes upstream.
+    static std::size_t getPoolIndex(std::size_t bytes, std::size_t alignment);
+    void growPool(std::size_t poolIndex);
+
+
+private:
+    static const std::size_t sMinBlockSize = 8;
+    static const std::size_t sNumPools = 7;  //8 to 512 bytes
+    static const std::size_t sChunkHeaderSize = 16;  //keeps blocks aligned to alignof(std::max_align_t)
+    static const std::size_t sMaxChunkBlocks = 1024;
+
+    MemoryResource* mUpstream;
+    Pool mPools[sNumPools];
+    Chunk* mChunks;
+    std::size_t mPooledBytes;
+};
+
+
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef Profiler_h
+#define Profiler_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+/*----------------------------------------------------------------------------------
+Frame profiler recording scoped timing zones and per-frame counters from any thread,
+for diagnosing frame spikes without an external profiler.  Each thread records its
+zones into its own lock-free ring buffer, so recording never locks or allocates; a
+zone costs two clock reads and one push.  markFrame(), called once per frame from
+the main loop, drains the rings and samples the counters into a capture of the most
+recent events, which writeChromeTrace() saves as Chrome trace JSON for
+chrome://tracing or ui.perfetto.dev.
+
+Instrument code through the PROFILE_ macros below, which compile to nothing unless
+GAME_ENGINE_PROFILE is defined (the GAME_ENGINE_ENABLE_PROFILER CMake option).
+Zone and counter names must be string literals or otherwise outlive the profiler,
+since only the pointer is recorded.
+----------------------------------------------------------------------------------*/
+class Profiler : sf::NonCopyable
+{
+public:
+    //Times the enclosing scope.
+    class Zone : sf::NonCopyable
+    {
+    public:
+        explicit Zone(const char* name)
+        :mName(name),
+        mStart(now())
+        {
+        }
+
+
+        ~Zone()
+        {
+            recordZone(mName, mStart, now());
+        }
+
+    private:
+        const char* mName;
+        std::int64_t mStart;
+    };
+
+
+public:
+    //Nanoseconds since the profiler was first used.
+    static std::int64_t now();
+    static void recordZone(const char* name, std::int64_t start, std::int64_t end);
+    //Add to a counter that is reported and reset by each markFrame(), such as sprites updated this frame.
+    static void addToFrameCounter(const char* name, std::int64_t delta);
+    //Add to a counter that keeps its value across frames, such as voices live.  markFrame() reports its
+    //current value.
+    static void addToLevelCounter(const char* name, std::int64_t delta);
+    //End the current frame: collect every thread's zones and counters into the capture.
+    static void markFrame();
+    //Name the calling thread in the trace.
+    static void setThreadName(const std::string& name);
+    //Keep at most this many events in the capture, dropping the oldest, so that a running game keeps the
+    //last few seconds.  Defaults to 1 << 20.
+    static void setCaptureLimit(std::size_t numEvents);
+    static void clear();
+    //Write the capture, including zones recorded since the last markFrame(), as Chrome trace event JSON.
+    static bool writeChromeTrace(const std::string& filename);
+    //Zones lost because a thread recorded more than sRingCapacity between two markFrame() calls.
+    static std::uint64_t getNumDroppedZones();
+
+public:
+    static const std::size_t sRingCapacity = 1 << 14;
+    static const std::size_t sMaxCountersPerThread = 32;
+};
+
+
+
+#define PROFILE_CONCATENATE_IMPL(first, second) first##second
+#define PROFILE_CONCATENATE(first, second) PROFILE_CONCATENATE_IMPL(first, second)
+
+#ifdef GAME_ENGINE_PROFILE
+    #define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+    #define PROFILE_FRAME_COUNT(name, delta) Profiler::addToFrameCounter(name, delta)
+    #define PROFILE_LEVEL(name, delta) Profiler::addToLevelCounter(name, delta)
+    #define PROFILE_FRAME() Profiler::markFrame()
+#else
+    #define PROFILE_ZONE(name) ((void)0)
+    #define PROFILE_FRAME_COUNT(name, delta) ((void)0)
+    #define PROFILE_LEVEL(name, delta) ((void)0)
+    #define PROFILE_FRAME() ((void)0)
+#endif
+
+
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef ResourceCache_h
+#define ResourceCache_h
+
+
+
+#include "ResourceKey.h"
+#include "ResourceLoader.h"
+#include "ResourceSize.h"
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+/*----------------------------------------------------------------------------------
+Shares loaded resources between the ResourceHolders that use it, so that a file
+registered under several ids, or loaded into several holders, is decoded once and
+kept in memory once.  Resources are keyed by the canonical path of their file, or
+by a hash of its contents, along with the arguments they are loaded with.  The
+cache holds resources weakly: a resource stays shared while any holder keeps it,
+and is loaded again once every holder has unloaded or evicted it.  Requests for a
+key whose load is still in flight wait for that load rather than starting another,
+and share its outcome, including its failure.  Shared resources must be treated as
+read-only.  All member functions are thread safe.
+----------------------------------------------------------------------------------*/
+template<typename T_Resource>
+class ResourceCache : sf::NonCopyable
+{
+public:
+    enum class KeyMode{
+        Path, //canonical path of the file
+        Contents //size and hash of the file's contents, read on every request; also merges copies of a file under other names
+    };
+
+    //Cumulative since construction or the last resetStatistics().
+    struct Statistics
+    {
+        std::uint64_t numRequests{0};
+        std::uint64_t numLoads{0};  //requests that decoded the file themselves
+        std::uint64_t numShared{0};  //requests given a resident resource or the result of a load in flight
+        std::uint64_t bytesSaved{0};  //ResourceSize of the resource, for each shared request
+        sf::Time loadTimeSaved;  //decode and finalize time of the resource, for each shared request
+    };
+
+private:
+    struct Entry;
+
+public:
+    //Outcome of request(), to be passed on to decode() and finalize().
+    class Request
+    {
+    private:
+        friend class ResourceCache;
+
+        std::shared_ptr<Entry> entry;
+        std::shared_ptr<T_Resource> resource;  //set if the resource was resident when requested
+        std::shared_future<void> decoded;  //ready once the entry's decode has finished or failed
+        std::promise<void> decoding;  //used only by the request that decodes
+        bool decodes;
+    };
+
+
+public:
+    explicit ResourceCache(KeyMode keyMode = KeyMode::Path);
+    //The shared resource for filename and arguments, loading it on the calling thread if it is neither
+    //resident nor in flight.  Throws std::runtime_error if the load fails.
+    template<typename... T_Arguments>
+    std::shared_ptr<T_Resource> load(const std::string& filename, const T_Arguments&... arguments);
+    //load() split like ResourceLoader: request() and decode() may run on a worker thread, and finalize() runs
+    //on the thread that owns the resource.  decode() waits for the load in flight, if there is one.
+    template<typename... T_Arguments>
+    Request request(const std::string& filename, const T_Arguments&... arguments);
+    template<typename... T_Arguments>
+    void decode(Request& request, const std::string& filename, const T_Arguments&... arguments);
+    //Null if every holder released the resource between its load and this call; load it again in that case.
+    std::shared_ptr<T_Resource> finalize(Request& request);
+    KeyMode getKeyMode() const;
+    //Resources that some holder keeps.
+    std::size_t getNumResident() const;
+    //Bytes that holders would take on top of the resident resources if each kept its own copy.
+    std::size_t getResidentBytesSaved() const;
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+private:
+    using Loader = ResourceLoader<T_Resource>;
+
+    struct Entry
+    {
+        std::mutex mutex;  //guards the members below; may be locked while holding ResourceCache::mMutex, not the reverse
+        std::string key;
+        std::unique_ptr<typename Loader::Decoded> decoded;  //from decode() until the first finalize()
+        std::weak_ptr<T_Resource> resource;
+        std::shared_future<void> decoding;  //of the last load started
+        std::size_t size;
+        sf::Time loadTime;
+    };
+
+
+private:
+    //Let the next request for the entry's key start a new load.
+    void forget(const Entry& entry);
+
+
+private:
+    mutable std::mutex mMutex;
+    KeyMode mKeyMode;
+    //Entries stay after their resource is released, which costs their key, and are reused by the next request.
+    std::unordered_map<std::string, std::shared_ptr<Entry>> mEntries;
+    Statistics mStatistics;
+};
+
+#include "ResourceCache.inl"
+
+
+#endif
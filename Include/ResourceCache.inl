@@ -0,0 +1,202 @@
+#include "ResourceCache.h"
+
+
+
+template<typename T_Resource>
+ResourceCache<T_Resource>::ResourceCache(KeyMode keyMode)
+:mKeyMode(keyMode)
+{
+}
+
+
+template<typename T_Resource>
+template<typename... T_Arguments>
+std::shared_ptr<T_Resource> ResourceCache<T_Resource>::load(const std::string& filename, const T_Arguments&... arguments)
+{
+    Request loadRequest = request(filename, arguments...);
+    decode(loadRequest, filename, arguments...);
+    std::shared_ptr<T_Resource> resource = finalize(loadRequest);
+    //Released by every holder in between, which is rare enough to just start over.
+    return resource ? resource : load(filename, arguments...);
+}
+
+
+template<typename T_Resource>
+template<typename... T_Arguments>
+typename ResourceCache<T_Resource>::Request ResourceCache<T_Resource>::request(const std::string& filename, const T_Arguments&... arguments)
+{
+    std::string key = mKeyMode == KeyMode::Path ? ResourceKey::canonicalizePath(filename) : ResourceKey::hashContents(filename);
+    int expand[] = {0, (ResourceKey::appendArgument(key, arguments), 0)...};
+    (void)expand;
+
+    Request request;
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mStatistics.numRequests;
+    std::shared_ptr<Entry>& entry = mEntries[key];
+    if(!entry)
+    {
+        entry = std::make_shared<Entry>();
+        entry->key = key;
+        entry->size = 0;
+    }
+    request.entry = entry;
+
+    std::lock_guard<std::mutex> entryLock(entry->mutex);
+    request.resource = entry->resource.lock();
+    bool inFlight = entry->decoding.valid() && (entry->decoded || entry->decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+    request.decodes = !request.resource && !inFlight;
+    if(request.decodes)
+    {
+        entry->decoding = request.decoding.get_future().share();
+        entry->loadTime = sf::Time::Zero;
+    }
+    request.decoded = entry->decoding;
+    return request;
+}
+
+
+template<typename T_Resource>
+template<typename... T_Arguments>
+void ResourceCache<T_Resource>::decode(Request& request, const std::string& filename, const T_Arguments&... arguments)
+{
+    if(!request.decodes)
+    {
+        //Rethrows the failure of the load in flight.
+        if(!request.resource)
+            request.decoded.get();
+        return;
+    }
+
+    sf::Clock clock;
+    std::unique_ptr<typename Loader::Decoded> decoded;
+    try
+    {
+        decoded = Loader::decode(filename, arguments...);
+    }
+    catch(...)
+    {
+        forget(*request.entry);
+        request.decoding.set_exception(std::current_exception());
+        throw;
+    }
+    {
+        std::lock_guard<std::mutex> entryLock(request.entry->mutex);
+        request.entry->decoded = std::move(decoded);
+        request.entry->loadTime = clock.getElapsedTime();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStatistics.numLoads;
+    }
+    request.decoding.set_value();
+}
+
+
+template<typename T_Resource>
+std::shared_ptr<T_Resource> ResourceCache<T_Resource>::finalize(Request& request)
+{
+    Entry& entry = *request.entry;
+    std::shared_ptr<T_Resource> resource = std::move(request.resource);
+    std::size_t size;
+    sf::Time loadTime;
+    {
+        std::unique_lock<std::mutex> entryLock(entry.mutex);
+        if(!resource)
+            resource = entry.resource.lock();
+        //Whichever request gets here first after the decode finalizes for all of them.
+        if(!resource && entry.decoded)
+        {
+            sf::Clock clock;
+            try
+            {
+                resource = Loader::finalize(std::move(entry.decoded));
+            }
+            catch(...)
+            {
+                entryLock.unlock();
+                forget(entry);
+                throw;
+            }
+            entry.resource = resource;
+            entry.size = ResourceSize<T_Resource>::get(*resource);
+            entry.loadTime += clock.getElapsedTime();
+        }
+        size = entry.size;
+        loadTime = entry.loadTime;
+    }
+
+    if(resource && !request.decodes)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStatistics.numShared;
+        mStatistics.bytesSaved += size;
+        mStatistics.loadTimeSaved += loadTime;
+    }
+    return resource;
+}
+
+
+template<typename T_Resource>
+typename ResourceCache<T_Resource>::KeyMode ResourceCache<T_Resource>::getKeyMode() const
+{
+    return mKeyMode;
+}
+
+
+template<typename T_Resource>
+std::size_t ResourceCache<T_Resource>::getNumResident() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::size_t numResident = 0;
+    for(const auto& keyAndEntry : mEntries)
+    {
+        Entry& entry = *keyAndEntry.second;
+        std::lock_guard<std::mutex> entryLock(entry.mutex);
+        if(!entry.resource.expired())
+            ++numResident;
+    }
+    return numResident;
+}
+
+
+template<typename T_Resource>
+std::size_t ResourceCache<T_Resource>::getResidentBytesSaved() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::size_t bytesSaved = 0;
+    for(const auto& keyAndEntry : mEntries)
+    {
+        Entry& entry = *keyAndEntry.second;
+        std::lock_guard<std::mutex> entryLock(entry.mutex);
+        long numHolders = entry.resource.use_count();
+        if(numHolders > 1)
+            bytesSaved += entry.size * static_cast<std::size_t>(numHolders - 1);
+    }
+    return bytesSaved;
+}
+
+
+template<typename T_Resource>
+typename ResourceCache<T_Resource>::Statistics ResourceCache<T_Resource>::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+
+template<typename T_Resource>
+void ResourceCache<T_Resource>::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStatistics = Statistics();
+}
+
+
+template<typename T_Resource>
+void ResourceCache<T_Resource>::forget(const Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mEntries.find(entry.key);
+    if(found != mEntries.end() && found->second.get() == &entry)
+        mEntries.erase(found);
+}
@@ -3,32 +3,220 @@
 
 
 
+#include "AssetArchive.h"
+#include "MemoryResource.h"
+#include "Profiler.h"
+#include "ResourceCache.h"
+#include "ResourceIdIndex.h"
+#include "ResourceLoader.h"
+#include "ResourceSize.h"
+#include "ThreadPool.h"
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
 #include <cassert>
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 
 
-//Basic generic resource holder with a std::map underlying container.
+/*----------------------------------------------------------------------------------
+Basic generic resource holder.  Resources live in a contiguous array of slots and
+loading one returns a Handle, its slot index and the slot's generation, so that
+get(Handle) is a single array index.  Unloading a resource bumps its slot's
+generation, and getting a stale Handle is caught by an assert.  Ids are mapped to
+slots by ResourceIdIndex, which turns dense enum ids straight into indices.
+Resources themselves are allocated separately and never move.
+Each resource records its approximate size (see ResourceSize) and the filename and
+arguments it was loaded with.  While the resident resources exceed the memory
+budget, those without references are evicted, least recently got first; a Handle
+stays valid across eviction and the next get() reloads the resource from its
+file.  A reference to a resource without references of its own therefore only
+stays valid until the next load or get(); use addReference() to keep one.
+loadAsync() decodes on a ThreadPool's workers and finishLoads() adds the results
+on the owning thread; see ResourceLoader.  Holders given a ResourceCache share the
+resources they load from files with each other, and between their own ids; each
+holder still counts a shared resource in full towards its memory budget.
+----------------------------------------------------------------------------------*/
 template<typename T_Id, typename T_Resource>
 class ResourceHolder
 {
 public:
-    void load(T_Id id, std::string filename);
+    struct Handle
+    {
+        Handle() : index(0), generation(0) {}
+        Handle(std::uint32_t index, std::uint32_t generation) : index(index), generation(generation) {}
+
+        std::uint32_t index;
+        std::uint32_t generation;  //zero in default-constructed handles, which are never valid
+    };
+
+    struct ManifestEntry
+    {
+        T_Id id;
+        std::string filename;
+    };
+
+    using Manifest = std::vector<ManifestEntry>;
+    //Receives the number of finished loads and the size of the batch.
+    using ProgressCallback = std::function<void(std::size_t, std::size_t)>;
+
+    struct Statistics
+    {
+        std::size_t numResident;  //resources in memory, as opposed to evicted ones
+        std::size_t residentBytes;
+        std::size_t numEvictions;
+        std::size_t numReloads;
+    };
+
+public:
+    //The holder's bookkeeping allocates from memoryResource, which must outlive it; the resources themselves
+    //and their filenames use the global heap.
+    explicit ResourceHolder(MemoryResource* memoryResource = MemoryResource::getDefault());
+    ~ResourceHolder();
+    Handle load(T_Id id, const std::string& filename);
     //Classes such as sf::Shader have a loadFromFile function with two arguments
-    template<T_SecondParameter>
-    void load(T_Id id, std::string filename, T_SecondParameter secondArgument);
-    T_Resource& get(T_Id);
-    const T_Resource& get(T_Id)const;
-    
+    template<typename T_SecondParameter>
+    Handle load(T_Id id, const std::string& filename, T_SecondParameter secondArgument);
+    //Decode on a worker and add the resource in finishLoads().  The future is ready once the resource can be
+    //got, or holds the load's exception; don't wait on it on the owning thread, which must run finishLoads().
+    //Extra arguments are passed on to loadFromFile(), like the second argument of load().
+    template<typename... T_Arguments>
+    std::future<Handle> loadAsync(ThreadPool& threadPool, T_Id id, std::string filename, T_Arguments... arguments);
+    //Load the named entry of archive with loadFromMemory() rather than a file; throws std::runtime_error if
+    //the entry is missing.  The archive must stay open while the resource may be reloaded.  Resources that
+    //keep reading their memory after loading, such as sf::Font, point into the archive and must be stored
+    //uncompressed.
+    template<typename... T_Arguments>
+    Handle loadFromArchive(T_Id id, const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments);
+    //loadFromArchive() through loadAsync().
+    template<typename... T_Arguments>
+    std::future<Handle> loadFromArchiveAsync(ThreadPool& threadPool, T_Id id, const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments);
+    //Load every entry through loadAsync().  onProgress is called from finishLoads() after each one finishes.
+    //The future is ready once all have finished, and holds the first exception if any failed.
+    std::future<void> loadManifest(ThreadPool& threadPool, const Manifest& manifest, ProgressCallback onProgress = ProgressCallback());
+    //Lines of "id filename", where T_Id is read with operator>>.  Blank lines and lines starting with # are skipped.
+    static Manifest readManifest(const std::string& filename);
+    //Add the decoded loads, doing their thread-affine work, until budget is used up; zero means no limit.
+    //Call often, e.g. once per frame.  Returns the number of loads still pending.
+    std::size_t finishLoads(sf::Time budget = sf::Time::Zero);
+    //Block until every pending load has been added or has failed.
+    void finishAllLoads();
+    std::size_t getNumPendingLoads() const;
+    //Destroy the resource, invalidating its Handle.  The id may be loaded again afterwards.
+    void unload(T_Id id);
+    //Resources with references are never evicted.
+    void addReference(Handle handle);
+    void removeReference(Handle handle);
+    //Evict until the resident resources take at most bytes; zero, the default, means no limit.
+    void setMemoryBudget(std::size_t bytes);
+    std::size_t getMemoryBudget() const;
+    //True for evicted resources too.
+    bool contains(T_Id id) const;
+    bool isResident(T_Id id) const;
+    //False for default-constructed handles and for handles of unloaded resources.
+    bool isValid(Handle handle) const;
+    Handle getHandle(T_Id id) const;
+    //Reloads the resource if it was evicted, which throws std::runtime_error if that fails.
+    T_Resource& get(T_Id id);
+    //The const versions can't reload, so the resource must be resident.
+    const T_Resource& get(T_Id id)const;
+    T_Resource& get(Handle handle);
+    const T_Resource& get(Handle handle)const;
+    Statistics getStatistics() const;
+    //Zero the eviction and reload counts.
+    void resetStatistics();
+    //Load files through cache from now on, sharing the resources with other holders using it.  The cache must
+    //outlive the holder; null stops sharing.  Loads from an AssetArchive are not shared.
+    void setCache(ResourceCache<T_Resource>* cache);
+    ResourceCache<T_Resource>* getCache() const;
+
+private:
+    using Loader = ResourceLoader<T_Resource>;
+    using IdIndex = ResourceIdIndex<T_Id>;
+    using Cache = ResourceCache<T_Resource>;
+
+    using Reloader = std::function<std::shared_ptr<T_Resource>()>;
+    template<typename T_Value>
+    using Vector = std::vector<T_Value, PolymorphicAllocator<T_Value>>;
+
+    struct Slot
+    {
+        std::shared_ptr<T_Resource> resource;  //null while the slot is free or evicted; shared through a ResourceCache
+        std::uint64_t lastUse;
+        std::size_t size;
+        std::uint32_t numReferences;
+        std::uint32_t generation;
+        Reloader reload;  //empty while the slot is free
+        std::string filename;
+    };
+
+    struct Batch
+    {
+        std::size_t numLoads;
+        std::size_t numFinished;
+        ProgressCallback onProgress;
+        std::exception_ptr error;
+        std::promise<void> finished;
+    };
+
+    struct PendingLoad
+    {
+        T_Id id;
+        std::string filename;
+        Reloader reload;
+        std::future<std::unique_ptr<typename Loader::Decoded>> decoded;
+        //Loads through a ResourceCache finish with cacheRequest instead of decoded.
+        Cache* cache;
+        std::future<typename Cache::Request> cacheRequest;
+        std::promise<Handle> loaded;
+        std::shared_ptr<Batch> batch;  //null outside loadManifest()
+    };
+
+
+private:
+    template<typename... T_Arguments>
+    static Reloader makeReloader(const std::string& filename, T_Arguments... arguments);
+    template<typename... T_Arguments>
+    static std::unique_ptr<typename Loader::Decoded> decodeEntry(const AssetArchive& archive, const std::string& entryName, const T_Arguments&... arguments);
+    template<typename... T_Arguments>
+    static Reloader makeArchiveReloader(const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments);
+    template<typename... T_Arguments>
+    static Reloader makeCachedReloader(Cache* cache, const std::string& filename, T_Arguments... arguments);
+    Handle insert(T_Id id, std::shared_ptr<T_Resource> resource, const std::string& filename, Reloader reload);
+    static bool isDecoded(const PendingLoad& load);
+    void finishLoad(PendingLoad& load);
+    //Make the slot resident and most recently used.
+    T_Resource& touch(std::uint32_t index);
+    void reload(std::uint32_t index);
+    void evict(std::uint32_t index);
+    //Evict the least recently used resources without references until within budget, keeping keptIndex.
+    void enforceMemoryBudget(std::uint32_t keptIndex);
+
+
 private:
-    //Uses unique_ptr to store noncopyable objects and to ensure RAII
-    std::map<T_Id, std::unique_ptr<T_Resource>> mResourceMap;  
+    //Resources are held by shared_ptr to store noncopyable objects, to ensure RAII and to share them through a ResourceCache
+    Vector<Slot> mSlots;
+    Vector<std::uint32_t> mFreeSlots;
+    IdIndex mIdIndex;
+    Vector<PendingLoad> mPendingLoads;
+    std::size_t mMemoryBudget;
+    std::uint64_t mUseCount;
+    Statistics mStatistics;
+    Cache* mCache;
 };
 
 #include "ResourceHolder.inl"
 
 
-#endif
\ No newline at end of file
+#endif
@@ -3,41 +3,552 @@
 
 
 template<typename T_Id, typename T_Resource>
-void ResourceHolder<T_Id, T_Resource>::load(T_id id, std::string filename)
+ResourceHolder<T_Id, T_Resource>::ResourceHolder(MemoryResource* memoryResource)
+:mSlots(IdIndex::NumFixedSlots, memoryResource),
+mFreeSlots(memoryResource),
+mIdIndex(memoryResource),
+mPendingLoads(memoryResource),
+mMemoryBudget(0),
+mUseCount(0),
+mStatistics(),
+mCache(nullptr)
 {
+    for(Slot& slot : mSlots)
+        slot.generation = 1;
+}
+
+
+template<typename T_Id, typename T_Resource>
+ResourceHolder<T_Id, T_Resource>::~ResourceHolder()
+{
+    PROFILE_LEVEL("Resources resident", -static_cast<std::int64_t>(mStatistics.numResident));
+}
+
+
+template<typename T_Id, typename T_Resource>
+typename ResourceHolder<T_Id, T_Resource>::Handle ResourceHolder<T_Id, T_Resource>::load(T_Id id, const std::string& filename)
+{
+    PROFILE_ZONE("ResourceHolder::load");
+    if(mCache)
+        return insert(id, mCache->load(filename), filename, makeCachedReloader(mCache, filename));
     std::unique_ptr<T_Resource> resourcePtr(new T_Resource());
     if(resourcePtr->loadFromFile(filename) == false)
         throw std::runtime_error("ResourceHolder::load failed to load " + filename);
-    auto insertSuccess = mResourceMap.insert(id, std::move(resourcePtr)).second;
-    assert(insertSuccess && "ResourceHolder::load failed to insert resource with filename " + filename);
+    return insert(id, std::move(resourcePtr), filename, makeReloader(filename));
 }
 
 
 template<typename T_Id, typename T_Resource>
 template<typename T_SecondParameter>
-void <T_Id, T_Resource>::load(T_id id, std::string filename, T_SecondParameter secondArgument)
+typename ResourceHolder<T_Id, T_Resource>::Handle ResourceHolder<T_Id, T_Resource>::load(T_Id id, const std::string& filename, T_SecondParameter secondArgument)
 {
+    PROFILE_ZONE("ResourceHolder::load");
+    if(mCache)
+        return insert(id, mCache->load(filename, secondArgument), filename, makeCachedReloader(mCache, filename, secondArgument));
     std::unique_ptr<T_Resource> resourcePtr(new T_Resource());
     if(resourcePtr->loadFromFile(filename, secondArgument) == false)
         throw std::runtime_error("ResourceHolder::load failed to load " + filename);
-    auto insertSuccess = mResourceMap.insert(id, std::move(resourcePtr)).second;
-    assert(insertSuccess && "ResourceHolder::load failed to insert resource with filename " + filename);
+    return insert(id, std::move(resourcePtr), filename, makeReloader(filename, secondArgument));
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+std::future<typename ResourceHolder<T_Id, T_Resource>::Handle> ResourceHolder<T_Id, T_Resource>::loadAsync(ThreadPool& threadPool, T_Id id, std::string filename, T_Arguments... arguments)
+{
+    if(mCache)
+    {
+        Cache* cache = mCache;
+        PendingLoad load{id, filename, makeCachedReloader(cache, filename, arguments...), {}, cache, threadPool.enqueue([cache, filename, arguments...]()
+        {
+            PROFILE_ZONE("ResourceHolder decode");
+            typename Cache::Request request = cache->request(filename, arguments...);
+            cache->decode(request, filename, arguments...);
+            return request;
+        }), std::promise<Handle>(), nullptr};
+        std::future<Handle> loaded = load.loaded.get_future();
+        mPendingLoads.push_back(std::move(load));
+        return loaded;
+    }
+
+    PendingLoad load{id, filename, makeReloader(filename, arguments...), threadPool.enqueue([filename, arguments...]()
+    {
+        PROFILE_ZONE("ResourceHolder decode");
+        return Loader::decode(filename, arguments...);
+    }), nullptr, {}, std::promise<Handle>(), nullptr};
+    std::future<Handle> loaded = load.loaded.get_future();
+    mPendingLoads.push_back(std::move(load));
+    return loaded;
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+typename ResourceHolder<T_Id, T_Resource>::Handle ResourceHolder<T_Id, T_Resource>::loadFromArchive(T_Id id, const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments)
+{
+    PROFILE_ZONE("ResourceHolder::loadFromArchive");
+    return insert(id, Loader::finalize(decodeEntry(archive, entryName, arguments...)), entryName, makeArchiveReloader(archive, entryName, arguments...));
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+std::future<typename ResourceHolder<T_Id, T_Resource>::Handle> ResourceHolder<T_Id, T_Resource>::loadFromArchiveAsync(ThreadPool& threadPool, T_Id id, const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments)
+{
+    const AssetArchive* archivePtr = &archive;
+    PendingLoad load{id, entryName, makeArchiveReloader(archive, entryName, arguments...), threadPool.enqueue([archivePtr, entryName, arguments...]()
+    {
+        PROFILE_ZONE("ResourceHolder decode");
+        return decodeEntry(*archivePtr, entryName, arguments...);
+    }), nullptr, {}, std::promise<Handle>(), nullptr};
+    std::future<Handle> loaded = load.loaded.get_future();
+    mPendingLoads.push_back(std::move(load));
+    return loaded;
+}
+
+
+template<typename T_Id, typename T_Resource>
+std::future<void> ResourceHolder<T_Id, T_Resource>::loadManifest(ThreadPool& threadPool, const Manifest& manifest, ProgressCallback onProgress)
+{
+    std::shared_ptr<Batch> batch(new Batch{manifest.size(), 0, std::move(onProgress), nullptr, std::promise<void>()});
+    std::future<void> finished = batch->finished.get_future();
+    if(manifest.empty())
+        batch->finished.set_value();
+    for(const ManifestEntry& entry : manifest)
+    {
+        loadAsync(threadPool, entry.id, entry.filename);
+        mPendingLoads.back().batch = batch;
+    }
+    return finished;
+}
+
+
+template<typename T_Id, typename T_Resource>
+typename ResourceHolder<T_Id, T_Resource>::Manifest ResourceHolder<T_Id, T_Resource>::readManifest(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if(!file)
+        throw std::runtime_error("ResourceHolder::readManifest failed to open " + filename);
+    Manifest manifest;
+    std::string line;
+    for(int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        std::istringstream fields(line);
+        std::string first;
+        if(!(fields >> first) || first[0] == '#')
+            continue;
+        ManifestEntry entry;
+        std::istringstream idField(first);
+        //The rest of the line is the filename, which may contain spaces.
+        if(!(idField >> entry.id) || !std::getline(fields >> std::ws, entry.filename) || entry.filename.empty())
+            throw std::runtime_error(filename + ":" + std::to_string(lineNumber) + ": expected \"id filename\" in ResourceHolder::readManifest");
+        manifest.push_back(std::move(entry));
+    }
+    return manifest;
+}
+
+
+template<typename T_Id, typename T_Resource>
+std::size_t ResourceHolder<T_Id, T_Resource>::finishLoads(sf::Time budget)
+{
+    PROFILE_ZONE("ResourceHolder::finishLoads");
+    sf::Clock clock;
+    std::size_t numKept = 0;
+    for(std::size_t i = 0; i < mPendingLoads.size(); ++i)
+    {
+        PendingLoad& load = mPendingLoads[i];
+        bool withinBudget = budget == sf::Time::Zero || clock.getElapsedTime() < budget;
+        if(withinBudget && isDecoded(load))
+            finishLoad(load);
+        else
+        {
+            if(numKept != i)
+                mPendingLoads[numKept] = std::move(load);
+            ++numKept;
+        }
+    }
+    mPendingLoads.erase(mPendingLoads.begin() + numKept, mPendingLoads.end());
+    return mPendingLoads.size();
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::finishAllLoads()
+{
+    while(finishLoads() > 0)
+    {
+        PendingLoad& load = mPendingLoads.front();
+        if(load.cache)
+            load.cacheRequest.wait();
+        else
+            load.decoded.wait();
+    }
 }
 
 
 template<typename T_Id, typename T_Resource>
-T_Resource& ResourceHolder<T_Id, T_Resource>::get(T_Id)
+std::size_t ResourceHolder<T_Id, T_Resource>::getNumPendingLoads() const
 {
-    auto searchResult = mResourceMap.find(T_Id);
-    assert(searchResult != mResourceMap.end() && "ResourceHolder::get() failed to find requested resource.");
-    return *searchResult->first;
+    return mPendingLoads.size();
 }
 
 
 template<typename T_Id, typename T_Resource>
-const T_Resource& ResourceHolder<T_Id, T_Resource>::get(T_Id)const
+void ResourceHolder<T_Id, T_Resource>::unload(T_Id id)
 {
-    auto searchResult = mResourceMap.find(T_Id);
-    assert(searchResult != mResourceMap.end() && "ResourceHolder::get() failed to find requested resource.");
-    return *searchResult->first;
-}
\ No newline at end of file
+    std::uint32_t index = mIdIndex.find(id);
+    assert(index != IdIndex::NoSlot && mSlots[index].reload && "Id not loaded in ResourceHolder::unload()");
+    Slot& slot = mSlots[index];
+    if(slot.resource)
+    {
+        --mStatistics.numResident;
+        mStatistics.residentBytes -= slot.size;
+        PROFILE_LEVEL("Resources resident", -1);
+    }
+    slot.resource.reset();
+    slot.reload = Reloader();
+    slot.filename.clear();
+    //Generation zero is kept for default-constructed handles.
+    if(++slot.generation == 0)
+        slot.generation = 1;
+    mIdIndex.erase(id);
+    if(index >= IdIndex::NumFixedSlots)
+        mFreeSlots.push_back(index);
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::addReference(Handle handle)
+{
+    assert(isValid(handle) && "Stale or invalid handle in ResourceHolder::addReference()");
+    ++mSlots[handle.index].numReferences;
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::removeReference(Handle handle)
+{
+    assert(isValid(handle) && mSlots[handle.index].numReferences > 0 && "Unreferenced resource in ResourceHolder::removeReference()");
+    if(--mSlots[handle.index].numReferences == 0)
+        enforceMemoryBudget(IdIndex::NoSlot);
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::setMemoryBudget(std::size_t bytes)
+{
+    mMemoryBudget = bytes;
+    enforceMemoryBudget(IdIndex::NoSlot);
+}
+
+
+template<typename T_Id, typename T_Resource>
+std::size_t ResourceHolder<T_Id, T_Resource>::getMemoryBudget() const
+{
+    return mMemoryBudget;
+}
+
+
+template<typename T_Id, typename T_Resource>
+bool ResourceHolder<T_Id, T_Resource>::contains(T_Id id) const
+{
+    std::uint32_t index = mIdIndex.find(id);
+    return index != IdIndex::NoSlot && mSlots[index].reload;
+}
+
+
+template<typename T_Id, typename T_Resource>
+bool ResourceHolder<T_Id, T_Resource>::isResident(T_Id id) const
+{
+    std::uint32_t index = mIdIndex.find(id);
+    return index != IdIndex::NoSlot && mSlots[index].resource;
+}
+
+
+template<typename T_Id, typename T_Resource>
+bool ResourceHolder<T_Id, T_Resource>::isValid(Handle handle) const
+{
+    return handle.index < mSlots.size() && mSlots[handle.index].generation == handle.generation && mSlots[handle.index].reload;
+}
+
+
+template<typename T_Id, typename T_Resource>
+typename ResourceHolder<T_Id, T_Resource>::Handle ResourceHolder<T_Id, T_Resource>::getHandle(T_Id id) const
+{
+    std::uint32_t index = mIdIndex.find(id);
+    assert(index != IdIndex::NoSlot && mSlots[index].reload && "ResourceHolder::getHandle() failed to find requested resource.");
+    return Handle(index, mSlots[index].generation);
+}
+
+
+template<typename T_Id, typename T_Resource>
+T_Resource& ResourceHolder<T_Id, T_Resource>::get(T_Id id)
+{
+    std::uint32_t index = mIdIndex.find(id);
+    assert(index != IdIndex::NoSlot && mSlots[index].reload && "ResourceHolder::get() failed to find requested resource.");
+    return touch(index);
+}
+
+
+template<typename T_Id, typename T_Resource>
+const T_Resource& ResourceHolder<T_Id, T_Resource>::get(T_Id id)const
+{
+    std::uint32_t index = mIdIndex.find(id);
+    assert(index != IdIndex::NoSlot && mSlots[index].resource && "ResourceHolder::get() failed to find requested resident resource.");
+    return *mSlots[index].resource;
+}
+
+
+template<typename T_Id, typename T_Resource>
+T_Resource& ResourceHolder<T_Id, T_Resource>::get(Handle handle)
+{
+    assert(isValid(handle) && "Stale or invalid handle in ResourceHolder::get()");
+    return touch(handle.index);
+}
+
+
+template<typename T_Id, typename T_Resource>
+const T_Resource& ResourceHolder<T_Id, T_Resource>::get(Handle handle)const
+{
+    assert(isValid(handle) && mSlots[handle.index].resource && "Stale, invalid or evicted handle in ResourceHolder::get()");
+    return *mSlots[handle.index].resource;
+}
+
+
+template<typename T_Id, typename T_Resource>
+typename ResourceHolder<T_Id, T_Resource>::Statistics ResourceHolder<T_Id, T_Resource>::getStatistics() const
+{
+    return mStatistics;
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::resetStatistics()
+{
+    mStatistics.numEvictions = 0;
+    mStatistics.numReloads = 0;
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::setCache(ResourceCache<T_Resource>* cache)
+{
+    mCache = cache;
+}
+
+
+template<typename T_Id, typename T_Resource>
+ResourceCache<T_Resource>* ResourceHolder<T_Id, T_Resource>::getCache() const
+{
+    return mCache;
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+typename ResourceHolder<T_Id, T_Resource>::Reloader ResourceHolder<T_Id, T_Resource>::makeReloader(const std::string& filename, T_Arguments... arguments)
+{
+    //Goes through the loader like loadAsync(), whose specializations accept the same arguments as loadFromFile().
+    return [filename, arguments...]()
+    {
+        return Loader::finalize(Loader::decode(filename, arguments...));
+    };
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+std::unique_ptr<typename ResourceLoader<T_Resource>::Decoded> ResourceHolder<T_Id, T_Resource>::decodeEntry(const AssetArchive& archive, const std::string& entryName, const T_Arguments&... arguments)
+{
+    std::size_t entry = archive.find(entryName);
+    if(entry == AssetArchive::NoEntry)
+        throw std::runtime_error("ResourceHolder failed to find archive entry " + entryName);
+    std::vector<char> buffer;
+    const char* data = archive.getData(entry, buffer);
+    if(data == nullptr)
+        throw std::runtime_error("ResourceHolder found corrupt archive entry " + entryName);
+    return Loader::decodeFromMemory(data, archive.getSize(entry), arguments...);
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+typename ResourceHolder<T_Id, T_Resource>::Reloader ResourceHolder<T_Id, T_Resource>::makeArchiveReloader(const AssetArchive& archive, const std::string& entryName, T_Arguments... arguments)
+{
+    const AssetArchive* archivePtr = &archive;
+    return [archivePtr, entryName, arguments...]()
+    {
+        return Loader::finalize(decodeEntry(*archivePtr, entryName, arguments...));
+    };
+}
+
+
+template<typename T_Id, typename T_Resource>
+template<typename... T_Arguments>
+typename ResourceHolder<T_Id, T_Resource>::Reloader ResourceHolder<T_Id, T_Resource>::makeCachedReloader(Cache* cache, const std::string& filename, T_Arguments... arguments)
+{
+    //Shares the resource again if another holder still keeps it.
+    return [cache, filename, arguments...]()
+    {
+        return cache->load(filename, arguments...);
+    };
+}
+
+
+template<typename T_Id, typename T_Resource>
+typename ResourceHolder<T_Id, T_Resource>::Handle ResourceHolder<T_Id, T_Resource>::insert(T_Id id, std::shared_ptr<T_Resource> resource, const std::string& filename, Reloader reload)
+{
+    std::uint32_t index = mIdIndex.find(id);
+    if(index == IdIndex::NoSlot)
+    {
+        if(mFreeSlots.empty())
+        {
+            assert(mSlots.size() < IdIndex::NoSlot && "Too many resources in ResourceHolder::insert()");
+            index = static_cast<std::uint32_t>(mSlots.size());
+            mSlots.push_back(Slot{nullptr, 0, 0, 0, 1, Reloader(), std::string()});
+        }
+        else
+        {
+            index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        mIdIndex.insert(id, index);
+    }
+    Slot& slot = mSlots[index];
+    assert(!slot.reload && "Id already in use in ResourceHolder::insert()");
+    slot.size = ResourceSize<T_Resource>::get(*resource);
+    slot.resource = std::move(resource);
+    slot.lastUse = ++mUseCount;
+    slot.numReferences = 0;
+    slot.reload = std::move(reload);
+    slot.filename = filename;
+    ++mStatistics.numResident;
+    mStatistics.residentBytes += slot.size;
+    PROFILE_LEVEL("Resources resident", 1);
+    enforceMemoryBudget(index);
+    return Handle(index, slot.generation);
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::finishLoad(PendingLoad& load)
+{
+    try
+    {
+        std::shared_ptr<T_Resource> resource;
+        if(load.cache)
+        {
+            typename Cache::Request request = load.cacheRequest.get();
+            resource = load.cache->finalize(request);
+            //Every holder released the resource since it was decoded.
+            if(!resource)
+                resource = load.reload();
+        }
+        else
+            resource = Loader::finalize(load.decoded.get());
+        load.loaded.set_value(insert(load.id, std::move(resource), load.filename, std::move(load.reload)));
+    }
+    catch(...)
+    {
+        if(load.batch && !load.batch->error)
+            load.batch->error = std::current_exception();
+        load.loaded.set_exception(std::current_exception());
+    }
+
+    if(load.batch)
+    {
+        Batch& batch = *load.batch;
+        ++batch.numFinished;
+        if(batch.onProgress)
+            batch.onProgress(batch.numFinished, batch.numLoads);
+        if(batch.numFinished == batch.numLoads)
+        {
+            if(batch.error)
+                batch.finished.set_exception(batch.error);
+            else
+                batch.finished.set_value();
+        }
+    }
+}
+
+
+template<typename T_Id, typename T_Resource>
+bool ResourceHolder<T_Id, T_Resource>::isDecoded(const PendingLoad& load)
+{
+    if(load.cache)
+        return load.cacheRequest.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    return load.decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+
+template<typename T_Id, typename T_Resource>
+T_Resource& ResourceHolder<T_Id, T_Resource>::touch(std::uint32_t index)
+{
+    Slot& slot = mSlots[index];
+    if(!slot.resource)
+        reload(index);
+    slot.lastUse = ++mUseCount;
+    return *slot.resource;
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::reload(std::uint32_t index)
+{
+    PROFILE_ZONE("ResourceHolder::reload");
+    Slot& slot = mSlots[index];
+    std::shared_ptr<T_Resource> resource;
+    try
+    {
+        resource = slot.reload();
+    }
+    catch(const std::exception& exception)
+    {
+        throw std::runtime_error("ResourceHolder failed to reload " + slot.filename + ": " + exception.what());
+    }
+    slot.size = ResourceSize<T_Resource>::get(*resource);
+    slot.resource = std::move(resource);
+    ++mStatistics.numResident;
+    mStatistics.residentBytes += slot.size;
+    ++mStatistics.numReloads;
+    PROFILE_LEVEL("Resources resident", 1);
+    enforceMemoryBudget(index);
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::evict(std::uint32_t index)
+{
+    Slot& slot = mSlots[index];
+    slot.resource.reset();
+    --mStatistics.numResident;
+    mStatistics.residentBytes -= slot.size;
+    ++mStatistics.numEvictions;
+    PROFILE_LEVEL("Resources resident", -1);
+}
+
+
+template<typename T_Id, typename T_Resource>
+void ResourceHolder<T_Id, T_Resource>::enforceMemoryBudget(std::uint32_t keptIndex)
+{
+    if(mMemoryBudget == 0 || mStatistics.residentBytes <= mMemoryBudget)
+        return;
+    //Eviction is rare next to get(), so a use count per slot and a sort here beat maintaining a list on every get().
+    std::vector<std::uint32_t> candidates;
+    for(std::uint32_t index = 0; index < mSlots.size(); ++index)
+    {
+        const Slot& slot = mSlots[index];
+        if(slot.resource && slot.numReferences == 0 && index != keptIndex)
+            candidates.push_back(index);
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](std::uint32_t left, std::uint32_t right)
+    {
+        return mSlots[left].lastUse < mSlots[right].lastUse;
+    });
+    for(std::uint32_t index : candidates)
+    {
+        if(mStatistics.residentBytes <= mMemoryBudget)
+            break;
+        evict(index);
+    }
+}
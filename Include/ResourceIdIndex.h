@@ -0,0 +1,123 @@
+#ifndef ResourceIdIndex_h
+#define ResourceIdIndex_h
+
+
+
+#include "MemoryResource.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+
+//Ids of enum types with a Count enumerator, whose enumerators before Count run contiguously from zero.
+template<typename T_Id, typename T_Enable = void>
+struct IsDenseResourceId : std::false_type
+{
+};
+
+
+template<typename T_Id>
+struct IsDenseResourceId<T_Id, decltype(void(T_Id::Count))> : std::is_enum<T_Id>
+{
+};
+
+
+/*----------------------------------------------------------------------------------
+How ResourceHolder finds the storage slot of a resource id.  Any id type ordered
+by operator< is looked up in a std::map, and its resources take whatever slots are
+free.  Dense enum ids (see IsDenseResourceId) are specialized so that each
+enumerator owns the slot of its own value, making a lookup a plain array index.
+----------------------------------------------------------------------------------*/
+template<typename T_Id, typename T_Enable = void>
+class ResourceIdIndex
+{
+public:
+    static const std::uint32_t NoSlot = 0xFFFFFFFF;
+    //Slots reserved for the ids up front; the rest are allocated on demand.
+    static const std::size_t NumFixedSlots = 0;
+
+
+public:
+    explicit ResourceIdIndex(MemoryResource* memoryResource)
+    :mSlots(std::less<T_Id>(), memoryResource)
+    {
+    }
+
+
+    std::uint32_t find(T_Id id) const
+    {
+        auto searchResult = mSlots.find(id);
+        return searchResult == mSlots.end() ? NoSlot : searchResult->second;
+    }
+
+
+    void insert(T_Id id, std::uint32_t slot)
+    {
+        auto insertSuccess = mSlots.insert(std::make_pair(id, slot)).second;
+        assert(insertSuccess && "Id already in use in ResourceIdIndex::insert()");
+        (void)insertSuccess;
+    }
+
+
+    void erase(T_Id id)
+    {
+        mSlots.erase(id);
+    }
+
+private:
+    std::map<T_Id, std::uint32_t, std::less<T_Id>, PolymorphicAllocator<std::pair<const T_Id, std::uint32_t>>> mSlots;
+};
+
+
+template<typename T_Id>
+class ResourceIdIndex<T_Id, typename std::enable_if<IsDenseResourceId<T_Id>::value>::type>
+{
+public:
+    static const std::uint32_t NoSlot = 0xFFFFFFFF;
+    static const std::size_t NumFixedSlots = static_cast<std::size_t>(T_Id::Count);
+
+
+public:
+    explicit ResourceIdIndex(MemoryResource*)
+    {
+    }
+
+
+    std::uint32_t find(T_Id id) const
+    {
+        assert(static_cast<std::size_t>(id) < NumFixedSlots && "Id out of range in ResourceIdIndex::find()");
+        return static_cast<std::uint32_t>(id);
+    }
+
+
+    void insert(T_Id id, std::uint32_t slot)
+    {
+        assert(slot == static_cast<std::uint32_t>(id) && "Slot is not the id's own in ResourceIdIndex::insert()");
+        (void)id;
+        (void)slot;
+    }
+
+
+    void erase(T_Id id)
+    {
+        (void)id;
+    }
+};
+
+
+template<typename T_Id, typename T_Enable>
+const std::uint32_t ResourceIdIndex<T_Id, T_Enable>::NoSlot;
+template<typename T_Id, typename T_Enable>
+const std::size_t ResourceIdIndex<T_Id, T_Enable>::NumFixedSlots;
+template<typename T_Id>
+const std::uint32_t ResourceIdIndex<T_Id, typename std::enable_if<IsDenseResourceId<T_Id>::value>::type>::NoSlot;
+template<typename T_Id>
+const std::size_t ResourceIdIndex<T_Id, typename std::enable_if<IsDenseResourceId<T_Id>::value>::type>::NumFixedSlots;
+
+
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ResourceKey_h
+#define ResourceKey_h
+
+
+
+#include <string>
+#include <type_traits>
+
+
+/*----------------------------------------------------------------------------------
+Builds the keys under which ResourceCache shares resources.  A key starts with
+either the canonical path of the file or a digest of its contents, followed by the
+arguments the resource is loaded with, so that e.g. two areas of the same texture
+file stay separate resources.  Strings are appended as text and other arguments,
+such as enums and sf::IntRect, by their object representation.
+----------------------------------------------------------------------------------*/
+class ResourceKey
+{
+public:
+    //Absolute path with ".", ".." and symbolic links resolved.  Falls back to normalizing the path lexically if
+    //the file doesn't exist, in which case loading it will fail anyway.
+    static std::string canonicalizePath(const std::string& filename);
+    //Size and 64-bit FNV-1a hash of the file's contents.  Throws std::runtime_error if the file can't be read.
+    static std::string hashContents(const std::string& filename);
+    static void appendArgument(std::string& key, const std::string& argument);
+    static void appendArgument(std::string& key, const char* argument);
+    template<typename T_Argument>
+    static void appendArgument(std::string& key, const T_Argument& argument);
+
+private:
+    static std::string normalizePath(const std::string& filename);
+};
+
+
+template<typename T_Argument>
+void ResourceKey::appendArgument(std::string& key, const T_Argument& argument)
+{
+    static_assert(std::is_trivially_copyable<T_Argument>::value, "ResourceKey can't append this argument type; add an overload for it");
+    key += '\0';
+    key.append(reinterpret_cast<const char*>(&argument), sizeof(argument));
+}
+
+
+
+#endif
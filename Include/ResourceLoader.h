@@ -0,0 +1,155 @@
+#ifndef ResourceLoader_h
+#define ResourceLoader_h
+
+
+
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Shader.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+
+/*----------------------------------------------------------------------------------
+How ResourceHolder::loadAsync() loads a resource in two steps.  decode() runs on a
+worker thread and does the disk I/O and decoding; finalize() runs on the thread
+that owns the ResourceHolder and does the work that must happen there.  By default
+the whole loadFromFile() call is made on the worker and finalize() does nothing.
+Resources whose loading needs the OpenGL context, like sf::Texture and sf::Shader,
+are specialized to only read and decode files on the worker and to create the
+OpenGL objects in finalize().  decodeFromMemory() is the same as decode() for data
+that is already in memory, such as an AssetArchive entry.  Both steps throw
+std::runtime_error on failure.
+----------------------------------------------------------------------------------*/
+template<typename T_Resource>
+struct ResourceLoader
+{
+    using Decoded = T_Resource;
+
+    template<typename... T_Arguments>
+    static std::unique_ptr<Decoded> decode(const std::string& filename, const T_Arguments&... arguments)
+    {
+        std::unique_ptr<Decoded> resource(new T_Resource());
+        if(resource->loadFromFile(filename, arguments...) == false)
+            throw std::runtime_error("ResourceLoader::decode() failed to load " + filename);
+        return resource;
+    }
+
+
+    template<typename... T_Arguments>
+    static std::unique_ptr<Decoded> decodeFromMemory(const void* data, std::size_t sizeInBytes, const T_Arguments&... arguments)
+    {
+        std::unique_ptr<Decoded> resource(new T_Resource());
+        if(resource->loadFromMemory(data, sizeInBytes, arguments...) == false)
+            throw std::runtime_error("ResourceLoader::decodeFromMemory() failed to load a resource");
+        return resource;
+    }
+
+
+    static std::unique_ptr<T_Resource> finalize(std::unique_ptr<Decoded> decoded)
+    {
+        return decoded;
+    }
+};
+
+
+template<>
+struct ResourceLoader<sf::Texture>
+{
+    struct Decoded
+    {
+        sf::Image image;
+        sf::IntRect area;
+    };
+
+
+    static std::unique_ptr<Decoded> decode(const std::string& filename, const sf::IntRect& area = sf::IntRect())
+    {
+        std::unique_ptr<Decoded> decoded(new Decoded());
+        if(decoded->image.loadFromFile(filename) == false)
+            throw std::runtime_error("ResourceLoader::decode() failed to load " + filename);
+        decoded->area = area;
+        return decoded;
+    }
+
+
+    static std::unique_ptr<Decoded> decodeFromMemory(const void* data, std::size_t sizeInBytes, const sf::IntRect& area = sf::IntRect())
+    {
+        std::unique_ptr<Decoded> decoded(new Decoded());
+        if(decoded->image.loadFromMemory(data, sizeInBytes) == false)
+            throw std::runtime_error("ResourceLoader::decodeFromMemory() failed to load an image");
+        decoded->area = area;
+        return decoded;
+    }
+
+
+    static std::unique_ptr<sf::Texture> finalize(std::unique_ptr<Decoded> decoded)
+    {
+        std::unique_ptr<sf::Texture> texture(new sf::Texture());
+        if(texture->loadFromImage(decoded->image, decoded->area) == false)
+            throw std::runtime_error("ResourceLoader::finalize() failed to create a texture");
+        return texture;
+    }
+};
+
+
+template<>
+struct ResourceLoader<sf::Shader>
+{
+    struct Decoded
+    {
+        std::string source;
+        std::string fragmentSource;  //only for vertex and fragment pairs
+        sf::Shader::Type type;
+        bool isPair;
+    };
+
+
+    static std::string readFile(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if(!file)
+            throw std::runtime_error("ResourceLoader::decode() failed to load " + filename);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+
+
+    static std::unique_ptr<Decoded> decode(const std::string& filename, sf::Shader::Type type)
+    {
+        return std::unique_ptr<Decoded>(new Decoded{readFile(filename), std::string(), type, false});
+    }
+
+
+    static std::unique_ptr<Decoded> decode(const std::string& vertexFilename, const std::string& fragmentFilename)
+    {
+        return std::unique_ptr<Decoded>(new Decoded{readFile(vertexFilename), readFile(fragmentFilename), sf::Shader::Vertex, true});
+    }
+
+
+    static std::unique_ptr<Decoded> decodeFromMemory(const void* data, std::size_t sizeInBytes, sf::Shader::Type type)
+    {
+        return std::unique_ptr<Decoded>(new Decoded{std::string(static_cast<const char*>(data), sizeInBytes), std::string(), type, false});
+    }
+
+
+    static std::unique_ptr<sf::Shader> finalize(std::unique_ptr<Decoded> decoded)
+    {
+        std::unique_ptr<sf::Shader> shader(new sf::Shader());
+        bool success = decoded->isPair ? shader->loadFromMemory(decoded->source, decoded->fragmentSource)
+                                       : shader->loadFromMemory(decoded->source, decoded->type);
+        if(success == false)
+            throw std::runtime_error("ResourceLoader::finalize() failed to compile a shader");
+        return shader;
+    }
+};
+
+
+
+#endif
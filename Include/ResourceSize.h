@@ -0,0 +1,57 @@
+#ifndef ResourceSize_h
+#define ResourceSize_h
+
+
+
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Config.hpp>
+#include <cstddef>
+
+
+//Approximate number of bytes a resource occupies, for ResourceHolder's memory budget.  Resources whose
+//data size is unknown count as their object size; specialize this for them to make the budget meaningful.
+template<typename T_Resource>
+struct ResourceSize
+{
+    static std::size_t get(const T_Resource&)
+    {
+        return sizeof(T_Resource);
+    }
+};
+
+
+template<>
+struct ResourceSize<sf::Texture>
+{
+    //The pixels live in video memory, which is often shared with system memory.
+    static std::size_t get(const sf::Texture& texture)
+    {
+        return sizeof(sf::Texture) + static_cast<std::size_t>(texture.getSize().x) * texture.getSize().y * 4;
+    }
+};
+
+
+template<>
+struct ResourceSize<sf::Image>
+{
+    static std::size_t get(const sf::Image& image)
+    {
+        return sizeof(sf::Image) + static_cast<std::size_t>(image.getSize().x) * image.getSize().y * 4;
+    }
+};
+
+
+template<>
+struct ResourceSize<sf::SoundBuffer>
+{
+    static std::size_t get(const sf::SoundBuffer& soundBuffer)
+    {
+        return sizeof(sf::SoundBuffer) + static_cast<std::size_t>(soundBuffer.getSampleCount()) * sizeof(sf::Int16);
+    }
+};
+
+
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef SmallFunction_h
+#define SmallFunction_h
+
+
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+template<typename T_Signature, std::size_t T_Capacity = 4 * sizeof(void*)>
+class SmallFunction;
+
+
+//Whether an lvalue of T_Function can be called with T_Signature's arguments and its result converted to T_Signature's.
+template<typename T_Function, typename T_Signature, typename = void>
+struct IsCallableAs : std::false_type
+{
+};
+
+
+template<typename T_Function, typename T_Result, typename... T_Arguments>
+struct IsCallableAs<T_Function, T_Result(T_Arguments...), decltype(void(std::declval<T_Function&>()(std::declval<T_Arguments>()...)))>
+: std::integral_constant<bool, std::is_void<T_Result>::value || std::is_convertible<decltype(std::declval<T_Function&>()(std::declval<T_Arguments>()...)), T_Result>::value>
+{
+};
+
+
+/*----------------------------------------------------------------------------------
+Copyable function wrapper like std::function, but with a guaranteed inline buffer of
+T_Capacity bytes, so that storing a callable no bigger than that never allocates.
+The default capacity holds a lambda capturing four pointers, or a std::function
+itself, so existing callers passing a std::function don't allocate either.
+Callables that are too large or might throw when moved are stored on the heap.
+----------------------------------------------------------------------------------*/
+template<typename T_Result, typename... T_Arguments, std::size_t T_Capacity>
+class SmallFunction<T_Result(T_Arguments...), T_Capacity>
+{
+public:
+    SmallFunction()
+    :mOperations(nullptr)
+    {
+    }
+
+
+    SmallFunction(std::nullptr_t)
+    :mOperations(nullptr)
+    {
+    }
+
+
+    //Only for callables, so that overloads taking other types and SmallFunction's own copy and move constructors
+    //aren't hijacked, e.g. by a non-const SmallFunction&.
+    template<typename T_Function, typename = typename std::enable_if<!std::is_same<typename std::decay<T_Function>::type, SmallFunction>::value
+                                                                     && IsCallableAs<typename std::decay<T_Function>::type, T_Result(T_Arguments...)>::value>::type>
+    SmallFunction(T_Function&& function)
+    :mOperations(nullptr)
+    {
+        assign(std::forward<T_Function>(function));
+    }
+
+
+    SmallFunction(const SmallFunction& other)
+    :mOperations(other.mOperations)
+    {
+        if(mOperations != nullptr)
+            mOperations->copy(&other.mStorage, &mStorage);
+    }
+
+
+    SmallFunction(SmallFunction&& other) noexcept
+    :mOperations(other.mOperations)
+    {
+        if(mOperations != nullptr)
+        {
+            mOperations->move(&other.mStorage, &mStorage);
+            other.mOperations = nullptr;
+        }
+    }
+
+
+    ~SmallFunction()
+    {
+        reset();
+    }
+
+
+    SmallFunction& operator=(const SmallFunction& other)
+    {
+        if(this != &other)
+            *this = SmallFunction(other);
+        return *this;
+    }
+
+
+    SmallFunction& operator=(SmallFunction&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            if(other.mOperations != nullptr)
+            {
+                other.mOperations->move(&other.mStorage, &mStorage);
+                mOperations = other.mOperations;
+                other.mOperations = nullptr;
+            }
+        }
+        return *this;
+    }
+
+
+    void swap(SmallFunction& other)
+    {
+        SmallFunction temporary(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temporary);
+    }
+
+
+    explicit operator bool() const
+    {
+        return mOperations != nullptr;
+    }
+
+
+    T_Result operator()(T_Arguments... arguments) const
+    {
+        assert(mOperations != nullptr && "Empty SmallFunction called");
+        return mOperations->invoke(&mStorage, std::forward<T_Arguments>(arguments)...);
+    }
+
+private:
+    using Storage = typename std::aligned_storage<T_Capacity, alignof(double)>::type;
+
+    //One table per stored type, so that a SmallFunction is the buffer plus one pointer.
+    struct Operations
+    {
+        T_Result (*invoke)(const Storage*, T_Arguments&&...);
+        void (*copy)(const Storage*, Storage*);
+        void (*move)(Storage*, Storage*);  //leaves the source destroyed
+        void (*destroy)(Storage*);
+    };
+
+    template<typename T_Function>
+    struct Inline
+    {
+        static T_Function& get(const Storage* storage)
+        {
+            return *const_cast<T_Function*>(reinterpret_cast<const T_Function*>(storage));
+        }
+
+        template<typename T_Source>
+        static void construct(Storage* storage, T_Source&& function)
+        {
+            new(storage) T_Function(std::forward<T_Source>(function));
+        }
+
+        static T_Result invoke(const Storage* storage, T_Arguments&&... arguments)
+        {
+            return get(storage)(std::forward<T_Arguments>(arguments)...);
+        }
+
+        static void copy(const Storage* source, Storage* destination)
+        {
+            new(destination) T_Function(get(source));
+        }
+
+        static void move(Storage* source, Storage* destination)
+        {
+            new(destination) T_Function(std::move(get(source)));
+            get(source).~T_Function();
+        }
+
+        static void destroy(Storage* storage)
+        {
+            get(storage).~T_Function();
+        }
+
+        static const Operations* getOperations()
+        {
+            static const Operations operations{&invoke, &copy, &move, &destroy};
+            return &operations;
+        }
+    };
+
+    template<typename T_Function>
+    struct Heap
+    {
+        static T_Function*& get(const Storage* storage)
+        {
+            return *const_cast<T_Function**>(reinterpret_cast<T_Function* const*>(storage));
+        }
+
+        template<typename T_Source>
+        static void construct(Storage* storage, T_Source&& function)
+        {
+            new(storage) T_Function*(new T_Function(std::forward<T_Source>(function)));
+        }
+
+        static T_Result invoke(const Storage* storage, T_Arguments&&... arguments)
+        {
+            return (*get(storage))(std::forward<T_Arguments>(arguments)...);
+        }
+
+        static void copy(const Storage* source, Storage* destination)
+        {
+            new(destination) T_Function*(new T_Function(*get(source)));
+        }
+
+        static void move(Storage* source, Storage* destination)
+        {
+            new(destination) T_Function*(get(source));
+        }
+
+        static void destroy(Storage* storage)
+        {
+            delete get(storage);
+        }
+
+        static const Operations* getOperations()
+        {
+            static const Operations operations{&invoke, &copy, &move, &destroy};
+            return &operations;
+        }
+    };
+
+
+private:
+    template<typename T_Function>
+    void assign(T_Function&& function)
+    {
+        using Function = typename std::decay<T_Function>::type;
+        using Stored = typename std::conditional<sizeof(Function) <= sizeof(Storage) && alignof(Function) <= alignof(Storage)
+                                                 && std::is_nothrow_move_constructible<Function>::value, Inline<Function>, Heap<Function>>::type;
+        if(isEmpty(function))
+            return;
+        //Only the selected storage is instantiated, so oversized callables never see the inline placement new.
+        Stored::construct(&mStorage, std::forward<T_Function>(function));
+        mOperations = Stored::getOperations();
+    }
+
+
+    //Wrapping an empty std::function or a null function pointer gives an empty SmallFunction.
+    template<typename T_Function>
+    static bool isEmpty(const T_Function& function)
+    {
+        return isEmpty(function, 0);
+    }
+
+
+    template<typename T_Function>
+    static auto isEmpty(const T_Function& function, int) -> decltype(static_cast<bool>(function == nullptr))
+    {
+        return function == nullptr;
+    }
+
+
+    template<typename T_Function>
+    static bool isEmpty(const T_Function&, long)
+    {
+        return false;
+    }
+
+
+    void reset()
+    {
+        if(mOperations != nullptr)
+        {
+            mOperations->destroy(&mStorage);
+            mOperations = nullptr;
+        }
+    }
+
+
+private:
+    mutable Storage mStorage;
+    const Operations* mOperations;  //null when empty
+};
+
+
+
+#endif
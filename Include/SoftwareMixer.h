@@ -0,0 +1,117 @@
+#ifndef SoftwareMixer_h
+#define SoftwareMixer_h
+
+
+
+#include "LockFreeQueue.h"
+#include "SoundPlayer.h"
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/Audio/SoundStream.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Mixes short one-shot sounds in software into a single stereo sf::SoundStream, so
+that they use one OpenAL source in total instead of one each.  Voices are resampled
+for pitch with linear interpolation, scaled by their gain and panned with constant
+power; spatialized sounds only get distance attenuation and left/right panning.
+The voices live on the stream's thread and are only touched there; playSound() may
+be called from any thread and passes the request through a LockFreeQueue.  At most
+maxVoices sounds play at once and further requests are dropped, so the cost of a
+block is bounded.  The inner loops have SSE2 and AVX2 versions besides the scalar
+one, and the best one the CPU supports is picked at construction.  Buffers must be
+mono or stereo 16-bit samples, and must outlive the sounds played from them.
+----------------------------------------------------------------------------------*/
+class SoftwareMixer : public sf::SoundStream
+{
+public:
+    enum class Kernel{
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+
+public:
+    explicit SoftwareMixer(std::size_t maxVoices = 4096, unsigned sampleRate = 44100, std::size_t blockSize = 1024);
+    ~SoftwareMixer();
+    //Thread safe.  Returns false if the request was dropped because too many are pending.
+    //pan ranges from -1 (left) to 1 (right).
+    bool playSound(const sf::SoundBuffer& soundBuffer, float volume = 100.0f, float pitch = 1.0f, float pan = 0.0f);
+    //Attenuated like SoundPlayer::computeAudibleVolume() and panned by the sideways offset from the listener,
+    //which is read on the calling thread.
+    bool playSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo);
+    //Thread safe.  Returns false if too many requests are pending.
+    bool stopAllSounds();
+    std::size_t getNumActiveVoices() const;
+    //Requests dropped because the command queue was full or every voice was busy.
+    std::uint64_t getNumDroppedSounds() const;
+    static bool isKernelSupported(Kernel kernel);
+    void setKernel(Kernel kernel);
+    Kernel getKernel() const;
+    //Render numFrames stereo frames of the mix into output.  Called by the stream's thread while playing;
+    //public for offline rendering and benchmarks, which must not call it while the stream plays.
+    void mix(sf::Int16* output, std::size_t numFrames);
+
+protected:
+    virtual bool onGetData(Chunk& data) override;
+    virtual void onSeek(sf::Time timeOffset) override;
+
+private:
+    //Adds a mono or stereo voice to the accumulators; see SoftwareMixer.cpp.
+    using VoiceKernel = void(*)(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain, 
+                                float* left, float* right, std::size_t numFrames);
+
+    struct Command
+    {
+        enum Type : std::uint8_t{
+            Play,
+            StopAll
+        };
+
+        Type type;
+        const sf::SoundBuffer* buffer;
+        float leftGain;
+        float rightGain;
+        float pitch;
+    };
+
+    struct Voice
+    {
+        const sf::Int16* samples;
+        std::uint32_t numFrames;
+        std::uint32_t channelCount;
+        std::uint64_t position;  //in source frames, 32.32 fixed point
+        std::uint64_t step;  //source frames per output frame, 32.32 fixed point
+        float leftGain;
+        float rightGain;
+    };
+
+
+private:
+    void executeCommands();
+    //Add up to numFrames frames of the voice to the accumulators.  Returns false once the voice has ended.
+    bool mixVoice(Voice& voice, std::size_t numFrames, VoiceKernel monoKernel, VoiceKernel stereoKernel);
+
+
+private:
+    static const std::size_t sCommandCapacity = 4096;
+
+    LockFreeQueue<Command> mCommands;
+    std::vector<Voice> mVoices;  //active voices, only touched by the thread that mixes
+    std::size_t mMaxVoices;
+    std::size_t mBlockSize;
+    std::vector<float> mLeft;  //accumulators for one block
+    std::vector<float> mRight;
+    std::vector<sf::Int16> mOutput;  //the chunk handed to sf::SoundStream
+    std::atomic<std::size_t> mNumActiveVoices;
+    std::atomic<std::uint64_t> mNumDroppedSounds;
+    std::atomic<Kernel> mKernel;
+};
+
+
+
+#endif
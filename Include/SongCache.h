@@ -0,0 +1,81 @@
+#ifndef SongCache_h
+#define SongCache_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Keeps the encoded contents of song files in memory, so that reopening a song, e.g.
+to resume a saved Playlist, costs no disk I/O.  Songs are decoded from the cached
+bytes through sf::InputSoundFile::openFromMemory().  The cache evicts the least
+recently used songs once it holds more than its byte budget, skipping songs that
+are pinned or still being played from, since evicting those would free nothing.
+All member functions are thread safe.
+----------------------------------------------------------------------------------*/
+class SongCache : sf::NonCopyable
+{
+public:
+    using Data = std::vector<char>;
+
+    //Cumulative since construction or the last resetStatistics().
+    struct Statistics
+    {
+        std::uint64_t numHits{0};
+        std::uint64_t numMisses{0};
+        std::uint64_t numEvictions{0};
+        std::uint64_t numBytesRead{0};  //read from disk on misses
+    };
+
+
+public:
+    explicit SongCache(std::size_t budget = 64 * 1024 * 1024);
+    //The cached contents of filename, reading the whole file on a miss.  Throws std::runtime_error if it can't be read.
+    std::shared_ptr<const Data> load(const std::string& filename);
+    //Keep a cached song resident regardless of the budget until every pin is released.  Returns false if the
+    //song is not cached.
+    bool pin(const std::string& filename);
+    void unpin(const std::string& filename);
+    bool isCached(const std::string& filename) const;
+    void setBudget(std::size_t budget);
+    std::size_t getBudget() const;
+    //Bytes held, which may exceed the budget while pinned or playing songs do.
+    std::size_t getSize() const;
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+private:
+    struct Entry
+    {
+        std::string filename;
+        std::shared_ptr<const Data> data;
+        unsigned numPins;
+    };
+
+
+private:
+    //Evict from the least recently used end until the budget is met or nothing more can go.
+    void evict();
+
+
+private:
+    mutable std::mutex mMutex;
+    std::list<Entry> mEntries;  //most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> mEntryLookup;
+    std::size_t mBudget;
+    std::size_t mSize;
+    Statistics mStatistics;
+};
+
+
+
+#endif
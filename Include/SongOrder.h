@@ -0,0 +1,44 @@
+#ifndef SongOrder_h
+#define SongOrder_h
+
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+The order in which a Playlist's songs play during one cycle, identified by a seed
+alone.  A seed of zero keeps the Playlist's own order; any other seed gives a
+shuffle that is the same on every platform and standard library, so shuffles can
+be reproduced for replays.  The permutation itself is only materialized when a
+position is first looked up, and is kept until the seed or Playlist size changes,
+so storing an order costs eight bytes.  Switching back to an earlier seed
+materializes its permutation again, in one pass over the Playlist.  Each cycle's
+seed follows from the previous one.
+----------------------------------------------------------------------------------*/
+class SongOrder
+{
+public:
+    SongOrder();
+    //Index into the Playlist of the song at position, materializing the permutation if needed.
+    std::size_t getIndex(std::uint64_t seed, std::size_t numSongs, std::size_t position);
+    //Index of the song at position zero, without materializing the permutation.
+    static std::size_t getFirstIndex(std::uint64_t seed, std::size_t numSongs);
+    //The seed of the cycle after the one that seed identifies.  Zero stays zero, any other seed stays nonzero.
+    static std::uint64_t getNextCycleSeed(std::uint64_t seed);
+
+private:
+    void materialize(std::uint64_t seed, std::size_t numSongs);
+
+
+private:
+    std::vector<std::uint32_t> mIndices;
+    std::uint64_t mSeed;  //seed and size that mIndices was materialized for
+    std::size_t mNumSongs;
+};
+
+
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SongTable_h
+#define SongTable_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Interns song paths, so that each is stored once however many Playlists contain it
+and songs can be referred to by a small integer SongId.  Ids are dense, starting
+from zero, and stay valid for the lifetime of the table.
+----------------------------------------------------------------------------------*/
+class SongTable : sf::NonCopyable
+{
+public:
+    using SongId = std::uint32_t;
+    static const SongId InvalidSongId = 0xFFFFFFFF;
+
+
+public:
+    //Returns the existing SongId if path was interned before.
+    SongId intern(const std::string& path);
+    const std::string& getPath(SongId songId) const;
+    std::size_t getNumSongs() const;
+
+private:
+    std::unordered_map<std::string, SongId> mSongIds;
+    std::vector<const std::string*> mPaths;  //the keys of mSongIds, whose nodes never move
+};
+
+
+
+#endif
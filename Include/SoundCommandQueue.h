@@ -0,0 +1,94 @@
+#ifndef SoundCommandQueue_h
+#define SoundCommandQueue_h
+
+
+
+#include "LockFreeQueue.h"
+#include "MemoryResource.h"
+#include "SoundPlayer.h"
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Vector3.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+
+/*----------------------------------------------------------------------------------
+Lets any thread trigger and control sounds on a SoundPlayer, which itself may only
+be used by the thread that owns it.  Producers push commands into a preallocated
+LockFreeQueue, never blocking or allocating; if the queue is full, the command is
+rejected and counted.  The consumer side keeps the handles of the playing sounds in
+a map allocated from the given MemoryResource, e.g. the PoolResource of the
+SoundPlayer, so executing commands doesn't allocate from the global heap either.
+Since a sound only gets a SoundPlayer::SoundHandle when the command is executed,
+playSound() returns a Ticket instead, which later commands use to refer to the
+sound.  The thread that owns the SoundPlayer, e.g. a dedicated audio thread or the
+main thread, calls execute() to run the commands before update().
+----------------------------------------------------------------------------------*/
+class SoundCommandQueue : sf::NonCopyable
+{
+public:
+    using Ticket = std::uint64_t;
+    static const Ticket InvalidTicket = 0;
+
+
+public:
+    //capacity must be a power of two.
+    explicit SoundCommandQueue(std::size_t capacity = 1024, MemoryResource* memoryResource = MemoryResource::getDefault());
+
+    //Producer side; safe to call from any thread.  Each returns InvalidTicket or false if the queue is full.
+    //The buffer must outlive the sound.
+    Ticket playSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo = SoundInfo());
+    //Fire and forget; goes through SoundPlayer::queueSound(), so it may be merged with other requests.
+    bool queueSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo = SoundInfo());
+    bool stopSound(Ticket ticket);
+    bool setPosition(Ticket ticket, const sf::Vector3f& position);
+    bool setVolume(Ticket ticket, float volume);
+    bool setPitch(Ticket ticket, float pitch);
+    std::uint64_t getNumRejectedCommands() const;
+
+    //Consumer side; only one thread may call this, and it must be the one that uses soundPlayer.
+    //Returns the number of commands executed.
+    std::size_t execute(SoundPlayer& soundPlayer);
+
+private:
+    struct Command
+    {
+        enum Type : std::uint8_t{
+            Play,
+            Queue,
+            Stop,
+            SetPosition,
+            SetVolume,
+            SetPitch
+        };
+
+        Type type;
+        Ticket ticket;
+        const sf::SoundBuffer* buffer;
+        SoundInfo info;  //parameter changes use the matching field
+    };
+
+
+private:
+    bool push(const Command& command);
+    //Remove the tickets of sounds that have finished, once the map has grown enough to be worth it.
+    void forgetFinishedSounds(const SoundPlayer& soundPlayer);
+
+
+private:
+    LockFreeQueue<Command> mCommands;
+    std::atomic<Ticket> mNextTicket;
+    std::atomic<std::uint64_t> mNumRejectedCommands;
+    //Consumer side only.
+    std::unordered_map<Ticket, SoundPlayer::SoundHandle, std::hash<Ticket>, std::equal_to<Ticket>,
+                       PolymorphicAllocator<std::pair<const Ticket, SoundPlayer::SoundHandle>>> mPlayingSounds;
+    std::size_t mSweepThreshold;
+};
+
+
+
+#endif
@@ -3,11 +3,18 @@
 
 
 
-#include <SFML\Audio\Sound.hpp>
-#include <SFML\System\NonCopyable.hpp>
-#include <SFML\System\Vector3.hpp>
+#include "MemoryResource.h"
+#include <SFML/Audio/Sound.hpp>
+#include <SFML/Audio/SoundBuffer.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector3.hpp>
 #include <cassert>
-#include <list>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 
 
 //P.O.D. that contains all information needed to specify a sound's properties.
@@ -19,25 +26,183 @@ struct SoundInfo
     float pitch{1.0f};
     float minDistance{200.0f};
     float attenuation{8.0f};
+    int priority{0};  //higher priorities are the last to be stolen under StealPolicy::LowestPriority
+    bool loop{false};  //e.g. ambient emitters, which play until stopped
 };
 
 
 /*----------------------------------------------------------------------------------
-Manager and player of sounds.  Sounds must be periodically removed via a call to 
-removeStoppedSounds in order to stay under the limit of simultaneous sounds and music.
+Manager and player of sounds.  The sounds are played on a fixed pool of voices that
+is allocated up front, so the number of simultaneous sounds never exceeds the pool
+size.  A free voice is acquired in constant time, preferring one that last played
+the sound's buffer, since rebinding a voice to another buffer allocates inside SFML;
+each buffer keeps a list of its free voices for that.  If every voice is busy, the
+StealPolicy picks the least important playing sound, which gives up its voice to the
+new one, unless the new sound is even less important.  Picking it scans the playing
+sounds, so stealing is linear in their number.
+A sound without a voice, or one too far away to hear, is a virtual voice: it costs
+no hardware source and only its playback position is advanced by update().  When it
+comes within hearing range and a voice is available, it becomes real again at the
+correct playing offset; a real sound that moves out of range becomes virtual again.
+Gameplay code should prefer queueSound(), which batches the requests of a frame:
+requests for the same buffer within the merge window are merged into one louder
+play, and each buffer has a cap on its concurrent instances, beyond which requests
+are dropped.  update() must be called every frame; it starts the queued sounds.
 The sounds can be positioned in 3d space.
  ----------------------------------------------------------------------------------*/
 class SoundPlayer : sf::NonCopyable
 {
 public:
-    void playSound(sf::SoundBuffer& soundBuffer, SoundInfo soundInfo = SoundInfo());
-    //Should be called periodically(though not necessarily each frame) to remove finished sounds
-    void removeStoppedSounds();
-    
+    enum class StealPolicy{
+        LowestPriority, //lowest SoundInfo::priority, then the oldest
+        Quietest, //lowest volume after distance attenuation
+        Farthest //farthest from the listener
+    };
+
+    //Identifies a played sound, whether real or virtual.  Goes stale, without becoming ambiguous,
+    //once the sound has finished or been stopped.
+    struct SoundHandle
+    {
+        std::uint32_t sound;
+        std::uint32_t generation;
+    };
+    static const SoundHandle InvalidHandle;
+
+    struct CoalescingSettings
+    {
+        sf::Time mergeWindow{sf::milliseconds(50)};  //requests this soon after a play of the same buffer join it
+        float volumeBoostPerMerge{0.1f};  //fraction of the volume added per merged request, capped at 100
+        unsigned maxInstancesPerBuffer{8};  //real and virtual
+    };
+
+    //Cumulative since construction or the last resetStatistics().
+    struct Statistics
+    {
+        std::uint64_t numRequests{0};  //playSound() and queueSound() calls
+        std::uint64_t numMerged{0};  //requests merged into another play
+        std::uint64_t numDropped{0};  //requests dropped by the per-buffer instance limit
+        std::uint64_t numStarted{0};
+    };
+
+
+public:
+    //OpenAL implementations typically allow 256 sources in total, shared with music streams.
+    //Every container of the player allocates from memoryResource, which must outlive it.  A PoolResource
+    //suits the per-buffer states, which are allocated the first time each buffer plays.
+    explicit SoundPlayer(std::size_t numVoices = 32, StealPolicy stealPolicy = StealPolicy::LowestPriority, MemoryResource* memoryResource = MemoryResource::getDefault());
+    ~SoundPlayer();
+    //Start a sound immediately, without merging.  The sound starts virtual if it is inaudible or every
+    //voice is taken by a more important sound.  Returns InvalidHandle if the buffer is at its instance
+    //limit.  The buffer must outlive the sound.
+    SoundHandle playSound(const sf::SoundBuffer& soundBuffer, SoundInfo soundInfo = SoundInfo());
+    //Request a sound to be started by the next update(), merged with other requests for the same buffer.
+    void queueSound(const sf::SoundBuffer& soundBuffer, SoundInfo soundInfo = SoundInfo());
+    void stopSound(SoundHandle handle);
+    void setPosition(SoundHandle handle, const sf::Vector3f& position);
+    void setVolume(SoundHandle handle, float volume);
+    void setPitch(SoundHandle handle, float pitch);
+    bool isPlaying(SoundHandle handle) const;
+    bool isVirtual(SoundHandle handle) const;
+    //Start the queued sounds, advance virtual sounds, release finished ones and move sounds between real
+    //and virtual as the listener or the sounds move.  Should be called once per frame.
+    void update(sf::Time deltaTime);
+    void setStealPolicy(StealPolicy stealPolicy);
+    //Sounds quieter than this, in the range [0, 100] of SoundInfo::volume, are made virtual.
+    void setAudibilityThreshold(float volume);
+    void setCoalescingSettings(const CoalescingSettings& settings);
+    const Statistics& getStatistics() const;
+    void resetStatistics();
+    std::size_t getNumVoices() const;
+    std::size_t getNumActiveVoices() const;
+    std::size_t getNumVirtualVoices() const;
+    //Volume in [0, 100] heard by a listener at listenerPosition, following OpenAL's default inverse distance model.
+    static float computeAudibleVolume(const SoundInfo& soundInfo, const sf::Vector3f& listenerPosition);
+
 private:
-    std::list<sf::Sound> mSounds;
+    template<typename T_Value>
+    using Vector = std::vector<T_Value, PolymorphicAllocator<T_Value>>;
+
+    struct BufferState
+    {
+        unsigned numInstances{0};
+        SoundHandle lastPlay{InvalidHandle};
+        sf::Time lastPlayTime;
+        std::uint32_t firstFreeVoice{sInvalidIndex};  //free voices bound to the buffer, linked through VoiceState
+    };
+
+    struct VoiceState
+    {
+        BufferState* bufferState{nullptr};  //of the buffer the voice is bound to
+        std::uint32_t freeIndex{sInvalidIndex};  //position in mFreeVoices, sInvalidIndex while playing
+        std::uint32_t previousFree{sInvalidIndex};  //neighbours among the free voices of the same buffer
+        std::uint32_t nextFree{sInvalidIndex};
+    };
+
+    struct QueuedSound
+    {
+        const sf::SoundBuffer* buffer;
+        SoundInfo info;
+        std::uint32_t order;  //keeps the requests for a buffer in order when sorted
+    };
+
+    struct Instance
+    {
+        const sf::SoundBuffer* buffer{nullptr};
+        BufferState* bufferState{nullptr};
+        SoundInfo info;
+        sf::Time playingOffset;  //only kept up to date while virtual
+        std::uint32_t voice{sInvalidIndex};  //sInvalidIndex while virtual
+        std::uint32_t generation{1};
+        std::uint32_t activeIndex{0};  //position in mActiveInstances while playing
+        std::uint64_t startOrder{0};  //to break ties in favour of stealing the oldest sound
+    };
+
+    struct PromotionCandidate
+    {
+        float importance;
+        float audibleVolume;
+        std::uint32_t instance;
+    };
+
+
+private:
+    bool isAlive(SoundHandle handle) const;
+    SoundHandle startSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo);
+    void flushQueuedSounds();
+    //Give the instance a voice, stealing one if needed.  Returns false if no voice could be had.
+    bool makeReal(std::uint32_t instance, const sf::Vector3f& listenerPosition, bool winsTies);
+    void makeVirtual(std::uint32_t instance);
+    void releaseInstance(std::uint32_t instance);
+    void pushFreeVoice(std::uint32_t voice);
+    //A free voice bound to bufferState's buffer if there is one, otherwise the last one freed.
+    std::uint32_t popFreeVoice(const BufferState& bufferState);
+    //Larger means more important to keep playing under the current StealPolicy.
+    float computeImportance(const Instance& instance, const sf::Vector3f& listenerPosition) const;
+
+
+private:
+    static const std::uint32_t sInvalidIndex = 0xFFFFFFFF;
+    //A real sound must drop this far below the threshold to become virtual, so it does not flip every frame.
+    static const float sHysteresis;
+
+    Vector<sf::Sound> mVoices;
+    Vector<VoiceState> mVoiceStates;
+    Vector<std::uint32_t> mFreeVoices;
+    Vector<Instance> mInstances;
+    Vector<std::uint32_t> mFreeInstances;
+    Vector<std::uint32_t> mActiveInstances;  //real and virtual
+    Vector<PromotionCandidate> mPromotionCandidates;  //scratch space for update()
+    std::unordered_map<const sf::SoundBuffer*, BufferState, std::hash<const sf::SoundBuffer*>, std::equal_to<const sf::SoundBuffer*>,
+                       PolymorphicAllocator<std::pair<const sf::SoundBuffer* const, BufferState>>> mBufferStates;
+    Vector<QueuedSound> mQueuedSounds;
+    CoalescingSettings mCoalescingSettings;
+    Statistics mStatistics;
+    sf::Time mTime;  //total time passed to update()
+    StealPolicy mStealPolicy;
+    float mAudibilityThreshold;
+    std::uint64_t mNumSoundsStarted;
 };
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,99 @@
+#ifndef SpriteBatch_h
+#define SpriteBatch_h
+
+
+
+#include "AnimationSystem.h"
+#include <SFML/Graphics/Drawable.hpp>
+#include <SFML/Graphics/PrimitiveType.hpp>
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Transform.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/System/NonCopyable.hpp>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Draws the sprites of an AnimationSystem with one draw call per texture.  Every
+sprite is a quad (two triangles) in the vertex array of its texture's batch.  
+update() only rewrites the quads of sprites whose frame changed, as reported by
+AnimationSystem::getChangedSprites(), or whose transform changed.  Building the
+vertices touches no graphics resources, so update() and getVertices() also work
+without a window or GPU.  Sprites that are culled should be removed from the batch,
+otherwise they are still drawn.  A sprite removed from the AnimationSystem drops
+out of the batch at the next update(), and one that reuses its id is not batched
+until it is added.  Only AnimationSystem sprites are batched: AnimatedSprite objects
+keep their own state and report no changes, so they are drawn one by one.
+----------------------------------------------------------------------------------*/
+class SpriteBatch : public sf::Drawable, sf::NonCopyable
+{
+public:
+    using SpriteId = AnimationSystem::SpriteId;
+
+
+public:
+    //The AnimationSystem must outlive the SpriteBatch.
+    explicit SpriteBatch(const AnimationSystem& animationSystem);
+    //The sprite must already have an animation set.
+    void addSprite(SpriteId id, const sf::Texture& texture, const sf::Transform& transform = sf::Transform::Identity);
+    //Also takes the id of a sprite already removed from the AnimationSystem.
+    void removeSprite(SpriteId id);
+    //Whether the live sprite with this id is batched; a quad left by a removed sprite with the same id doesn't count.
+    bool contains(SpriteId id) const;
+    void setTransform(SpriteId id, const sf::Transform& transform);
+    //Rewrite the quads of changed sprites.  Must be called after every AnimationSystem::update(),
+    //since the system only reports the changes of its last update.
+    void update();
+    //One batch per texture, in the order the textures were first added.
+    std::size_t getNumBatches() const;
+    const sf::Texture& getTexture(std::size_t batchIndex) const;
+    const std::vector<sf::Vertex>& getVertices(std::size_t batchIndex) const;
+    //Number of quads the last update() rewrote.
+    std::size_t getNumQuadsRewritten() const;
+    
+private:
+    struct Batch
+    {
+        const sf::Texture* texture;
+        std::vector<SpriteId> spriteIds;  //one per quad
+        std::vector<sf::Transform> transforms;
+        std::vector<sf::Vertex> vertices;  //sVerticesPerQuad per sprite
+    };
+    
+    struct Location
+    {
+        std::uint32_t batch;
+        std::uint32_t quad;
+        std::uint32_t generation;  //of the sprite's id in the AnimationSystem
+    };
+    
+    
+private:
+    virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
+    bool hasQuad(SpriteId id) const;
+    //The quad was left by a sprite that has been removed from the AnimationSystem.
+    bool isStale(SpriteId id) const;
+    //Rewrite the sprite's quad, or erase it if it is stale.
+    void refreshQuad(SpriteId id);
+    void eraseQuad(SpriteId id);
+    void writeQuad(Batch& batch, std::uint32_t quad);
+    
+    
+private:
+    static const std::uint32_t sVerticesPerQuad = 6;
+    static const std::uint32_t sInvalidBatch = 0xFFFFFFFF;
+    
+    const AnimationSystem& mAnimationSystem;
+    std::vector<Batch> mBatches;
+    std::vector<Location> mLocations;  //indexed by SpriteId, including stale ones
+    std::vector<SpriteId> mTransformedSprites;  //sprites added or transformed since the last update()
+    std::size_t mNumQuadsRewritten;
+};
+
+
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+
+
+#include <SFML/System/NonCopyable.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+A fixed-size pool of worker threads.  Tasks are queued with enqueue(), which returns
+a std::future for the task's result.  parallelFor() splits a range into a fixed 
+number of contiguous chunks that workers claim one at a time; since chunk boundaries
+do not depend on which thread runs a chunk, per-chunk results can be merged in chunk
+order to get the same output on every run, regardless of the number of threads.
+parallelFor() doesn't allocate: the pool keeps one job, which has a slot for each
+worker that joins it, so calls to it from several threads run one after another.
+----------------------------------------------------------------------------------*/
+class ThreadPool : sf::NonCopyable
+{
+public:
+    //Zero threads means one fewer than the hardware concurrency, since the calling thread helps in parallelFor().
+    explicit ThreadPool(unsigned numThreads = 0);
+    //Finishes the queued tasks before joining the workers.
+    ~ThreadPool();
+    unsigned getNumThreads() const;
+    template<typename T_Function>
+    auto enqueue(T_Function&& task) -> std::future<decltype(task())>;
+    //Call body(chunkIndex, begin, end) for each of numChunks chunks of [0, count).  The calling
+    //thread works on chunks too and the function returns once every chunk is done.  Must not be
+    //called from inside a body.
+    template<typename T_Body>
+    void parallelFor(std::size_t count, std::size_t numChunks, const T_Body& body);
+    
+private:
+    using ChunkFunction = void (*)(const void* body, std::size_t chunk, std::size_t begin, std::size_t end);
+
+    //The parallelFor() in progress.  The members other than nextChunk are only written while holding mMutex.
+    struct Job
+    {
+        ChunkFunction function{nullptr};
+        const void* body{nullptr};
+        std::size_t count{0};
+        std::size_t numChunks{0};
+        std::atomic<std::size_t> nextChunk{0};
+        std::size_t numOpenSlots{0};  //workers that may still join
+        std::size_t numHelpers{0};  //workers that joined and haven't left yet
+    };
+
+
+private:
+    void runJob(std::size_t count, std::size_t numChunks, ChunkFunction function, const void* body);
+    //Claim and run chunks of mJob until none are left.
+    void runChunks();
+    void workerLoop();
+    
+    
+private:
+    std::vector<std::thread> mWorkers;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mTaskAvailable;
+    std::mutex mJobMutex;  //held for the whole of a parallelFor()
+    Job mJob;
+    std::condition_variable mHelpersLeft;
+    bool mStopping;
+};
+
+#include "ThreadPool.inl"
+
+
+#endif
@@ -0,0 +1,28 @@
+#include "ThreadPool.h"
+
+
+template<typename T_Function>
+auto ThreadPool::enqueue(T_Function&& task) -> std::future<decltype(task())>
+{
+    //std::function requires a copyable target, so the packaged_task is shared.
+    using Result = decltype(task());
+    auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<T_Function>(task));
+    std::future<Result> future = packagedTask->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push([packagedTask](){ (*packagedTask)(); });
+    }
+    mTaskAvailable.notify_one();
+    return future;
+}
+
+
+template<typename T_Body>
+void ThreadPool::parallelFor(std::size_t count, std::size_t numChunks, const T_Body& body)
+{
+    //The body is called through a plain function pointer, so that no std::function has to be built.
+    runJob(count, numChunks, [](const void* function, std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+        (*static_cast<const T_Body*>(function))(chunk, begin, end);
+    }, &body);
+}
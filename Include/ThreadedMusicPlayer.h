@@ -0,0 +1,131 @@
+#ifndef ThreadedMusicPlayer_h
+#define ThreadedMusicPlayer_h
+
+
+
+#include "MusicPlayer.h"
+#include <SFML/System/NonCopyable.hpp>
+#include <SFML/System/Time.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+
+/*----------------------------------------------------------------------------------
+Runs a MusicPlayer on a thread of its own, so that neither its logic nor opening
+songs costs the game thread anything.  Calls are queued as commands and return
+immediately.  The music thread sleeps until a command arrives, a stream runs out of
+samples, a prefetch finishes or the current song is due to end, instead of being
+polled every frame.  The game thread reads the status and drains Events with
+pollEvent(); errors that MusicPlayer would throw arrive as Error events.  When
+update() keeps failing, e.g. on a missing file, the music thread retries after a
+delay that doubles up to sMaxErrorDelayMs, and an Error repeating the last queued
+one is dropped.  At most sMaxEvents Events are kept; older ones are discarded.
+----------------------------------------------------------------------------------*/
+template<typename T_PlaylistId>
+class ThreadedMusicPlayer : public sf::NonCopyable
+{
+public:
+    using Player = MusicPlayer<T_PlaylistId>;
+    using Status = typename Player::Status;
+    using Playlist = typename Player::Playlist;
+
+    struct Event
+    {
+        enum Type{
+            SongChanged,
+            StatusChanged,
+            Error
+        };
+
+        Type type;
+        Status status;  //the status after the event
+        int songIndex;  //position in the current order, for SongChanged
+        std::string filename;  //the new song for SongChanged, empty once the Playlist is cleared
+        std::string message;  //for Error
+    };
+
+
+public:
+    //The player's containers allocate from memoryResource on the music thread only.
+    explicit ThreadedMusicPlayer(MemoryResource* memoryResource = MemoryResource::getDefault());
+    //Drops the commands still queued.
+    ~ThreadedMusicPlayer();
+
+    //Queued; these mirror MusicPlayer.
+    void storePlaylist(const T_PlaylistId& id, Playlist&& playlist);
+    void setVolume(float newVolume);
+    void setCrossfade(sf::Time duration);
+    void play();
+    void pause();
+    void stopSong();
+    void stopPlaylist();
+    void nextSong();
+    void previousSong();
+    void loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic = false, std::uint64_t seed = 0);
+    void popCurrentPlaylist();
+    void resetStatistics();
+
+    //As of the last command or update the music thread has finished.
+    Status getMusicStatus() const;
+    float getVolume() const;
+    int getNumSavedPlaylists() const;
+    typename Player::Statistics getStatistics() const;
+    //The player's SongCache, which is thread safe itself.
+    SongCache& getSongCache();
+    //Returns false once no Event is left.
+    bool pollEvent(Event& event);
+
+private:
+    static const sf::Int64 sMinErrorDelayMs = 20;
+    static const sf::Int64 sMaxErrorDelayMs = 1000;
+    static const std::size_t sMaxEvents = 256;
+
+
+private:
+    void pushCommand(std::function<void(Player&)> command);
+    void wake();
+    void run();
+    //Execute one command or update(), turning exceptions into Error events, then report what changed.
+    //Returns false if it threw.
+    bool step(const std::function<void(Player&)>& command);
+    void pushEvent(const Event& event);
+
+
+private:
+    //Declared before mPlayer: its streams and prefetch tasks call wake() until it is destroyed.
+    std::mutex mMutex;
+    std::condition_variable mWakeCondition;
+    std::queue<std::function<void(Player&)>> mCommands;
+    bool mWakeRequested;
+    bool mStopping;
+
+    Player mPlayer;  //only used by the music thread
+
+    mutable std::mutex mEventMutex;
+    std::deque<Event> mEvents;
+    typename Player::Statistics mStatistics;
+    std::atomic<Status> mStatus;
+    std::atomic<float> mVolume;
+    std::atomic<int> mNumSavedPlaylists;
+    //The music thread's view of the last reported state.
+    std::size_t mNumSongChanges;
+
+    std::thread mThread;  //started last, once everything it uses exists
+};
+
+#include "ThreadedMusicPlayer.inl"
+
+
+#endif
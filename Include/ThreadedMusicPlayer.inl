@@ -0,0 +1,319 @@
+#include "ThreadedMusicPlayer.h"
+
+
+template<typename T_PlaylistId>
+const sf::Int64 ThreadedMusicPlayer<T_PlaylistId>::sMinErrorDelayMs;
+template<typename T_PlaylistId>
+const sf::Int64 ThreadedMusicPlayer<T_PlaylistId>::sMaxErrorDelayMs;
+template<typename T_PlaylistId>
+const std::size_t ThreadedMusicPlayer<T_PlaylistId>::sMaxEvents;
+
+
+template<typename T_PlaylistId>
+ThreadedMusicPlayer<T_PlaylistId>::ThreadedMusicPlayer(MemoryResource* memoryResource)
+:mWakeRequested(false),
+mStopping(false),
+mPlayer(memoryResource),
+mStatus(Status::Empty),
+mVolume(100.0f),
+mNumSavedPlaylists(0),
+mNumSongChanges(0)
+{
+    mPlayer.setWakeCallback([this]()
+    {
+        wake();
+    });
+    mThread = std::thread(&ThreadedMusicPlayer::run, this);
+}
+
+
+template<typename T_PlaylistId>
+ThreadedMusicPlayer<T_PlaylistId>::~ThreadedMusicPlayer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWakeCondition.notify_one();
+    mThread.join();
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::storePlaylist(const T_PlaylistId& id, Playlist&& playlist)
+{
+    //std::function must be copyable, so the Playlist is moved into a shared one.
+    auto sharedPlaylist = std::make_shared<Playlist>(std::move(playlist));
+    pushCommand([id, sharedPlaylist](Player& player)
+    {
+        player.storePlaylist(id, std::move(*sharedPlaylist));
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::setVolume(float newVolume)
+{
+    mVolume.store(newVolume);
+    pushCommand([newVolume](Player& player)
+    {
+        player.setVolume(newVolume);
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::setCrossfade(sf::Time duration)
+{
+    pushCommand([duration](Player& player)
+    {
+        player.setCrossfade(duration);
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::play()
+{
+    pushCommand([](Player& player)
+    {
+        player.play();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::pause()
+{
+    pushCommand([](Player& player)
+    {
+        player.pause();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::stopSong()
+{
+    pushCommand([](Player& player)
+    {
+        player.stopSong();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::stopPlaylist()
+{
+    pushCommand([](Player& player)
+    {
+        player.stopPlaylist();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::nextSong()
+{
+    pushCommand([](Player& player)
+    {
+        player.nextSong();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::previousSong()
+{
+    pushCommand([](Player& player)
+    {
+        player.previousSong();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::loadPlaylist(T_PlaylistId id, bool looped, bool shuffle, bool saveCurrentMusic, std::uint64_t seed)
+{
+    pushCommand([id, looped, shuffle, saveCurrentMusic, seed](Player& player)
+    {
+        player.loadPlaylist(id, looped, shuffle, saveCurrentMusic, seed);
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::popCurrentPlaylist()
+{
+    pushCommand([](Player& player)
+    {
+        player.popCurrentPlaylist();
+    });
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::resetStatistics()
+{
+    pushCommand([](Player& player)
+    {
+        player.resetStatistics();
+    });
+}
+
+
+template<typename T_PlaylistId>
+typename ThreadedMusicPlayer<T_PlaylistId>::Status ThreadedMusicPlayer<T_PlaylistId>::getMusicStatus() const
+{
+    return mStatus.load();
+}
+
+
+template<typename T_PlaylistId>
+float ThreadedMusicPlayer<T_PlaylistId>::getVolume() const
+{
+    return mVolume.load();
+}
+
+
+template<typename T_PlaylistId>
+int ThreadedMusicPlayer<T_PlaylistId>::getNumSavedPlaylists() const
+{
+    return mNumSavedPlaylists.load();
+}
+
+
+template<typename T_PlaylistId>
+typename ThreadedMusicPlayer<T_PlaylistId>::Player::Statistics ThreadedMusicPlayer<T_PlaylistId>::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mEventMutex);
+    return mStatistics;
+}
+
+
+template<typename T_PlaylistId>
+SongCache& ThreadedMusicPlayer<T_PlaylistId>::getSongCache()
+{
+    return mPlayer.getSongCache();
+}
+
+
+template<typename T_PlaylistId>
+bool ThreadedMusicPlayer<T_PlaylistId>::pollEvent(Event& event)
+{
+    std::lock_guard<std::mutex> lock(mEventMutex);
+    if(mEvents.empty())
+        return false;
+    event = std::move(mEvents.front());
+    mEvents.pop_front();
+    return true;
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::pushCommand(std::function<void(Player&)> command)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCommands.push(std::move(command));
+    }
+    mWakeCondition.notify_one();
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mWakeRequested = true;
+    }
+    mWakeCondition.notify_one();
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::run()
+{
+    sf::Time delay = sf::microseconds(-1);
+    sf::Time errorDelay = sf::Time::Zero;
+    while(true)
+    {
+        std::queue<std::function<void(Player&)>> commands;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            auto hasWork = [this]()
+            {
+                return mStopping || mWakeRequested || mCommands.empty() == false;
+            };
+            if(delay < sf::Time::Zero)
+                mWakeCondition.wait(lock, hasWork);
+            else
+                mWakeCondition.wait_for(lock, std::chrono::microseconds(delay.asMicroseconds()), hasWork);
+            if(mStopping)
+                return;
+            mWakeRequested = false;
+            std::swap(commands, mCommands);
+        }
+        for(; commands.empty() == false; commands.pop())
+            step(commands.front());
+        bool updated = step([](Player& player)
+        {
+            player.update();
+        });
+        delay = mPlayer.getNextUpdateDelay();
+        //A failing update() leaves the player Playing with nothing to wait for, so it would be retried at once.
+        if(updated)
+            errorDelay = sf::Time::Zero;
+        else
+            errorDelay = std::min(std::max(errorDelay * sf::Int64(2), sf::milliseconds(sMinErrorDelayMs)), sf::milliseconds(sMaxErrorDelayMs));
+        if(delay >= sf::Time::Zero)
+            delay = std::max(delay, errorDelay);
+    }
+}
+
+
+template<typename T_PlaylistId>
+bool ThreadedMusicPlayer<T_PlaylistId>::step(const std::function<void(Player&)>& command)
+{
+    bool succeeded = true;
+    try
+    {
+        command(mPlayer);
+    }
+    catch(const std::exception& exception)
+    {
+        pushEvent(Event{Event::Error, mPlayer.getMusicStatus(), mPlayer.getCurrentSongIndex(), std::string(), exception.what()});
+        succeeded = false;
+    }
+
+    Status status = mPlayer.getMusicStatus();
+    if(mPlayer.getNumSongChanges() != mNumSongChanges || (status == Status::Empty && mStatus.load() != Status::Empty))
+    {
+        mNumSongChanges = mPlayer.getNumSongChanges();
+        const std::string* song = mPlayer.getCurrentSong();
+        pushEvent(Event{Event::SongChanged, status, mPlayer.getCurrentSongIndex(), song ? *song : std::string(), std::string()});
+    }
+    if(status != mStatus.load())
+    {
+        mStatus.store(status);
+        pushEvent(Event{Event::StatusChanged, status, mPlayer.getCurrentSongIndex(), std::string(), std::string()});
+    }
+    mNumSavedPlaylists.store(mPlayer.getNumSavedPlaylists());
+    std::lock_guard<std::mutex> lock(mEventMutex);
+    mStatistics = mPlayer.getStatistics();
+    return succeeded;
+}
+
+
+template<typename T_PlaylistId>
+void ThreadedMusicPlayer<T_PlaylistId>::pushEvent(const Event& event)
+{
+    std::lock_guard<std::mutex> lock(mEventMutex);
+    if(event.type == Event::Error && mEvents.empty() == false && mEvents.back().type == Event::Error 
+       && mEvents.back().message == event.message)
+        return;
+    if(mEvents.size() == sMaxEvents)
+        mEvents.pop_front();
+    mEvents.push_back(event);
+}
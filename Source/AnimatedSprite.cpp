@@ -1,96 +1,134 @@
 #include "AnimatedSprite.h"
+#include "Profiler.h"
+#include <utility>
 
 
 std::vector<AnimatedSprite::AnimationSequenceSet> AnimatedSprite::sAnimations;
+std::vector<AnimatedSprite::FrameDurationSet> AnimatedSprite::sFrameDurations;
+AnimationTable AnimatedSprite::sAnimationTable;
 
 AnimatedSprite::AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId)
 :mObjectId(objectId),
-mCurrentAnimationSequence(nullptr),
-mCallback([](){})
+mCurrentSequence(nullptr),
+mCurrentFrameEndTimes(nullptr),
+mNumFrames(0),
+mCurrentFrame(0),
+mFinished(false),
+mCallback([](){}),
+mCallbackConditions(Never)
 {
-    assert(objectId >= 0 && objectId < sAnimations.size() && "AnimatedSprite() failed due to objectId being out of vector bounds.");
+    buildAnimationTableIfEmpty();
+    assert(objectId < sAnimationTable.getNumObjects() && "AnimatedSprite() failed due to objectId being out of bounds of sAnimationTable.");
 }
 
 
 AnimatedSprite::AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId, const sf::Texture& texture)
 :sf::Sprite(texture),
 mObjectId(objectId),
-mCurrentAnimationSequence(nullptr),
-mCallback([](){})
+mCurrentSequence(nullptr),
+mCurrentFrameEndTimes(nullptr),
+mNumFrames(0),
+mCurrentFrame(0),
+mFinished(false),
+mCallback([](){}),
+mCallbackConditions(Never)
 {
-    assert(objectId >= 0 && objectId < sAnimations.size() && "AnimatedSprite() failed due to objectId being out of vector bounds.");
+    buildAnimationTableIfEmpty();
+    assert(objectId < sAnimationTable.getNumObjects() && "AnimatedSprite() failed due to objectId being out of bounds of sAnimationTable.");
 }
 
 
 AnimatedSprite::AnimatedSprite(std::vector<AnimationSequenceSet>::size_type objectId, const sf::Texture& texture, const sf::IntRect& textureSubRectangle)
 :sf::Sprite(texture, textureSubRectangle),
 mObjectId(objectId),
-mCurrentAnimationSequence(nullptr),
-mCallback([](){})
+mCurrentSequence(nullptr),
+mCurrentFrameEndTimes(nullptr),
+mNumFrames(0),
+mCurrentFrame(0),
+mFinished(false),
+mCallback([](){}),
+mCallbackConditions(Never)
 {
-    assert(objectId >= 0 && objectId < sAnimations.size() && "AnimatedSprite() failed due to objectId being out of vector bounds.");
+    buildAnimationTableIfEmpty();
+    assert(objectId < sAnimationTable.getNumObjects() && "AnimatedSprite() failed due to objectId being out of bounds of sAnimationTable.");
 }
 
 
-void AnimatedSprite::setAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, unsigned numLoops, CallbackConditions callbackConditions, std::function<void()> callback)
+void AnimatedSprite::buildAnimationTableIfEmpty()
+{
+    if(sAnimationTable.isEmpty() && !sAnimations.empty())
+        sAnimationTable.build(sAnimations, sFrameDurations);
+}
+
+
+void AnimatedSprite::setAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, unsigned numLoops, CallbackConditions callbackConditions, Callback callback)
 {
-    assert(animationId >= 0 && animationId < sAnimations[mObjectId].size() && "animationId is out of vector bounds in AnimatedSprite::setAnimation()");
     assert(timePerFrame > sf::Time::Zero && "encountered: timePerFrame less than or equal to zero in AnimatedSprite::setAnimation");
-    
-    if(mCallbackConditions & AnimationSwitch)
-        mCallback();
-    mCurrentFrame = sAnimations[mObjectId][animationId].begin();
-    mTimePerFrame = timePerFrame;
-    mAccumulatedFrameTime = sf::Time::Zero;
-    mContinuouslyLooping = false;
-    mNumLoopsRemaining = numLoops;
-    mCallback = callback;
+    assert(numLoops > 0 && "numLoops must be greater than 0 in AnimatedSprite::setAnimation");
+    beginAnimation(animationId, timePerFrame, numLoops, false, callbackConditions, std::move(callback));
 }
 
 
-void AnimatedSprite::setContinuouslyLoopingAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, CallbackConditions callbackConditions, std::function<void()> callback)
+void AnimatedSprite::setContinuouslyLoopingAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, CallbackConditions callbackConditions, Callback callback)
 {
-    assert(animationId >= 0 && animationId < sAnimations[mObjectId].size() && "animationId is out of vector bounds in AnimatedSprite::setContinuouslyLoopingAnimation()");
     assert(timePerFrame > sf::Time::Zero && "encountered: timePerFrame less than or equal to zero in AnimatedSprite::setContinuouslyLoopingAnimation");
-    
-    if(mCallbackConditions & AnimationSwitch)
-        mCallback();
-    mCurrentFrame = sAnimations[mObjectId][animationId].begin();
-    mTimePerFrame = timePerFrame;
-    mAccumulatedFrameTime = sf::Time::Zero;
-    mContinuouslyLooping = true;
-    mCallback = callback;
+    beginAnimation(animationId, timePerFrame, 0, true, callbackConditions, std::move(callback));
+}
+
+
+void AnimatedSprite::setAnimation(std::vector<AnimationSequence>::size_type animationId, unsigned numLoops, CallbackConditions callbackConditions, Callback callback)
+{
+    assert(numLoops > 0 && "numLoops must be greater than 0 in AnimatedSprite::setAnimation");
+    beginAnimation(animationId, sf::Time::Zero, numLoops, false, callbackConditions, std::move(callback));
+}
+
+
+void AnimatedSprite::setContinuouslyLoopingAnimation(std::vector<AnimationSequence>::size_type animationId, CallbackConditions callbackConditions, Callback callback)
+{
+    beginAnimation(animationId, sf::Time::Zero, 0, true, callbackConditions, std::move(callback));
 }
 
 
 bool AnimatedSprite::update(sf::Time deltaTime)
 {
-    assert(mCurrentAnimationSequence != nullptr && "AnimatedSprite::update() called before an animation sequence was set.");
-    assert(deltaTime < sf::Time::Zero && "AnimatedSprite::update() passed sf::Time arg with a negative value");
+    assert(mCurrentSequence != nullptr && "AnimatedSprite::update() called before an animation sequence was set.");
+    assert(deltaTime >= sf::Time::Zero && "AnimatedSprite::update() passed sf::Time arg with a negative value");
     
-    mAccumulatedFrameTime += deltaTime;
-    if(mAccumulatedFrameTime >= mTimePerFrame)
+    if(mFinished)
+        return true;
+    PROFILE_FRAME_COUNT("Sprites updated", 1);
+    mElapsedLoopTime += deltaTime;
+    std::uint64_t numLoopEnds = 0;
+    if(mElapsedLoopTime >= mLoopDuration)
     {
-        ++mCurrentFrame;
-        mAccumulatedFrameTime = sf::Time::Zero;
-        if(mCurrentFrame == mCurrentAnimationSequence->end())
+        std::int64_t elapsed = mElapsedLoopTime.asMicroseconds();
+        numLoopEnds = AnimationTable::wrapLoops(elapsed, mLoopDuration.asMicroseconds(), mContinuouslyLooping, mNumLoopsRemaining, mFinished);
+        mElapsedLoopTime = sf::microseconds(elapsed);
+    }
+    
+    //A finished animation keeps showing its last frame.
+    std::uint32_t frame = mFinished ? mNumFrames - 1 : getFrameAt(mElapsedLoopTime);
+    if(frame != mCurrentFrame)
+    {
+        mCurrentFrame = frame;
+        setTextureRect(mCurrentSequence[mCurrentFrame]);
+    }
+    
+    if(mFinished)
+    {
+        if(mCallbackConditions & EachLoopEnd)
         {
-            if(mContinuouslyLooping == true || --mNumLoopsRemaining > 0)
-            {
-                mCurrentFrame = mCurrentAnimationSequence->begin();
-                setTextureRect(*mCurrentFrame);
-                if(mCallbackConditions & EachLoopEnd)
-                    mCallback();
-            }
-            else
-            {
-                if(mCallbackConditions & EachLoopEnd | AnimationCompletion)
-                    mCallback();
-                return true;
-            }
+            for(std::uint64_t i = 1; i < numLoopEnds; ++i)
+                mCallback();
         }
-        else
-            setTextureRect(*mCurrentFrame);
+        if(mCallbackConditions & (EachLoopEnd | AnimationCompletion))
+            mCallback();
+        return true;
+    }
+    if(mCallbackConditions & EachLoopEnd)
+    {
+        for(std::uint64_t i = 0; i < numLoopEnds; ++i)
+            mCallback();
     }
     return false;
 }
@@ -99,4 +137,37 @@ bool AnimatedSprite::update(sf::Time deltaTime)
 void AnimatedSprite::executeCallback()
 {
     mCallback();
-}
\ No newline at end of file
+}
+
+
+void AnimatedSprite::beginAnimation(std::vector<AnimationSequence>::size_type animationId, sf::Time timePerFrame, unsigned numLoops, bool continuouslyLooping, CallbackConditions callbackConditions, Callback&& callback)
+{
+    assert(animationId < sAnimationTable.getNumAnimations(mObjectId) && "animationId is out of bounds in AnimatedSprite::setAnimation()");
+    const AnimationTable::Sequence& sequence = sAnimationTable.getSequence(mObjectId, animationId);
+    assert(sequence.numFrames > 0 && "AnimatedSprite was given an empty AnimationSequence");
+    assert((timePerFrame > sf::Time::Zero || sAnimationTable.hasFrameDurations(sequence)) && "AnimatedSprite::setAnimation() requires a timePerFrame for animations without frame durations");
+    
+    if(mCallbackConditions & AnimationSwitch)
+        mCallback();
+    mCurrentSequence = sAnimationTable.getFrames(sequence);
+    mCurrentFrameEndTimes = sAnimationTable.getFrameEndTimes(sequence);
+    mNumFrames = sequence.numFrames;
+    mCurrentFrame = 0;
+    setTextureRect(mCurrentSequence[mCurrentFrame]);
+    mTimePerFrame = timePerFrame;
+    mLoopDuration = timePerFrame > sf::Time::Zero ? timePerFrame * static_cast<sf::Int64>(mNumFrames) : sAnimationTable.getLoopDuration(sequence);
+    mElapsedLoopTime = sf::Time::Zero;
+    mContinuouslyLooping = continuouslyLooping;
+    mFinished = false;
+    mNumLoopsRemaining = numLoops;
+    mCallback = std::move(callback);
+    mCallbackConditions = callbackConditions;
+}
+
+
+std::uint32_t AnimatedSprite::getFrameAt(sf::Time elapsedLoopTime) const
+{
+    if(mTimePerFrame > sf::Time::Zero)
+        return static_cast<std::uint32_t>(elapsedLoopTime.asMicroseconds() / mTimePerFrame.asMicroseconds());
+    return AnimationTable::findFrame(mCurrentFrameEndTimes, mNumFrames, elapsedLoopTime.asMicroseconds());
+}
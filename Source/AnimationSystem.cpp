@@ -0,0 +1,524 @@
+#include "AnimationSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+
+const std::uint32_t AnimationSystem::sInvalidIndex;
+const std::size_t AnimationSystem::sMinSpritesPerChunk;
+
+
+AnimationSystem::AnimationSystem(MemoryResource* memoryResource)
+:mSpriteIds(memoryResource),
+mObjectIds(memoryResource),
+mFirstFrames(memoryResource),
+mFrameEndTimes(memoryResource),
+mFrameCounts(memoryResource),
+mFrameIndices(memoryResource),
+mElapsedMicroseconds(memoryResource),
+mFrameEndMicroseconds(memoryResource),
+mMicrosecondsPerFrame(memoryResource),
+mLoopMicroseconds(memoryResource),
+mRunningMasks(memoryResource),
+mLoopsRemaining(memoryResource),
+mFlags(memoryResource),
+mCallbackConditions(memoryResource),
+mFrameDue(memoryResource),
+mDormantSince(memoryResource),
+mCallbacks(memoryResource),
+mDenseIndices(memoryResource),
+mIdGenerations(memoryResource),
+mFreeIds(memoryResource),
+mPendingCallbacks(memoryResource),
+mChunkCallbacks(memoryResource),
+mChangedSprites(memoryResource),
+mNumReportedChanges(0),
+mChunkChanges(memoryResource),
+mNumAwake(0),
+mClockMicroseconds(0),
+mLazyCallbackPolicy(LazyCallbackPolicy::DeliverAll)
+{
+}
+
+
+AnimationSystem::SpriteId AnimationSystem::addSprite(ObjectId objectId)
+{
+    AnimatedSprite::buildAnimationTableIfEmpty();
+    assert(objectId < AnimatedSprite::sAnimationTable.getNumObjects() && "AnimationSystem::addSprite() failed due to objectId being out of bounds of sAnimationTable.");
+
+    SpriteId id;
+    if(mFreeIds.empty())
+    {
+        id = static_cast<SpriteId>(mDenseIndices.size());
+        mDenseIndices.push_back(sInvalidIndex);
+        mIdGenerations.push_back(0);
+    }
+    else
+    {
+        id = mFreeIds.back();
+        mFreeIds.pop_back();
+    }
+    std::uint32_t index = static_cast<std::uint32_t>(mSpriteIds.size());
+    mDenseIndices[id] = index;
+    mSpriteIds.push_back(id);
+    mObjectIds.push_back(objectId);
+    mFirstFrames.push_back(nullptr);
+    mFrameEndTimes.push_back(nullptr);
+    mFrameCounts.push_back(0);
+    mFrameIndices.push_back(0);
+    mElapsedMicroseconds.push_back(0);
+    mFrameEndMicroseconds.push_back(std::numeric_limits<std::int64_t>::max());
+    mMicrosecondsPerFrame.push_back(0);
+    mLoopMicroseconds.push_back(0);
+    mRunningMasks.push_back(0);
+    mLoopsRemaining.push_back(0);
+    mFlags.push_back(0);
+    mCallbackConditions.push_back(AnimatedSprite::Never);
+    mFrameDue.push_back(0);
+    mDormantSince.push_back(0);
+    mCallbacks.push_back([](){});
+    //New sprites start awake, so move the sprite in front of the dormant ones.
+    swapEntries(index, mNumAwake++);
+    return id;
+}
+
+
+void AnimationSystem::removeSprite(SpriteId id)
+{
+    std::uint32_t index = denseIndex(id);
+    if(index < mNumAwake)
+    {
+        swapEntries(index, --mNumAwake);
+        index = mNumAwake;
+    }
+    swapEntries(index, static_cast<std::uint32_t>(mSpriteIds.size() - 1));
+    mSpriteIds.pop_back();
+    mObjectIds.pop_back();
+    mFirstFrames.pop_back();
+    mFrameEndTimes.pop_back();
+    mFrameCounts.pop_back();
+    mFrameIndices.pop_back();
+    mElapsedMicroseconds.pop_back();
+    mFrameEndMicroseconds.pop_back();
+    mMicrosecondsPerFrame.pop_back();
+    mLoopMicroseconds.pop_back();
+    mRunningMasks.pop_back();
+    mLoopsRemaining.pop_back();
+    mFlags.pop_back();
+    mCallbackConditions.pop_back();
+    mFrameDue.pop_back();
+    mDormantSince.pop_back();
+    mCallbacks.pop_back();
+    mDenseIndices[id] = sInvalidIndex;
+    //Callbacks already queued for the removed sprite must not reach a sprite that reuses its id.
+    ++mIdGenerations[id];
+    mFreeIds.push_back(id);
+    mChangedSprites.push_back(id);
+}
+
+
+bool AnimationSystem::contains(SpriteId id) const
+{
+    return id < mDenseIndices.size() && mDenseIndices[id] != sInvalidIndex;
+}
+
+
+std::uint32_t AnimationSystem::getGeneration(SpriteId id) const
+{
+    assert(id < mIdGenerations.size() && "AnimationSystem::getGeneration() was passed a SpriteId that was never handed out.");
+    return mIdGenerations[id];
+}
+
+
+bool AnimationSystem::hasAnimation(SpriteId id) const
+{
+    return (mFlags[denseIndex(id)] & HasAnimation) != 0;
+}
+
+
+std::size_t AnimationSystem::getSpriteCount() const
+{
+    return mSpriteIds.size();
+}
+
+
+void AnimationSystem::reserve(std::size_t numSprites)
+{
+    mSpriteIds.reserve(numSprites);
+    mObjectIds.reserve(numSprites);
+    mFirstFrames.reserve(numSprites);
+    mFrameEndTimes.reserve(numSprites);
+    mFrameCounts.reserve(numSprites);
+    mFrameIndices.reserve(numSprites);
+    mElapsedMicroseconds.reserve(numSprites);
+    mFrameEndMicroseconds.reserve(numSprites);
+    mMicrosecondsPerFrame.reserve(numSprites);
+    mLoopMicroseconds.reserve(numSprites);
+    mRunningMasks.reserve(numSprites);
+    mLoopsRemaining.reserve(numSprites);
+    mFlags.reserve(numSprites);
+    mCallbackConditions.reserve(numSprites);
+    mFrameDue.reserve(numSprites);
+    mDormantSince.reserve(numSprites);
+    mCallbacks.reserve(numSprites);
+    mDenseIndices.reserve(numSprites);
+    mIdGenerations.reserve(numSprites);
+}
+
+
+void AnimationSystem::setAnimation(SpriteId id, AnimationId animationId, sf::Time timePerFrame, unsigned numLoops, CallbackConditions callbackConditions, Callback callback)
+{
+    assert(timePerFrame > sf::Time::Zero && "encountered: timePerFrame less than or equal to zero in AnimationSystem::setAnimation");
+    assert(numLoops > 0 && "numLoops must be greater than 0 in AnimationSystem::setAnimation");
+    beginAnimation(denseIndex(id), animationId, timePerFrame, numLoops, false, callbackConditions, std::move(callback));
+}
+
+
+void AnimationSystem::setContinuouslyLoopingAnimation(SpriteId id, AnimationId animationId, sf::Time timePerFrame, CallbackConditions callbackConditions, Callback callback)
+{
+    assert(timePerFrame > sf::Time::Zero && "encountered: timePerFrame less than or equal to zero in AnimationSystem::setContinuouslyLoopingAnimation");
+    beginAnimation(denseIndex(id), animationId, timePerFrame, 0, true, callbackConditions, std::move(callback));
+}
+
+
+void AnimationSystem::setAnimation(SpriteId id, AnimationId animationId, unsigned numLoops, CallbackConditions callbackConditions, Callback callback)
+{
+    assert(numLoops > 0 && "numLoops must be greater than 0 in AnimationSystem::setAnimation");
+    beginAnimation(denseIndex(id), animationId, sf::Time::Zero, numLoops, false, callbackConditions, std::move(callback));
+}
+
+
+void AnimationSystem::setContinuouslyLoopingAnimation(SpriteId id, AnimationId animationId, CallbackConditions callbackConditions, Callback callback)
+{
+    beginAnimation(denseIndex(id), animationId, sf::Time::Zero, 0, true, callbackConditions, std::move(callback));
+}
+
+
+void AnimationSystem::update(sf::Time deltaTime)
+{
+    assert(deltaTime >= sf::Time::Zero && "AnimationSystem::update() passed sf::Time arg with a negative value");
+
+    PROFILE_ZONE("AnimationSystem::update");
+    PROFILE_FRAME_COUNT("Sprites updated", static_cast<std::int64_t>(mNumAwake));
+    mClockMicroseconds += deltaTime.asMicroseconds();
+    forgetReportedChanges();
+    advanceRange(0, mNumAwake, deltaTime.asMicroseconds(), mPendingCallbacks, mChangedSprites);
+    dispatchCallbacks();
+    mNumReportedChanges = mChangedSprites.size();
+}
+
+
+void AnimationSystem::update(sf::Time deltaTime, ThreadPool& threadPool)
+{
+    assert(deltaTime >= sf::Time::Zero && "AnimationSystem::update() passed sf::Time arg with a negative value");
+
+    const std::size_t numSprites = mNumAwake;
+    const std::size_t numChunks = std::min<std::size_t>((threadPool.getNumThreads() + 1) * 4, numSprites / sMinSpritesPerChunk);
+    if(numChunks <= 1)
+    {
+        update(deltaTime);
+        return;
+    }
+
+    PROFILE_ZONE("AnimationSystem::update");
+    PROFILE_FRAME_COUNT("Sprites updated", static_cast<std::int64_t>(numSprites));
+    //The per-chunk buffers allocate from the system's resource too.
+    MemoryResource* memoryResource = mSpriteIds.get_allocator().getResource();
+    while(mChunkCallbacks.size() < numChunks)
+    {
+        mChunkCallbacks.emplace_back(memoryResource);
+        mChunkChanges.emplace_back(memoryResource);
+    }
+    const std::int64_t delta = deltaTime.asMicroseconds();
+    mClockMicroseconds += delta;
+    forgetReportedChanges();
+    threadPool.parallelFor(numSprites, numChunks, [this, delta](std::size_t chunk, std::size_t begin, std::size_t end)
+    {
+        PROFILE_ZONE("AnimationSystem::advanceRange");
+        advanceRange(begin, end, delta, mChunkCallbacks[chunk], mChunkChanges[chunk]);
+    });
+
+    //Chunks cover ascending index ranges, so merging them in chunk order reproduces the single-threaded event order.
+    for(std::size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        mPendingCallbacks.insert(mPendingCallbacks.end(), mChunkCallbacks[chunk].begin(), mChunkCallbacks[chunk].end());
+        mChunkCallbacks[chunk].clear();
+        mChangedSprites.insert(mChangedSprites.end(), mChunkChanges[chunk].begin(), mChunkChanges[chunk].end());
+        mChunkChanges[chunk].clear();
+    }
+    dispatchCallbacks();
+    mNumReportedChanges = mChangedSprites.size();
+}
+
+
+void AnimationSystem::setDormant(SpriteId id, bool dormant)
+{
+    std::uint32_t index = denseIndex(id);
+    if(dormant == isDormant(id))
+        return;
+    if(dormant)
+    {
+        mDormantSince[index] = mClockMicroseconds;
+        mFlags[index] |= Dormant;
+        swapEntries(index, --mNumAwake);
+    }
+    else
+    {
+        //Catch up on the time spent dormant; the callbacks that came due are dispatched by the next update().
+        PlaybackPosition position = computePosition(index, mClockMicroseconds - mDormantSince[index]);
+        applyPosition(index, position, mLazyCallbackPolicy == LazyCallbackPolicy::Coalesce, mPendingCallbacks, mChangedSprites);
+        mFlags[index] &= ~Dormant;
+        swapEntries(index, mNumAwake++);
+    }
+}
+
+
+bool AnimationSystem::isDormant(SpriteId id) const
+{
+    return (mFlags[denseIndex(id)] & Dormant) != 0;
+}
+
+
+std::size_t AnimationSystem::getAwakeSpriteCount() const
+{
+    return mNumAwake;
+}
+
+
+void AnimationSystem::setLazyCallbackPolicy(LazyCallbackPolicy policy)
+{
+    mLazyCallbackPolicy = policy;
+}
+
+
+bool AnimationSystem::isFinished(SpriteId id) const
+{
+    std::uint32_t index = denseIndex(id);
+    if(mFlags[index] & Dormant)
+        return computePosition(index, mClockMicroseconds - mDormantSince[index]).finished;
+    return (mFlags[index] & Finished) != 0;
+}
+
+
+const AnimationSystem::Vector<AnimationSystem::SpriteId>& AnimationSystem::getChangedSprites() const
+{
+    return mChangedSprites;
+}
+
+
+const sf::IntRect& AnimationSystem::getTextureRect(SpriteId id) const
+{
+    std::uint32_t index = denseIndex(id);
+    assert(mFlags[index] & HasAnimation && "AnimationSystem::getTextureRect() called before an animation sequence was set.");
+    if(mFlags[index] & Dormant)
+        return mFirstFrames[index][computePosition(index, mClockMicroseconds - mDormantSince[index]).frame];
+    return mFirstFrames[index][mFrameIndices[index]];
+}
+
+
+void AnimationSystem::executeCallback(SpriteId id)
+{
+    assert(contains(id) && "AnimationSystem::executeCallback() was passed a SpriteId that does not refer to a live sprite.");
+    runCallback(id);
+}
+
+
+std::uint32_t AnimationSystem::denseIndex(SpriteId id) const
+{
+    assert(contains(id) && "AnimationSystem was passed a SpriteId that does not refer to a live sprite.");
+    return mDenseIndices[id];
+}
+
+
+void AnimationSystem::beginAnimation(std::uint32_t index, AnimationId animationId, sf::Time timePerFrame, unsigned numLoops, bool continuouslyLooping, CallbackConditions callbackConditions, Callback&& callback)
+{
+    const AnimationTable& table = AnimatedSprite::sAnimationTable;
+    assert(animationId < table.getNumAnimations(mObjectIds[index]) && "animationId is out of bounds in AnimationSystem::setAnimation()");
+    const AnimationTable::Sequence& sequence = table.getSequence(mObjectIds[index], animationId);
+    assert(sequence.numFrames > 0 && "AnimationSystem::setAnimation() was given an empty AnimationSequence");
+    assert((timePerFrame > sf::Time::Zero || table.hasFrameDurations(sequence)) && "AnimationSystem::setAnimation() requires a timePerFrame for animations without frame durations");
+
+    if(mCallbackConditions[index] & AnimatedSprite::AnimationSwitch)
+    {
+        //The callback may remove the sprite, or move it by adding or removing others.
+        SpriteId id = mSpriteIds[index];
+        std::uint32_t generation = mIdGenerations[id];
+        runCallback(id);
+        if(!contains(id) || mIdGenerations[id] != generation)
+            return;
+        index = mDenseIndices[id];
+    }
+    mFirstFrames[index] = table.getFrames(sequence);
+    mFrameEndTimes[index] = table.getFrameEndTimes(sequence);
+    mFrameCounts[index] = sequence.numFrames;
+    mFrameIndices[index] = 0;
+    mElapsedMicroseconds[index] = 0;
+    mMicrosecondsPerFrame[index] = timePerFrame.asMicroseconds();
+    if(timePerFrame > sf::Time::Zero)
+    {
+        mFrameEndMicroseconds[index] = timePerFrame.asMicroseconds();
+        mLoopMicroseconds[index] = timePerFrame.asMicroseconds() * sequence.numFrames;
+    }
+    else
+    {
+        mFrameEndMicroseconds[index] = mFrameEndTimes[index][0];
+        mLoopMicroseconds[index] = table.getLoopDuration(sequence).asMicroseconds();
+    }
+    mRunningMasks[index] = ~std::int64_t(0);
+    mLoopsRemaining[index] = numLoops;
+    mFlags[index] = HasAnimation | (continuouslyLooping ? ContinuouslyLooping : 0) | (mFlags[index] & Dormant);
+    mDormantSince[index] = mClockMicroseconds;
+    mCallbackConditions[index] = static_cast<std::uint8_t>(callbackConditions);
+    mCallbacks[index] = std::move(callback);
+    mChangedSprites.push_back(mSpriteIds[index]);
+}
+
+
+//Only touches the state of sprites in [begin, end), so disjoint ranges may be advanced concurrently.
+void AnimationSystem::advanceRange(std::size_t begin, std::size_t end, std::int64_t deltaMicroseconds, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites)
+{
+    //First pass: branch-free accumulation over contiguous arrays, which the compiler can vectorize.
+    std::int64_t* __restrict elapsed = mElapsedMicroseconds.data();
+    const std::int64_t* __restrict frameEnds = mFrameEndMicroseconds.data();
+    const std::int64_t* __restrict runningMasks = mRunningMasks.data();
+    std::uint8_t* __restrict frameDue = mFrameDue.data();
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        elapsed[i] += deltaMicroseconds & runningMasks[i];
+        frameDue[i] = elapsed[i] >= frameEnds[i];
+    }
+
+    //Second pass: only the sprites whose frame has ended do any further work.
+    for(std::size_t i = begin; i < end; ++i)
+    {
+        if(frameDue[i])
+            resolveFrame(static_cast<std::uint32_t>(i), callbackEvents, changedSprites);
+    }
+}
+
+
+void AnimationSystem::resolveFrame(std::uint32_t index, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites)
+{
+    applyPosition(index, computePosition(index, 0), false, callbackEvents, changedSprites);
+}
+
+
+AnimationSystem::PlaybackPosition AnimationSystem::computePosition(std::uint32_t index, std::int64_t deltaMicroseconds) const
+{
+    PlaybackPosition position{mElapsedMicroseconds[index] + (deltaMicroseconds & mRunningMasks[index]), 
+                              mFrameEndMicroseconds[index], mFrameIndices[index], mLoopsRemaining[index], 0, false};
+    if(position.elapsedMicroseconds < position.frameEndMicroseconds)
+        return position;
+    
+    if(position.elapsedMicroseconds >= mLoopMicroseconds[index])
+        position.numLoopEnds = AnimationTable::wrapLoops(position.elapsedMicroseconds, mLoopMicroseconds[index], (mFlags[index] & ContinuouslyLooping) != 0, position.loopsRemaining, position.finished);
+    if(position.finished)
+    {
+        //A finished animation keeps showing its last frame.
+        position.frame = mFrameCounts[index] - 1;
+        position.frameEndMicroseconds = std::numeric_limits<std::int64_t>::max();
+        return position;
+    }
+    
+    std::int64_t perFrame = mMicrosecondsPerFrame[index];
+    if(perFrame > 0)
+    {
+        position.frame = static_cast<std::uint32_t>(position.elapsedMicroseconds / perFrame);
+        position.frameEndMicroseconds = (position.frame + 1) * perFrame;
+    }
+    else
+    {
+        position.frame = AnimationTable::findFrame(mFrameEndTimes[index], mFrameCounts[index], position.elapsedMicroseconds);
+        position.frameEndMicroseconds = mFrameEndTimes[index][position.frame];
+    }
+    return position;
+}
+
+
+void AnimationSystem::applyPosition(std::uint32_t index, const PlaybackPosition& position, bool coalesceCallbacks, Vector<CallbackEvent>& callbackEvents, Vector<SpriteId>& changedSprites)
+{
+    if(position.frame != mFrameIndices[index])
+        changedSprites.push_back(mSpriteIds[index]);
+    mElapsedMicroseconds[index] = position.elapsedMicroseconds;
+    mFrameEndMicroseconds[index] = position.frameEndMicroseconds;
+    mFrameIndices[index] = position.frame;
+    mLoopsRemaining[index] = position.loopsRemaining;
+    
+    std::uint64_t numLoopEndCallbacks = position.finished && position.numLoopEnds > 0 ? position.numLoopEnds - 1 : position.numLoopEnds;
+    if(coalesceCallbacks)
+        numLoopEndCallbacks = std::min<std::uint64_t>(numLoopEndCallbacks, 1);
+    if(mCallbackConditions[index] & AnimatedSprite::EachLoopEnd && numLoopEndCallbacks > 0)
+        callbackEvents.push_back({mSpriteIds[index], mIdGenerations[mSpriteIds[index]], AnimatedSprite::EachLoopEnd, numLoopEndCallbacks});
+    if(position.finished)
+    {
+        mRunningMasks[index] = 0;
+        mFlags[index] |= Finished;
+        if(mCallbackConditions[index] & (AnimatedSprite::EachLoopEnd | AnimatedSprite::AnimationCompletion))
+            callbackEvents.push_back({mSpriteIds[index], mIdGenerations[mSpriteIds[index]], AnimatedSprite::AnimationCompletion, 1});
+    }
+}
+
+
+//Changes reported by the previous update() are dropped; changes made since then are kept for this one.
+void AnimationSystem::forgetReportedChanges()
+{
+    mChangedSprites.erase(mChangedSprites.begin(), mChangedSprites.begin() + mNumReportedChanges);
+    mNumReportedChanges = 0;
+}
+
+
+void AnimationSystem::swapEntries(std::uint32_t first, std::uint32_t second)
+{
+    if(first == second)
+        return;
+    std::swap(mSpriteIds[first], mSpriteIds[second]);
+    std::swap(mObjectIds[first], mObjectIds[second]);
+    std::swap(mFirstFrames[first], mFirstFrames[second]);
+    std::swap(mFrameEndTimes[first], mFrameEndTimes[second]);
+    std::swap(mFrameCounts[first], mFrameCounts[second]);
+    std::swap(mFrameIndices[first], mFrameIndices[second]);
+    std::swap(mElapsedMicroseconds[first], mElapsedMicroseconds[second]);
+    std::swap(mFrameEndMicroseconds[first], mFrameEndMicroseconds[second]);
+    std::swap(mMicrosecondsPerFrame[first], mMicrosecondsPerFrame[second]);
+    std::swap(mLoopMicroseconds[first], mLoopMicroseconds[second]);
+    std::swap(mRunningMasks[first], mRunningMasks[second]);
+    std::swap(mLoopsRemaining[first], mLoopsRemaining[second]);
+    std::swap(mFlags[first], mFlags[second]);
+    std::swap(mCallbackConditions[first], mCallbackConditions[second]);
+    std::swap(mDormantSince[first], mDormantSince[second]);
+    mCallbacks[first].swap(mCallbacks[second]);
+    mDenseIndices[mSpriteIds[first]] = first;
+    mDenseIndices[mSpriteIds[second]] = second;
+}
+
+
+void AnimationSystem::runCallback(SpriteId id)
+{
+    //The callback runs from a local, since setAnimation() would destroy the stored one while it runs, removeSprite()
+    //would swap it away and addSprite() may reallocate mCallbacks.  An empty slot means it is already running
+    //further up the stack, e.g. through a switch callback that re-animates its own sprite.
+    std::uint32_t generation = mIdGenerations[id];
+    Callback& stored = mCallbacks[mDenseIndices[id]];
+    if(!stored)
+        return;
+    Callback callback = std::move(stored);
+    callback();
+    //It goes back unless the sprite was removed or given a new callback meanwhile.
+    if(contains(id) && mIdGenerations[id] == generation && !mCallbacks[mDenseIndices[id]])
+        mCallbacks[mDenseIndices[id]] = std::move(callback);
+}
+
+
+void AnimationSystem::dispatchCallbacks()
+{
+    //Index-based loop since callbacks may set new animations or add sprites.
+    for(std::size_t i = 0; i < mPendingCallbacks.size(); ++i)
+    {
+        SpriteId id = mPendingCallbacks[i].id;
+        std::uint32_t generation = mPendingCallbacks[i].generation;
+        for(std::uint64_t call = 0; call < mPendingCallbacks[i].count && contains(id) && mIdGenerations[id] == generation; ++call)
+            runCallback(id);
+    }
+    mPendingCallbacks.clear();
+}
@@ -0,0 +1,304 @@
+#include "AnimationTable.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+
+const std::uint32_t AnimationTable::sVersion;
+const std::uint32_t AnimationTable::sMaxLoopMicroseconds;
+
+static_assert(sizeof(sf::IntRect) == 4 * sizeof(std::int32_t), "AnimationTable stores sf::IntRect as four 32 bit integers");
+
+
+AnimationTable::AnimationTable()
+:mImage(nullptr),
+mImageSize(0),
+mHeader(nullptr),
+mObjectOffsets(nullptr),
+mTexturePages(nullptr),
+mSequences(nullptr),
+mFrames(nullptr),
+mFrameEndTimes(nullptr)
+{
+}
+
+
+void AnimationTable::build(const NestedAnimations& animations, const NestedFrameDurations& frameDurations, const std::vector<std::uint32_t>& texturePages)
+{
+    assert(frameDurations.size() <= animations.size() && "AnimationTable::build() was given frameDurations for nonexistent objects");
+    assert((texturePages.empty() || texturePages.size() == animations.size()) && "AnimationTable::build() needs one texture page per object");
+    std::uint32_t numSequences = 0;
+    std::uint32_t numFrames = 0;
+    for(auto& sequenceSet : animations)
+    {
+        numSequences += static_cast<std::uint32_t>(sequenceSet.size());
+        for(auto& sequence : sequenceSet)
+            numFrames += static_cast<std::uint32_t>(sequence.size());
+    }
+    
+    std::vector<char> image(sizeof(FileHeader) 
+                            + (animations.size() + 1) * sizeof(std::uint32_t) 
+                            + animations.size() * sizeof(std::uint32_t) 
+                            + numSequences * sizeof(Sequence) 
+                            + numFrames * (sizeof(sf::IntRect) + sizeof(std::uint32_t)));
+    FileHeader header{{'A', 'N', 'I', 'M'}, sVersion, static_cast<std::uint32_t>(animations.size()), numSequences, numFrames};
+    std::memcpy(image.data(), &header, sizeof(header));
+    char* objectOffsets = image.data() + sizeof(FileHeader);
+    char* pages = objectOffsets + (animations.size() + 1) * sizeof(std::uint32_t);
+    char* sequences = pages + animations.size() * sizeof(std::uint32_t);
+    char* frames = sequences + numSequences * sizeof(Sequence);
+    char* frameEndTimes = frames + numFrames * sizeof(sf::IntRect);
+    
+    std::uint32_t sequenceIndex = 0;
+    std::uint32_t frameIndex = 0;
+    for(std::size_t object = 0; object < animations.size(); ++object)
+    {
+        std::memcpy(objectOffsets, &sequenceIndex, sizeof(sequenceIndex));
+        objectOffsets += sizeof(sequenceIndex);
+        std::uint32_t page = texturePages.empty() ? 0 : texturePages[object];
+        std::memcpy(pages, &page, sizeof(page));
+        pages += sizeof(page);
+        for(std::size_t animation = 0; animation < animations[object].size(); ++animation)
+        {
+            auto& sequence = animations[object][animation];
+            Sequence entry{frameIndex, static_cast<std::uint32_t>(sequence.size())};
+            std::memcpy(sequences, &entry, sizeof(entry));
+            sequences += sizeof(entry);
+            if(!sequence.empty())
+                std::memcpy(frames, sequence.data(), sequence.size() * sizeof(sf::IntRect));
+            frames += sequence.size() * sizeof(sf::IntRect);
+            
+            //Sequences without durations get all-zero end times, which hasFrameDurations() reports as none.
+            bool hasDurations = object < frameDurations.size() && animation < frameDurations[object].size() && !frameDurations[object][animation].empty();
+            assert((!hasDurations || frameDurations[object][animation].size() == sequence.size()) && "AnimationTable::build() needs one duration per frame");
+            std::uint64_t endTime = 0;
+            for(std::size_t frame = 0; frame < sequence.size(); ++frame)
+            {
+                if(hasDurations)
+                {
+                    assert(frameDurations[object][animation][frame] > sf::Time::Zero && "AnimationTable::build() encountered a frame duration less than or equal to zero");
+                    endTime += static_cast<std::uint64_t>(frameDurations[object][animation][frame].asMicroseconds());
+                    assert(endTime <= sMaxLoopMicroseconds && "AnimationTable::build() encountered a sequence longer than the frame end times can store");
+                }
+                std::uint32_t storedEndTime = static_cast<std::uint32_t>(endTime);
+                std::memcpy(frameEndTimes, &storedEndTime, sizeof(storedEndTime));
+                frameEndTimes += sizeof(storedEndTime);
+            }
+            frameIndex += entry.numFrames;
+            ++sequenceIndex;
+        }
+    }
+    std::memcpy(objectOffsets, &sequenceIndex, sizeof(sequenceIndex));
+    
+    clear();
+    mStorage = std::move(image);
+    bool success = attach(mStorage.data(), mStorage.size());
+    assert(success && "AnimationTable::build() produced an inconsistent table");
+    (void)success;
+}
+
+
+bool AnimationTable::saveToFile(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if(!file)
+        return false;
+    file.write(mImage, static_cast<std::streamsize>(mImageSize));
+    return static_cast<bool>(file);
+}
+
+
+bool AnimationTable::loadFromFile(const std::string& filename)
+{
+    clear();
+    if(mMappedFile.open(filename) == false)
+        return false;
+    if(attach(mMappedFile.getData(), mMappedFile.getSize()) == false)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool AnimationTable::loadFromMemory(const void* data, std::size_t sizeInBytes)
+{
+    clear();
+    const char* bytes = static_cast<const char*>(data);
+    mStorage.assign(bytes, bytes + sizeInBytes);
+    if(attach(mStorage.data(), mStorage.size()) == false)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool AnimationTable::isEmpty() const
+{
+    return mHeader == nullptr || mHeader->numObjects == 0;
+}
+
+
+std::size_t AnimationTable::getNumObjects() const
+{
+    return mHeader == nullptr ? 0 : mHeader->numObjects;
+}
+
+
+std::size_t AnimationTable::getNumAnimations(std::size_t objectId) const
+{
+    assert(objectId < getNumObjects() && "objectId is out of bounds in AnimationTable::getNumAnimations()");
+    return mObjectOffsets[objectId + 1] - mObjectOffsets[objectId];
+}
+
+
+std::uint32_t AnimationTable::getTexturePage(std::size_t objectId) const
+{
+    assert(objectId < getNumObjects() && "objectId is out of bounds in AnimationTable::getTexturePage()");
+    return mTexturePages[objectId];
+}
+
+
+std::size_t AnimationTable::getNumFrames() const
+{
+    return mHeader == nullptr ? 0 : mHeader->numFrames;
+}
+
+
+const AnimationTable::Sequence& AnimationTable::getSequence(std::size_t objectId, std::size_t animationId) const
+{
+    assert(animationId < getNumAnimations(objectId) && "animationId is out of bounds in AnimationTable::getSequence()");
+    return mSequences[mObjectOffsets[objectId] + animationId];
+}
+
+
+const sf::IntRect* AnimationTable::getFrames(const Sequence& sequence) const
+{
+    assert(sequence.firstFrame + sequence.numFrames <= mHeader->numFrames && "Sequence is out of bounds in AnimationTable::getFrames()");
+    return mFrames + sequence.firstFrame;
+}
+
+
+bool AnimationTable::hasFrameDurations(const Sequence& sequence) const
+{
+    return getLoopDuration(sequence) > sf::Time::Zero;
+}
+
+
+sf::Time AnimationTable::getLoopDuration(const Sequence& sequence) const
+{
+    return sequence.numFrames == 0 ? sf::Time::Zero : sf::microseconds(getFrameEndTimes(sequence)[sequence.numFrames - 1]);
+}
+
+
+const std::uint32_t* AnimationTable::getFrameEndTimes(const Sequence& sequence) const
+{
+    assert(sequence.firstFrame + sequence.numFrames <= mHeader->numFrames && "Sequence is out of bounds in AnimationTable::getFrameEndTimes()");
+    return mFrameEndTimes + sequence.firstFrame;
+}
+
+
+std::uint32_t AnimationTable::findFrame(const std::uint32_t* frameEndTimes, std::uint32_t numFrames, std::int64_t elapsedMicroseconds)
+{
+    //The first frame that ends after the elapsed time is the one being shown.
+    const std::uint32_t* frame = std::upper_bound(frameEndTimes, frameEndTimes + numFrames, elapsedMicroseconds, 
+                                                  [](std::int64_t elapsed, std::uint32_t endTime){ return elapsed < std::int64_t(endTime); });
+    return std::min(static_cast<std::uint32_t>(frame - frameEndTimes), numFrames - 1);
+}
+
+
+std::uint64_t AnimationTable::wrapLoops(std::int64_t& elapsedMicroseconds, std::int64_t loopDuration, bool continuouslyLooping, unsigned& loopsRemaining, bool& finished)
+{
+    assert(loopDuration > 0 && "AnimationTable::wrapLoops() requires a positive loop duration");
+    std::uint64_t loopEnds = static_cast<std::uint64_t>(elapsedMicroseconds / loopDuration);
+    if(continuouslyLooping == false && loopEnds >= loopsRemaining)
+    {
+        loopEnds = loopsRemaining;
+        loopsRemaining = 0;
+        elapsedMicroseconds = loopDuration;
+        finished = true;
+        return loopEnds;
+    }
+    if(continuouslyLooping == false)
+        loopsRemaining -= static_cast<unsigned>(loopEnds);
+    elapsedMicroseconds %= loopDuration;
+    finished = false;
+    return loopEnds;
+}
+
+
+bool AnimationTable::attach(const char* data, std::size_t sizeInBytes)
+{
+    if(sizeInBytes < sizeof(FileHeader))
+        return false;
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(data);
+    if(std::memcmp(header->magic, "ANIM", 4) != 0 || header->version != sVersion)
+        return false;
+    std::size_t expectedSize = sizeof(FileHeader) 
+                               + (std::size_t(header->numObjects) * 2 + 1) * sizeof(std::uint32_t) 
+                               + std::size_t(header->numSequences) * sizeof(Sequence) 
+                               + std::size_t(header->numFrames) * (sizeof(sf::IntRect) + sizeof(std::uint32_t));
+    if(sizeInBytes != expectedSize)
+        return false;
+    
+    mImage = data;
+    mImageSize = sizeInBytes;
+    mHeader = header;
+    mObjectOffsets = reinterpret_cast<const std::uint32_t*>(data + sizeof(FileHeader));
+    mTexturePages = mObjectOffsets + header->numObjects + 1;
+    mSequences = reinterpret_cast<const Sequence*>(mTexturePages + header->numObjects);
+    mFrames = reinterpret_cast<const sf::IntRect*>(mSequences + header->numSequences);
+    mFrameEndTimes = reinterpret_cast<const std::uint32_t*>(mFrames + header->numFrames);
+    return validate();
+}
+
+
+bool AnimationTable::validate() const
+{
+    //The image may come from an untrusted file, so every index the accessors follow is checked here.
+    if(mObjectOffsets[0] != 0 || mObjectOffsets[mHeader->numObjects] != mHeader->numSequences)
+        return false;
+    for(std::uint32_t object = 0; object < mHeader->numObjects; ++object)
+    {
+        if(mObjectOffsets[object + 1] < mObjectOffsets[object])
+            return false;
+    }
+    for(std::uint32_t sequence = 0; sequence < mHeader->numSequences; ++sequence)
+    {
+        if(std::uint64_t(mSequences[sequence].firstFrame) + mSequences[sequence].numFrames > mHeader->numFrames)
+            return false;
+    }
+    //findFrame() binary searches the end times, so a sequence's must either all be zero or strictly increase.
+    for(std::uint32_t sequence = 0; sequence < mHeader->numSequences; ++sequence)
+    {
+        const std::uint32_t* endTimes = mFrameEndTimes + mSequences[sequence].firstFrame;
+        std::uint32_t numFrames = mSequences[sequence].numFrames;
+        bool hasDurations = numFrames > 0 && endTimes[numFrames - 1] != 0;
+        std::uint32_t previousEndTime = 0;
+        for(std::uint32_t frame = 0; frame < numFrames; ++frame)
+        {
+            if(hasDurations ? endTimes[frame] <= previousEndTime : endTimes[frame] != 0)
+                return false;
+            previousEndTime = endTimes[frame];
+        }
+    }
+    return true;
+}
+
+
+void AnimationTable::clear()
+{
+    mMappedFile.close();
+    mStorage.clear();
+    mImage = nullptr;
+    mImageSize = 0;
+    mHeader = nullptr;
+    mObjectOffsets = nullptr;
+    mTexturePages = nullptr;
+    mSequences = nullptr;
+    mFrames = nullptr;
+    mFrameEndTimes = nullptr;
+}
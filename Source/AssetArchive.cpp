@@ -0,0 +1,361 @@
+#include "AssetArchive.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+
+const std::size_t AssetArchive::NoEntry;
+const std::uint32_t AssetArchive::sVersion;
+const std::size_t AssetArchive::sBlobAlignment;
+
+
+namespace
+{
+    //The Lz codec writes sequences of a token byte, literals, and a match.  The token's high nibble is the
+    //number of literals and its low nibble the match length minus sMinMatch; a nibble of 15 is followed by
+    //bytes added to it, up to and including the first that isn't 255.  A match is a two byte little-endian
+    //distance back into the output followed by the length bytes.  The last sequence has literals only.
+    const std::size_t sMinMatch = 4;
+    const std::size_t sMaxDistance = 0xFFFF;
+    //Each length byte after a nibble of 15 adds at most 255 bytes of output, and no sequence does better, so
+    //an entry can't decompress to more than this many times its stored size.
+    const std::uint64_t sMaxLzExpansion = 255;
+    const unsigned sHashBits = 14;
+
+
+    void writeLength(std::vector<char>& output, std::size_t length)
+    {
+        for(; length >= 255; length -= 255)
+            output.push_back(static_cast<char>(255));
+        output.push_back(static_cast<char>(length));
+    }
+
+
+    void writeSequence(std::vector<char>& output, const char* literals, std::size_t numLiterals, std::size_t distance, std::size_t matchLength)
+    {
+        std::size_t matchCode = matchLength == 0 ? 0 : matchLength - sMinMatch;
+        output.push_back(static_cast<char>((std::min<std::size_t>(numLiterals, 15) << 4) | std::min<std::size_t>(matchCode, 15)));
+        if(numLiterals >= 15)
+            writeLength(output, numLiterals - 15);
+        output.insert(output.end(), literals, literals + numLiterals);
+        if(matchLength == 0)
+            return;
+        output.push_back(static_cast<char>(distance & 0xFF));
+        output.push_back(static_cast<char>(distance >> 8));
+        if(matchCode >= 15)
+            writeLength(output, matchCode - 15);
+    }
+
+
+    //Greedy compression, taking the most recent earlier occurrence of each four byte sequence.
+    std::vector<char> compressLz(const char* data, std::size_t size)
+    {
+        std::vector<char> output;
+        output.reserve(size / 2 + 16);
+        std::vector<std::size_t> lastPositions(std::size_t(1) << sHashBits, 0);  //position + 1, zero if none
+        std::size_t anchor = 0;
+        std::size_t position = 0;
+        while(position + sMinMatch <= size)
+        {
+            std::uint32_t sequence;
+            std::memcpy(&sequence, data + position, sizeof(sequence));
+            std::size_t& lastPosition = lastPositions[(sequence * 2654435761u) >> (32 - sHashBits)];
+            std::size_t candidate = lastPosition;
+            lastPosition = position + 1;
+            if(candidate == 0 || position - (candidate - 1) > sMaxDistance || std::memcmp(data + candidate - 1, data + position, sMinMatch) != 0)
+            {
+                ++position;
+                continue;
+            }
+            std::size_t match = candidate - 1;
+            std::size_t length = sMinMatch;
+            while(position + length < size && data[match + length] == data[position + length])
+                ++length;
+            writeSequence(output, data + anchor, position - anchor, position - match, length);
+            position += length;
+            anchor = position;
+        }
+        writeSequence(output, data + anchor, size - anchor, 0, 0);
+        return output;
+    }
+
+
+    bool readLength(const unsigned char*& input, const unsigned char* inputEnd, std::size_t& length)
+    {
+        unsigned char byte;
+        do
+        {
+            if(input == inputEnd)
+                return false;
+            byte = *input++;
+            length += byte;
+        }
+        while(byte == 255);
+        return true;
+    }
+
+
+    //Checks every length and distance, since archives come from disk.
+    bool decompressLz(const char* data, std::size_t size, char* output, std::size_t outputSize)
+    {
+        const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+        const unsigned char* inputEnd = input + size;
+        std::size_t written = 0;
+        while(input != inputEnd)
+        {
+            unsigned char token = *input++;
+            std::size_t numLiterals = token >> 4;
+            if(numLiterals == 15 && readLength(input, inputEnd, numLiterals) == false)
+                return false;
+            if(numLiterals > std::size_t(inputEnd - input) || numLiterals > outputSize - written)
+                return false;
+            std::memcpy(output + written, input, numLiterals);
+            input += numLiterals;
+            written += numLiterals;
+            if(input == inputEnd)
+                break;
+
+            if(inputEnd - input < 2)
+                return false;
+            std::size_t distance = input[0] | (std::size_t(input[1]) << 8);
+            input += 2;
+            std::size_t length = (token & 0x0F);
+            if(length == 15 && readLength(input, inputEnd, length) == false)
+                return false;
+            length += sMinMatch;
+            if(distance == 0 || distance > written || length > outputSize - written)
+                return false;
+            //Byte by byte, since a match may overlap the bytes it produces.
+            const char* source = output + written - distance;
+            for(std::size_t i = 0; i < length; ++i)
+                output[written + i] = source[i];
+            written += length;
+        }
+        return written == outputSize;
+    }
+
+
+    int compareNames(const char* first, std::size_t firstLength, const char* second, std::size_t secondLength)
+    {
+        int result = std::memcmp(first, second, std::min(firstLength, secondLength));
+        if(result != 0)
+            return result;
+        return firstLength < secondLength ? -1 : (firstLength > secondLength ? 1 : 0);
+    }
+
+
+    std::size_t alignBlob(std::size_t offset, std::size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+
+AssetArchive::AssetArchive()
+:mHeader(nullptr),
+mIndex(nullptr),
+mNames(nullptr)
+{
+}
+
+
+bool AssetArchive::write(const std::string& filename, const std::vector<SourceEntry>& entries)
+{
+    std::vector<const SourceEntry*> sorted;
+    for(auto& entry : entries)
+    {
+        if(entry.name.size() > 0xFFFF)
+            return false;
+        sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const SourceEntry* first, const SourceEntry* second)
+    {
+        return first->name < second->name;
+    });
+    for(std::size_t i = 1; i < sorted.size(); ++i)
+    {
+        if(sorted[i - 1]->name == sorted[i]->name)
+            return false;
+    }
+
+    std::vector<std::vector<char>> compressed(sorted.size());
+    std::vector<IndexEntry> index(sorted.size());
+    std::string names;
+    for(std::size_t i = 0; i < sorted.size(); ++i)
+    {
+        const SourceEntry& entry = *sorted[i];
+        IndexEntry& indexEntry = index[i];
+        indexEntry.size = entry.data.size();
+        indexEntry.storedSize = entry.data.size();
+        indexEntry.compression = Stored;
+        if(entry.compression == Lz)
+        {
+            compressed[i] = compressLz(entry.data.data(), entry.data.size());
+            if(compressed[i].size() < entry.data.size())
+            {
+                indexEntry.storedSize = compressed[i].size();
+                indexEntry.compression = Lz;
+            }
+            else
+                compressed[i].clear();
+        }
+        indexEntry.nameOffset = static_cast<std::uint32_t>(names.size());
+        indexEntry.nameLength = static_cast<std::uint16_t>(entry.name.size());
+        names += entry.name;
+    }
+    if(names.size() > 0xFFFFFFFF)
+        return false;
+
+    std::size_t offset = sizeof(FileHeader) + index.size() * sizeof(IndexEntry) + names.size();
+    for(auto& indexEntry : index)
+    {
+        offset = alignBlob(offset, sBlobAlignment);
+        indexEntry.offset = offset;
+        offset += static_cast<std::size_t>(indexEntry.storedSize);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if(!file)
+        return false;
+    FileHeader header{{'P', 'A', 'C', 'K'}, sVersion, static_cast<std::uint32_t>(index.size()), static_cast<std::uint32_t>(names.size())};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if(!index.empty())
+        file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(IndexEntry)));
+    file.write(names.data(), static_cast<std::streamsize>(names.size()));
+    std::size_t written = sizeof(FileHeader) + index.size() * sizeof(IndexEntry) + names.size();
+    const char padding[sBlobAlignment] = {};
+    for(std::size_t i = 0; i < index.size(); ++i)
+    {
+        file.write(padding, static_cast<std::streamsize>(index[i].offset - written));
+        const std::vector<char>& blob = index[i].compression == Lz ? compressed[i] : sorted[i]->data;
+        file.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+        written = static_cast<std::size_t>(index[i].offset) + blob.size();
+    }
+    return static_cast<bool>(file);
+}
+
+
+bool AssetArchive::open(const std::string& filename)
+{
+    close();
+    if(mMappedFile.open(filename) == false)
+        return false;
+    if(mMappedFile.getSize() < sizeof(FileHeader))
+    {
+        close();
+        return false;
+    }
+    mHeader = reinterpret_cast<const FileHeader*>(mMappedFile.getData());
+    mIndex = reinterpret_cast<const IndexEntry*>(mMappedFile.getData() + sizeof(FileHeader));
+    mNames = reinterpret_cast<const char*>(mIndex + mHeader->numEntries);
+    if(validate() == false)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+void AssetArchive::close()
+{
+    mMappedFile.close();
+    mHeader = nullptr;
+    mIndex = nullptr;
+    mNames = nullptr;
+}
+
+
+bool AssetArchive::isOpen() const
+{
+    return mHeader != nullptr;
+}
+
+
+std::size_t AssetArchive::getNumEntries() const
+{
+    return mHeader == nullptr ? 0 : mHeader->numEntries;
+}
+
+
+std::size_t AssetArchive::find(const std::string& name) const
+{
+    const IndexEntry* end = mIndex + getNumEntries();
+    const IndexEntry* found = std::lower_bound(mIndex, end, name, [this](const IndexEntry& entry, const std::string& name)
+    {
+        return compareNames(getNameData(entry), entry.nameLength, name.data(), name.size()) < 0;
+    });
+    if(found == end || compareNames(getNameData(*found), found->nameLength, name.data(), name.size()) != 0)
+        return NoEntry;
+    return static_cast<std::size_t>(found - mIndex);
+}
+
+
+std::string AssetArchive::getName(std::size_t entry) const
+{
+    assert(entry < getNumEntries() && "entry is out of bounds in AssetArchive::getName()");
+    return std::string(getNameData(mIndex[entry]), mIndex[entry].nameLength);
+}
+
+
+AssetArchive::Compression AssetArchive::getCompression(std::size_t entry) const
+{
+    assert(entry < getNumEntries() && "entry is out of bounds in AssetArchive::getCompression()");
+    return static_cast<Compression>(mIndex[entry].compression);
+}
+
+
+std::size_t AssetArchive::getSize(std::size_t entry) const
+{
+    assert(entry < getNumEntries() && "entry is out of bounds in AssetArchive::getSize()");
+    return static_cast<std::size_t>(mIndex[entry].size);
+}
+
+
+const char* AssetArchive::getData(std::size_t entry, std::vector<char>& buffer) const
+{
+    assert(entry < getNumEntries() && "entry is out of bounds in AssetArchive::getData()");
+    const IndexEntry& indexEntry = mIndex[entry];
+    const char* blob = mMappedFile.getData() + indexEntry.offset;
+    if(indexEntry.compression == Stored)
+        return blob;
+    buffer.resize(static_cast<std::size_t>(indexEntry.size));
+    if(decompressLz(blob, static_cast<std::size_t>(indexEntry.storedSize), buffer.data(), buffer.size()) == false)
+        return nullptr;
+    return buffer.data();
+}
+
+
+const char* AssetArchive::getNameData(const IndexEntry& entry) const
+{
+    return mNames + entry.nameOffset;
+}
+
+
+bool AssetArchive::validate() const
+{
+    if(std::memcmp(mHeader->magic, "PACK", 4) != 0 || mHeader->version != sVersion)
+        return false;
+    std::uint64_t fileSize = mMappedFile.getSize();
+    std::uint64_t namesEnd = sizeof(FileHeader) + std::uint64_t(mHeader->numEntries) * sizeof(IndexEntry) + mHeader->namesSize;
+    if(namesEnd > fileSize)
+        return false;
+    for(std::size_t i = 0; i < mHeader->numEntries; ++i)
+    {
+        const IndexEntry& entry = mIndex[i];
+        if(std::uint64_t(entry.nameOffset) + entry.nameLength > mHeader->namesSize)
+            return false;
+        if(entry.offset < namesEnd || entry.offset > fileSize || entry.storedSize > fileSize - entry.offset)
+            return false;
+        if(entry.compression == Stored ? entry.storedSize != entry.size : entry.compression != Lz)
+            return false;
+        //getData() allocates the decompressed size up front, so it must not be more than the data can produce.
+        if(entry.compression == Lz && (entry.size > entry.storedSize * sMaxLzExpansion || entry.size > std::numeric_limits<std::size_t>::max()))
+            return false;
+        if(i > 0 && compareNames(getNameData(mIndex[i - 1]), mIndex[i - 1].nameLength, getNameData(entry), entry.nameLength) >= 0)
+            return false;
+    }
+    return true;
+}
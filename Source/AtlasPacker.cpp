@@ -0,0 +1,190 @@
+#include "AtlasPacker.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+
+namespace
+{
+    bool overlaps(const sf::IntRect& first, const sf::IntRect& second)
+    {
+        return first.left < second.left + second.width && second.left < first.left + first.width
+            && first.top < second.top + second.height && second.top < first.top + first.height;
+    }
+
+
+    bool encloses(const sf::IntRect& outer, const sf::IntRect& inner)
+    {
+        return inner.left >= outer.left && inner.top >= outer.top
+            && inner.left + inner.width <= outer.left + outer.width && inner.top + inner.height <= outer.top + outer.height;
+    }
+}
+
+
+AtlasPacker::AtlasPacker(sf::Vector2u pageSize, unsigned padding)
+:mPageSize(pageSize),
+mPadding(padding)
+{
+    assert(pageSize.x > 0 && pageSize.y > 0 && "AtlasPacker::AtlasPacker() was given an empty page size");
+}
+
+
+bool AtlasPacker::packGroup(const std::vector<sf::Vector2u>& sizes, std::vector<Placement>& placements)
+{
+    //Large rectangles first; small ones then fill the gaps between them.
+    std::vector<std::size_t> order(sizes.size());
+    for(std::size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&sizes](std::size_t first, std::size_t second)
+    {
+        unsigned firstSide = std::max(sizes[first].x, sizes[first].y);
+        unsigned secondSide = std::max(sizes[second].x, sizes[second].y);
+        if(firstSide != secondSide)
+            return firstSide > secondSide;
+        return std::uint64_t(sizes[first].x) * sizes[first].y > std::uint64_t(sizes[second].x) * sizes[second].y;
+    });
+
+    placements.assign(sizes.size(), Placement());
+    for(std::size_t pageIndex = 0; pageIndex < mPages.size(); ++pageIndex)
+    {
+        Page page = mPages[pageIndex];
+        if(packOnPage(page, sizes, order, placements))
+        {
+            mPages[pageIndex] = std::move(page);
+            for(auto& placement : placements)
+                placement.page = static_cast<std::uint32_t>(pageIndex);
+            return true;
+        }
+    }
+
+    //Padding is only needed between rectangles, so the empty page extends padding pixels past its edges.
+    Page page{{sf::IntRect(0, 0, int(mPageSize.x + mPadding), int(mPageSize.y + mPadding))}, sf::Vector2u(0, 0), 0};
+    if(packOnPage(page, sizes, order, placements) == false)
+    {
+        placements.clear();
+        return false;
+    }
+    mPages.push_back(std::move(page));
+    for(auto& placement : placements)
+        placement.page = static_cast<std::uint32_t>(mPages.size() - 1);
+    return true;
+}
+
+
+std::size_t AtlasPacker::getNumPages() const
+{
+    return mPages.size();
+}
+
+
+sf::Vector2u AtlasPacker::getUsedSize(std::size_t page) const
+{
+    assert(page < mPages.size() && "page is out of bounds in AtlasPacker::getUsedSize()");
+    return mPages[page].usedSize;
+}
+
+
+double AtlasPacker::getEfficiency() const
+{
+    std::uint64_t packedArea = 0;
+    std::uint64_t usedArea = 0;
+    for(auto& page : mPages)
+    {
+        packedArea += page.packedArea;
+        usedArea += std::uint64_t(page.usedSize.x) * page.usedSize.y;
+    }
+    return usedArea == 0 ? 1.0 : double(packedArea) / double(usedArea);
+}
+
+
+bool AtlasPacker::packOnPage(Page& page, const std::vector<sf::Vector2u>& sizes, const std::vector<std::size_t>& order, std::vector<Placement>& placements) const
+{
+    for(std::size_t index : order)
+    {
+        int width = int(sizes[index].x);
+        int height = int(sizes[index].y);
+        sf::Vector2i position;
+        if(findPosition(page, width + int(mPadding), height + int(mPadding), position) == false)
+            return false;
+        place(page, sf::IntRect(position.x, position.y, width + int(mPadding), height + int(mPadding)));
+        placements[index].rect = sf::IntRect(position.x, position.y, width, height);
+        page.usedSize.x = std::max(page.usedSize.x, unsigned(position.x + width));
+        page.usedSize.y = std::max(page.usedSize.y, unsigned(position.y + height));
+        page.packedArea += std::uint64_t(width) * height;
+    }
+    return true;
+}
+
+
+bool AtlasPacker::findPosition(const Page& page, int width, int height, sf::Vector2i& position) const
+{
+    int bestShortSide = std::numeric_limits<int>::max();
+    int bestLongSide = std::numeric_limits<int>::max();
+    for(auto& freeRect : page.freeRects)
+    {
+        if(width > freeRect.width || height > freeRect.height)
+            continue;
+        int leftoverX = freeRect.width - width;
+        int leftoverY = freeRect.height - height;
+        int shortSide = std::min(leftoverX, leftoverY);
+        int longSide = std::max(leftoverX, leftoverY);
+        if(shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+        {
+            bestShortSide = shortSide;
+            bestLongSide = longSide;
+            position = sf::Vector2i(freeRect.left, freeRect.top);
+        }
+    }
+    return bestShortSide != std::numeric_limits<int>::max();
+}
+
+
+void AtlasPacker::place(Page& page, const sf::IntRect& rect) const
+{
+    //Every free rect the placed one overlaps is replaced by the up to four maximal rects around it.
+    std::vector<sf::IntRect> splitRects;
+    for(std::size_t i = 0; i < page.freeRects.size();)
+    {
+        sf::IntRect freeRect = page.freeRects[i];
+        if(overlaps(freeRect, rect) == false)
+        {
+            ++i;
+            continue;
+        }
+        if(rect.left > freeRect.left)
+            splitRects.emplace_back(freeRect.left, freeRect.top, rect.left - freeRect.left, freeRect.height);
+        if(rect.left + rect.width < freeRect.left + freeRect.width)
+            splitRects.emplace_back(rect.left + rect.width, freeRect.top, freeRect.left + freeRect.width - rect.left - rect.width, freeRect.height);
+        if(rect.top > freeRect.top)
+            splitRects.emplace_back(freeRect.left, freeRect.top, freeRect.width, rect.top - freeRect.top);
+        if(rect.top + rect.height < freeRect.top + freeRect.height)
+            splitRects.emplace_back(freeRect.left, rect.top + rect.height, freeRect.width, freeRect.top + freeRect.height - rect.top - rect.height);
+        page.freeRects[i] = page.freeRects.back();
+        page.freeRects.pop_back();
+    }
+    page.freeRects.insert(page.freeRects.end(), splitRects.begin(), splitRects.end());
+    pruneFreeRects(page);
+}
+
+
+void AtlasPacker::pruneFreeRects(Page& page) const
+{
+    //Drop free rects that lie inside another one; of two identical rects, only the first is kept.
+    auto& freeRects = page.freeRects;
+    std::vector<bool> redundant(freeRects.size(), false);
+    for(std::size_t i = 0; i < freeRects.size(); ++i)
+    {
+        for(std::size_t j = 0; j < freeRects.size() && redundant[i] == false; ++j)
+        {
+            if(i != j && redundant[j] == false && encloses(freeRects[j], freeRects[i]))
+                redundant[i] = (freeRects[i] != freeRects[j] || j < i);
+        }
+    }
+    std::size_t numKept = 0;
+    for(std::size_t i = 0; i < freeRects.size(); ++i)
+    {
+        if(redundant[i] == false)
+            freeRects[numKept++] = freeRects[i];
+    }
+    freeRects.resize(numKept);
+}
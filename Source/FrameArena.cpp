@@ -0,0 +1,108 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+
+
+FrameArena::FrameArena(std::size_t initialCapacity, MemoryResource* upstream)
+:mUpstream(upstream),
+mCurrentBlock(nullptr),
+mPosition(nullptr),
+mEnd(nullptr),
+mCapacity(0),
+mBytesUsedInFullBlocks(0),
+mPeakBytesUsed(0)
+{
+    assert(upstream != nullptr && "FrameArena::FrameArena() requires an upstream resource");
+    if(initialCapacity > 0)
+        addBlock(initialCapacity);
+}
+
+
+FrameArena::~FrameArena()
+{
+    releaseBlocks();
+}
+
+
+void FrameArena::reset()
+{
+    mPeakBytesUsed = std::max(mPeakBytesUsed, getBytesUsed());
+    if(mCurrentBlock != nullptr && mCurrentBlock->previous != nullptr)
+    {
+        //The frame overflowed, so the next one gets a single block the size of all of them.
+        std::size_t capacity = mCapacity;
+        releaseBlocks();
+        addBlock(capacity);
+    }
+    mBytesUsedInFullBlocks = 0;
+    mPosition = mCurrentBlock != nullptr ? reinterpret_cast<char*>(mCurrentBlock + 1) : nullptr;
+}
+
+
+std::size_t FrameArena::getBytesUsed() const
+{
+    return mCurrentBlock != nullptr ? mBytesUsedInFullBlocks + (mPosition - reinterpret_cast<const char*>(mCurrentBlock + 1)) : 0;
+}
+
+
+std::size_t FrameArena::getCapacity() const
+{
+    return mCapacity;
+}
+
+
+std::size_t FrameArena::getPeakBytesUsed() const
+{
+    return std::max(mPeakBytesUsed, getBytesUsed());
+}
+
+
+void* FrameArena::doAllocate(std::size_t bytes, std::size_t alignment)
+{
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(mPosition);
+    std::size_t padding = (alignment - address % alignment) % alignment;
+    if(mCurrentBlock == nullptr || static_cast<std::size_t>(mEnd - mPosition) < padding + bytes)
+    {
+        if(mCurrentBlock != nullptr)
+            mBytesUsedInFullBlocks += mPosition - reinterpret_cast<char*>(mCurrentBlock + 1);
+        addBlock(std::max(mCurrentBlock != nullptr ? mCurrentBlock->size * 2 : std::size_t(0), bytes + alignment));
+        address = reinterpret_cast<std::uintptr_t>(mPosition);
+        padding = (alignment - address % alignment) % alignment;
+    }
+    void* allocation = mPosition + padding;
+    mPosition += padding + bytes;
+    return allocation;
+}
+
+
+void FrameArena::doDeallocate(void*, std::size_t, std::size_t)
+{
+}
+
+
+void FrameArena::addBlock(std::size_t size)
+{
+    Block* block = static_cast<Block*>(mUpstream->allocate(sizeof(Block) + size));
+    block->previous = mCurrentBlock;
+    block->size = size;
+    mCurrentBlock = block;
+    mPosition = reinterpret_cast<char*>(block + 1);
+    mEnd = mPosition + size;
+    mCapacity += size;
+}
+
+
+void FrameArena::releaseBlocks()
+{
+    while(mCurrentBlock != nullptr)
+    {
+        Block* previous = mCurrentBlock->previous;
+        mUpstream->deallocate(mCurrentBlock, sizeof(Block) + mCurrentBlock->size);
+        mCurrentBlock = previous;
+    }
+    mPosition = nullptr;
+    mEnd = nullptr;
+    mCapacity = 0;
+}
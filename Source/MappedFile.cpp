@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+
+MappedFile::MappedFile()
+:mData(nullptr),
+mSize(0)
+#ifdef _WIN32
+,mFileHandle(INVALID_HANDLE_VALUE),
+mMappingHandle(nullptr)
+#endif
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+    mFileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(mFileHandle == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER fileSize;
+    if(GetFileSizeEx(mFileHandle, &fileSize) == FALSE || fileSize.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mMappingHandle == nullptr)
+    {
+        close();
+        return false;
+    }
+    mData = static_cast<const char*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(mData == nullptr)
+    {
+        close();
+        return false;
+    }
+    mSize = static_cast<std::size_t>(fileSize.QuadPart);
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if(mData != nullptr)
+        UnmapViewOfFile(mData);
+    if(mMappingHandle != nullptr)
+        CloseHandle(mMappingHandle);
+    if(mFileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(mFileHandle);
+    mData = nullptr;
+    mSize = 0;
+    mMappingHandle = nullptr;
+    mFileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+    int fileDescriptor = ::open(filename.c_str(), O_RDONLY);
+    if(fileDescriptor < 0)
+        return false;
+    struct stat fileStatus;
+    if(fstat(fileDescriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+        ::close(fileDescriptor);
+        return false;
+    }
+    void* mapping = mmap(nullptr, static_cast<std::size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    //The mapping keeps its own reference to the file.
+    ::close(fileDescriptor);
+    if(mapping == MAP_FAILED)
+        return false;
+    mData = static_cast<const char*>(mapping);
+    mSize = static_cast<std::size_t>(fileStatus.st_size);
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if(mData != nullptr)
+        munmap(const_cast<char*>(mData), mSize);
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+
+bool MappedFile::isOpen() const
+{
+    return mData != nullptr;
+}
+
+
+const char* MappedFile::getData() const
+{
+    return mData;
+}
+
+
+std::size_t MappedFile::getSize() const
+{
+    return mSize;
+}
@@ -0,0 +1,75 @@
+#include "MemoryResource.h"
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+
+
+namespace
+{
+    class NewDeleteResource : public MemoryResource
+    {
+    private:
+        void* doAllocate(std::size_t bytes, std::size_t alignment) override
+        {
+            if(alignment <= alignof(std::max_align_t))
+                return ::operator new(bytes);
+            //C++14 has no aligned operator new, so over-allocate and keep the original pointer just before the
+            //aligned block.  The block starts at least sizeof(void*) and at most alignment bytes into the allocation.
+            void* original = ::operator new(bytes + alignment);
+            std::uintptr_t address = reinterpret_cast<std::uintptr_t>(original) + sizeof(void*);
+            address = (address + alignment - 1) & ~std::uintptr_t(alignment - 1);
+            void* aligned = reinterpret_cast<void*>(address);
+            static_cast<void**>(aligned)[-1] = original;
+            return aligned;
+        }
+
+
+        void doDeallocate(void* pointer, std::size_t, std::size_t alignment) override
+        {
+            if(alignment <= alignof(std::max_align_t))
+                ::operator delete(pointer);
+            else
+                ::operator delete(static_cast<void**>(pointer)[-1]);
+        }
+    };
+
+
+    //Function-local statics, so that the resources are ready for containers constructed during static initialization.
+    std::atomic<MemoryResource*>& getDefaultSlot()
+    {
+        static std::atomic<MemoryResource*> defaultResource(MemoryResource::getNewDeleteResource());
+        return defaultResource;
+    }
+}
+
+
+bool MemoryResource::isEqual(const MemoryResource& other) const
+{
+    return doIsEqual(other);
+}
+
+
+MemoryResource* MemoryResource::getNewDeleteResource()
+{
+    static NewDeleteResource newDeleteResource;
+    return &newDeleteResource;
+}
+
+
+MemoryResource* MemoryResource::getDefault()
+{
+    return getDefaultSlot().load(std::memory_order_acquire);
+}
+
+
+MemoryResource* MemoryResource::setDefault(MemoryResource* resource)
+{
+    return getDefaultSlot().exchange(resource != nullptr ? resource : getNewDeleteResource(), std::memory_order_acq_rel);
+}
+
+
+bool MemoryResource::doIsEqual(const MemoryResource& other) const
+{
+    return this == &other;
+}
@@ -0,0 +1,266 @@
+#include "MusicStream.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <utility>
+
+
+
+namespace
+{
+    //Rounded like sf::SoundStream::setPlayingOffset(), so sample counts and playing offsets agree.
+    sf::Uint64 toSampleOffset(sf::Time time, unsigned sampleRate, unsigned channelCount)
+    {
+        return static_cast<sf::Uint64>(time.asSeconds() * sampleRate) * channelCount;
+    }
+
+
+    sf::Time toTime(sf::Uint64 sampleOffset, unsigned sampleRate, unsigned channelCount)
+    {
+        return sf::microseconds(static_cast<sf::Int64>(sampleOffset / channelCount * 1000000 / sampleRate));
+    }
+}
+
+
+MusicStream::Track::Track(const std::string& filename, sf::Time prebufferLength)
+:mFilename(filename),
+mPrebufferPosition(0)
+{
+    if(mFile.openFromFile(filename) == false)
+        throw std::runtime_error("Failed to open " + filename + " in MusicStream::Track::Track().");
+    prebuffer(prebufferLength);
+}
+
+
+MusicStream::Track::Track(const std::string& filename, std::shared_ptr<const std::vector<char>> encodedData, sf::Time prebufferLength)
+:mFilename(filename),
+mEncodedData(std::move(encodedData)),
+mPrebufferPosition(0)
+{
+    if(mFile.openFromMemory(mEncodedData->data(), mEncodedData->size()) == false)
+        throw std::runtime_error("Failed to decode " + filename + " from memory in MusicStream::Track::Track().");
+    prebuffer(prebufferLength);
+}
+
+
+void MusicStream::Track::prebuffer(sf::Time prebufferLength)
+{
+    sf::Uint64 prebufferSize = toSampleOffset(prebufferLength, mFile.getSampleRate(), mFile.getChannelCount());
+    mPrebuffer.resize(static_cast<std::size_t>(std::min(prebufferSize, mFile.getSampleCount())));
+    mPrebuffer.resize(static_cast<std::size_t>(mFile.read(mPrebuffer.data(), mPrebuffer.size())));
+}
+
+
+const std::string& MusicStream::Track::getFilename() const
+{
+    return mFilename;
+}
+
+
+unsigned MusicStream::Track::getChannelCount() const
+{
+    return mFile.getChannelCount();
+}
+
+
+unsigned MusicStream::Track::getSampleRate() const
+{
+    return mFile.getSampleRate();
+}
+
+
+sf::Time MusicStream::Track::getDuration() const
+{
+    return mFile.getDuration();
+}
+
+
+std::size_t MusicStream::Track::read(sf::Int16* samples, std::size_t maxCount)
+{
+    std::size_t numCopied = std::min(maxCount, mPrebuffer.size() - mPrebufferPosition);
+    std::copy(mPrebuffer.begin() + mPrebufferPosition, mPrebuffer.begin() + mPrebufferPosition + numCopied, samples);
+    mPrebufferPosition += numCopied;
+    if(numCopied == maxCount)
+        return numCopied;
+    return numCopied + static_cast<std::size_t>(mFile.read(samples + numCopied, maxCount - numCopied));
+}
+
+
+void MusicStream::Track::seek(sf::Time offset)
+{
+    //Rewinding into the prebuffered samples costs no disk I/O.
+    sf::Uint64 sampleOffset = toSampleOffset(offset, getSampleRate(), getChannelCount());
+    if(sampleOffset < mPrebuffer.size())
+    {
+        mPrebufferPosition = static_cast<std::size_t>(sampleOffset);
+        mFile.seek(static_cast<sf::Uint64>(mPrebuffer.size()));
+    }
+    else
+    {
+        mPrebufferPosition = mPrebuffer.size();
+        mFile.seek(sampleOffset);
+    }
+}
+
+
+MusicStream::MusicStream()
+:mReadTrack(nullptr),
+mQueuedTrackStart(0),
+mNumSamplesRead(0)
+{
+}
+
+
+MusicStream::~MusicStream()
+{
+    //The stream's thread reads the Tracks, so it must be stopped while they still exist.
+    stop();
+}
+
+
+void MusicStream::setTrack(std::unique_ptr<Track> track)
+{
+    stop();
+    mQueuedTrack.reset();
+    mTrack = std::move(track);
+    mReadTrack = mTrack.get();
+    mTrackStart = sf::Time::Zero;
+    mNumSamplesRead = 0;
+    if(mTrack)
+    {
+        mTrack->seek(sf::Time::Zero);
+        initialize(mTrack->getChannelCount(), mTrack->getSampleRate());
+        //One second per chunk, like sf::Music.
+        mSamples.resize(mTrack->getSampleRate() * mTrack->getChannelCount());
+    }
+}
+
+
+bool MusicStream::queueTrack(std::unique_ptr<Track>& track)
+{
+    if(!track || !mTrack || track->getChannelCount() != mTrack->getChannelCount() || track->getSampleRate() != mTrack->getSampleRate())
+        return false;
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mQueuedTrack)
+        return false;
+    mQueuedTrack = std::move(track);
+    return true;
+}
+
+
+bool MusicStream::hasQueuedTrack() const
+{
+    return mQueuedTrack != nullptr;
+}
+
+
+bool MusicStream::skipToQueuedTrack()
+{
+    if(!mQueuedTrack)
+        return false;
+    stop();
+    std::unique_ptr<Track> track = std::move(mQueuedTrack);
+    setTrack(std::move(track));
+    return true;
+}
+
+
+bool MusicStream::updateTrackChange()
+{
+    if(!mQueuedTrack)
+        return false;
+    //Read before locking, since sf::SoundStream has locks of its own.
+    bool stopped = getStatus() == sf::SoundStream::Stopped;
+    sf::Time playingOffset = getPlayingOffset();
+
+    std::unique_ptr<Track> finishedTrack;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(mReadTrack != mQueuedTrack.get())
+            return false;
+        sf::Time queuedTrackStart = toTime(mQueuedTrackStart, getSampleRate(), getChannelCount());
+        //The stream's thread reads ahead of what is heard, so the switch is only reported once playback gets there.
+        if(stopped == false && playingOffset < queuedTrackStart)
+            return false;
+        finishedTrack = std::move(mTrack);
+        mTrack = std::move(mQueuedTrack);
+        mTrackStart = queuedTrackStart;
+    }
+    return true;
+}
+
+
+sf::Time MusicStream::getTrackOffset() const
+{
+    return getPlayingOffset() - mTrackStart;
+}
+
+
+sf::Time MusicStream::getTrackDuration() const
+{
+    return mTrack ? mTrack->getDuration() : sf::Time::Zero;
+}
+
+
+const MusicStream::Track* MusicStream::getTrack() const
+{
+    return mTrack.get();
+}
+
+
+void MusicStream::setEventCallback(std::function<void()> callback)
+{
+    assert(getStatus() == sf::SoundStream::Stopped && "The stream must be stopped in MusicStream::setEventCallback()");
+    mEventCallback = std::move(callback);
+}
+
+
+bool MusicStream::onGetData(Chunk& data)
+{
+    Track* track;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        track = mReadTrack;
+    }
+    std::size_t count = 0;
+    bool trackEnded = false;
+    while(track != nullptr && count < mSamples.size())
+    {
+        count += track->read(mSamples.data() + count, mSamples.size() - count);
+        if(count < mSamples.size())
+        {
+            //The Track has ended; carry on with the queued one in the same chunk.
+            trackEnded = true;
+            std::lock_guard<std::mutex> lock(mMutex);
+            track = mQueuedTrack && mReadTrack == mTrack.get() ? mQueuedTrack.get() : nullptr;
+            if(track != nullptr)
+            {
+                mReadTrack = track;
+                mQueuedTrackStart = mNumSamplesRead + count;
+            }
+        }
+    }
+    mNumSamplesRead += count;
+    data.samples = mSamples.data();
+    data.sampleCount = count;
+    if(trackEnded && mEventCallback)
+        mEventCallback();
+    return track != nullptr;
+}
+
+
+void MusicStream::onSeek(sf::Time timeOffset)
+{
+    //Seeks within the current Track; if the stream's thread had already moved on, the queued Track starts over.
+    std::lock_guard<std::mutex> lock(mMutex);
+    mReadTrack = mTrack.get();
+    mTrackStart = sf::Time::Zero;
+    mNumSamplesRead = 0;
+    if(mTrack)
+    {
+        mTrack->seek(timeOffset);
+        mNumSamplesRead = toSampleOffset(timeOffset, mTrack->getSampleRate(), mTrack->getChannelCount());
+    }
+    if(mQueuedTrack)
+        mQueuedTrack->seek(sf::Time::Zero);
+}
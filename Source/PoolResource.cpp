@@ -0,0 +1,113 @@
+#include "PoolResource.h"
+#include <cassert>
+
+
+
+const std::size_t PoolResource::sMaxBlockSize;
+const std::size_t PoolResource::sMinBlockSize;
+const std::size_t PoolResource::sNumPools;
+const std::size_t PoolResource::sChunkHeaderSize;
+const std::size_t PoolResource::sMaxChunkBlocks;
+
+
+PoolResource::PoolResource(MemoryResource* upstream)
+:mUpstream(upstream),
+mChunks(nullptr),
+mPooledBytes(0)
+{
+    assert(upstream != nullptr && "PoolResource::PoolResource() requires an upstream resource");
+    static_assert(sizeof(Chunk) <= sChunkHeaderSize && sChunkHeaderSize % alignof(std::max_align_t) == 0, "PoolResource chunk header breaks block alignment");
+    static_assert(sMinBlockSize << (sNumPools - 1) == sMaxBlockSize, "PoolResource pool sizes don't add up");
+    for(Pool& pool : mPools)
+        pool = Pool{nullptr, 8};
+}
+
+
+PoolResource::~PoolResource()
+{
+    release();
+}
+
+
+void PoolResource::release()
+{
+    while(mChunks != nullptr)
+    {
+        Chunk* previous = mChunks->previous;
+        mUpstream->deallocate(mChunks, mChunks->size);
+        mChunks = previous;
+    }
+    for(Pool& pool : mPools)
+        pool = Pool{nullptr, 8};
+    mPooledBytes = 0;
+}
+
+
+std::size_t PoolResource::getPooledBytes() const
+{
+    return mPooledBytes;
+}
+
+
+void* PoolResource::doAllocate(std::size_t bytes, std::size_t alignment)
+{
+    std::size_t poolIndex = getPoolIndex(bytes, alignment);
+    if(poolIndex == sNumPools)
+        return mUpstream->allocate(bytes, alignment);
+    Pool& pool = mPools[poolIndex];
+    if(pool.freeBlocks == nullptr)
+        growPool(poolIndex);
+    FreeBlock* block = pool.freeBlocks;
+    pool.freeBlocks = block->next;
+    return block;
+}
+
+
+void PoolResource::doDeallocate(void* pointer, std::size_t bytes, std::size_t alignment)
+{
+    std::size_t poolIndex = getPoolIndex(bytes, alignment);
+    if(poolIndex == sNumPools)
+    {
+        mUpstream->deallocate(pointer, bytes, alignment);
+        return;
+    }
+    FreeBlock* block = static_cast<FreeBlock*>(pointer);
+    block->next = mPools[poolIndex].freeBlocks;
+    mPools[poolIndex].freeBlocks = block;
+}
+
+
+std::size_t PoolResource::getPoolIndex(std::size_t bytes, std::size_t alignment)
+{
+    //Blocks are aligned to their size, up to the alignment of the chunks.
+    if(bytes > sMaxBlockSize || alignment > alignof(std::max_align_t))
+        return sNumPools;
+    std::size_t poolIndex = 0;
+    for(std::size_t blockSize = sMinBlockSize; blockSize < bytes || blockSize < alignment; blockSize *= 2)
+        ++poolIndex;
+    return poolIndex;
+}
+
+
+void PoolResource::growPool(std::size_t poolIndex)
+{
+    Pool& pool = mPools[poolIndex];
+    std::size_t blockSize = sMinBlockSize << poolIndex;
+    std::size_t size = sChunkHeaderSize + blockSize * pool.nextChunkBlocks;
+    char* memory = static_cast<char*>(mUpstream->allocate(size));
+    Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+    chunk->previous = mChunks;
+    chunk->size = size;
+    mChunks = chunk;
+    mPooledBytes += size;
+
+    //Threaded in address order, so that the first allocations are contiguous.
+    for(std::size_t block = pool.nextChunkBlocks; block-- > 0;)
+    {
+        FreeBlock* freeBlock = reinterpret_cast<FreeBlock*>(memory + sChunkHeaderSize + block * blockSize);
+        freeBlock->next = pool.freeBlocks;
+        pool.freeBlocks = freeBlock;
+    }
+    if(pool.nextChunkBlocks < sMaxChunkBlocks)
+        pool.nextChunkBlocks *= 2;
+}
@@ -0,0 +1,402 @@
+#include "Profiler.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+
+
+const std::size_t Profiler::sRingCapacity;
+const std::size_t Profiler::sMaxCountersPerThread;
+
+
+namespace
+{
+    struct ZoneEvent
+    {
+        const char* name;
+        std::int64_t start;
+        std::int64_t end;
+    };
+
+    //Single-producer single-consumer ring: the owning thread pushes and markFrame() pops, so unlike
+    //LockFreeQueue neither side needs a compare-and-swap.
+    class ZoneRing
+    {
+    public:
+        ZoneRing()
+        :mEvents(new ZoneEvent[Profiler::sRingCapacity]),
+        mPushPosition(0),
+        mPopPosition(0)
+        {
+        }
+
+
+        bool tryPush(const ZoneEvent& event)
+        {
+            std::size_t position = mPushPosition.load(std::memory_order_relaxed);
+            if(position - mPopPosition.load(std::memory_order_acquire) == Profiler::sRingCapacity)
+                return false;
+            mEvents[position & (Profiler::sRingCapacity - 1)] = event;
+            mPushPosition.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+
+        bool tryPop(ZoneEvent& event)
+        {
+            std::size_t position = mPopPosition.load(std::memory_order_relaxed);
+            if(position == mPushPosition.load(std::memory_order_acquire))
+                return false;
+            event = mEvents[position & (Profiler::sRingCapacity - 1)];
+            mPopPosition.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::unique_ptr<ZoneEvent[]> mEvents;
+        std::atomic<std::size_t> mPushPosition;
+        //Padding rather than alignas, which new only honours from C++17.
+        char mPadding[64];
+        std::atomic<std::size_t> mPopPosition;
+    };
+
+    //Written only by the owning thread, so adding is a plain load and store rather than a locked
+    //read-modify-write.  markFrame() reports frame counters as the difference from the total it last saw.
+    struct CounterSlot
+    {
+        std::atomic<const char*> name;
+        std::atomic<std::int64_t> total;
+        bool isLevel;
+        std::int64_t lastReported;  //only touched by markFrame()
+    };
+
+    struct ThreadState
+    {
+        ThreadState()
+        :counters(new CounterSlot[Profiler::sMaxCountersPerThread]),
+        numCounters(0),
+        numDropped(0),
+        retired(false),
+        thread(0)
+        {
+        }
+
+        ZoneRing ring;
+        std::unique_ptr<CounterSlot[]> counters;
+        std::atomic<std::size_t> numCounters;
+        std::atomic<std::uint64_t> numDropped;
+        std::atomic<bool> retired;  //set when the thread exits; the state is reused once drained
+        std::uint32_t thread;  //trace thread id, guarded by the State mutex
+    };
+
+    struct CapturedEvent
+    {
+        char phase;  //Chrome trace phase: 'X' zone, 'C' counter, 'i' frame
+        std::uint32_t thread;
+        const char* name;
+        std::int64_t time;
+        std::int64_t durationOrValue;
+    };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadState>> threads;
+        std::vector<ThreadState*> freeThreads;
+        std::uint32_t nextThread = 1;
+        std::map<std::uint32_t, std::string> threadNames;
+        std::deque<CapturedEvent> capture;
+        std::size_t captureLimit = 1 << 20;
+        std::set<std::string> counterNames;  //interned, so that captured counters can point at them
+        std::map<std::string, std::int64_t> retiredLevels;  //levels left behind by exited threads
+        std::map<std::string, std::int64_t> retiredCounts;  //their frame counts not yet reported
+        std::int64_t frameStart = 0;
+        std::int64_t numFrames = 0;
+        std::uint64_t numDroppedFromRetired = 0;
+    };
+
+
+    State& getState()
+    {
+        static State state;
+        return state;
+    }
+
+
+    void addEvent(State& state, const CapturedEvent& event)
+    {
+        state.capture.push_back(event);
+        while(state.capture.size() > state.captureLimit)
+            state.capture.pop_front();
+    }
+
+
+    //Moves the zones in each thread's ring into the capture, and recycles the states of exited threads.
+    void drainRings(State& state)
+    {
+        for(auto& threadState : state.threads)
+        {
+            //Checked before draining, so that a thread's last zones are in the ring by the time it is seen as retired.
+            bool retired = threadState->retired.load(std::memory_order_acquire);
+            ZoneEvent zone;
+            while(threadState->ring.tryPop(zone))
+                addEvent(state, CapturedEvent{'X', threadState->thread, zone.name, zone.start, zone.end - zone.start});
+            if(retired && threadState->thread != 0)
+            {
+                //Short-lived threads, such as music prefetches, often exit between two frames, so their counters are carried over.
+                std::size_t numCounters = threadState->numCounters.load(std::memory_order_acquire);
+                for(std::size_t i = 0; i < numCounters; ++i)
+                {
+                    CounterSlot& counter = threadState->counters[i];
+                    std::int64_t total = counter.total.load(std::memory_order_relaxed);
+                    if(counter.isLevel)
+                        state.retiredLevels[counter.name.load(std::memory_order_relaxed)] += total;
+                    else
+                        state.retiredCounts[counter.name.load(std::memory_order_relaxed)] += total - counter.lastReported;
+                }
+                threadState->numCounters.store(0, std::memory_order_relaxed);
+                state.numDroppedFromRetired += threadState->numDropped.exchange(0, std::memory_order_relaxed);
+                threadState->thread = 0;
+                state.freeThreads.push_back(threadState.get());
+            }
+        }
+    }
+
+
+    ThreadState* registerThread()
+    {
+        State& state = getState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        ThreadState* threadState;
+        if(state.freeThreads.empty())
+        {
+            state.threads.emplace_back(new ThreadState());
+            threadState = state.threads.back().get();
+        }
+        else
+        {
+            threadState = state.freeThreads.back();
+            state.freeThreads.pop_back();
+            threadState->retired.store(false, std::memory_order_relaxed);
+        }
+        threadState->thread = state.nextThread++;
+        return threadState;
+    }
+
+
+    struct ThreadRegistration
+    {
+        ~ThreadRegistration()
+        {
+            if(threadState != nullptr)
+                threadState->retired.store(true, std::memory_order_release);
+        }
+
+        ThreadState* threadState = nullptr;
+    };
+
+
+    ThreadState& getThreadState()
+    {
+        thread_local ThreadRegistration registration;
+        if(registration.threadState == nullptr)
+            registration.threadState = registerThread();
+        return *registration.threadState;
+    }
+
+
+    void addToCounter(const char* name, std::int64_t delta, bool isLevel)
+    {
+        ThreadState& threadState = getThreadState();
+        //Only this thread adds counters, so the count can't change under it.
+        std::size_t numCounters = threadState.numCounters.load(std::memory_order_relaxed);
+        for(std::size_t i = 0; i < numCounters; ++i)
+        {
+            CounterSlot& counter = threadState.counters[i];
+            if(counter.name.load(std::memory_order_relaxed) == name)
+            {
+                counter.total.store(counter.total.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        assert(numCounters < Profiler::sMaxCountersPerThread && "Too many counters on one thread in Profiler::addToFrameCounter() or addToLevelCounter()");
+        if(numCounters == Profiler::sMaxCountersPerThread)
+            return;
+        CounterSlot& counter = threadState.counters[numCounters];
+        counter.name.store(name, std::memory_order_relaxed);
+        counter.total.store(delta, std::memory_order_relaxed);
+        counter.isLevel = isLevel;
+        counter.lastReported = 0;
+        threadState.numCounters.store(numCounters + 1, std::memory_order_release);
+    }
+
+
+    void writeString(std::FILE* file, const char* string)
+    {
+        std::fputc('"', file);
+        for(const char* character = string; *character != '\0'; ++character)
+        {
+            if(*character == '"' || *character == '\\')
+                std::fprintf(file, "\\%c", *character);
+            else if(static_cast<unsigned char>(*character) < 0x20)
+                std::fprintf(file, "\\u%04x", static_cast<unsigned>(*character));
+            else
+                std::fputc(*character, file);
+        }
+        std::fputc('"', file);
+    }
+}
+
+
+std::int64_t Profiler::now()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+void Profiler::recordZone(const char* name, std::int64_t start, std::int64_t end)
+{
+    ThreadState& threadState = getThreadState();
+    if(threadState.ring.tryPush(ZoneEvent{name, start, end}) == false)
+        threadState.numDropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void Profiler::addToFrameCounter(const char* name, std::int64_t delta)
+{
+    addToCounter(name, delta, false);
+}
+
+
+void Profiler::addToLevelCounter(const char* name, std::int64_t delta)
+{
+    addToCounter(name, delta, true);
+}
+
+
+void Profiler::markFrame()
+{
+    std::int64_t frameEnd = now();
+    std::uint32_t thread = getThreadState().thread;
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    //Retired threads' levels are sampled from retiredLevels, so their slots must not be counted again.
+    drainRings(state);
+
+    //Every counter seen so far is reported each frame, so that frame counts drop back to zero.
+    std::map<std::string, std::int64_t> values;
+    for(const std::string& name : state.counterNames)
+        values[name] = 0;
+    for(const auto& level : state.retiredLevels)
+        values[level.first] += level.second;
+    for(const auto& count : state.retiredCounts)
+        values[count.first] += count.second;
+    state.retiredCounts.clear();
+    for(auto& threadState : state.threads)
+    {
+        if(threadState->thread == 0)
+            continue;
+        std::size_t numCounters = threadState->numCounters.load(std::memory_order_acquire);
+        for(std::size_t i = 0; i < numCounters; ++i)
+        {
+            CounterSlot& counter = threadState->counters[i];
+            std::int64_t total = counter.total.load(std::memory_order_relaxed);
+            std::int64_t& value = values[counter.name.load(std::memory_order_relaxed)];
+            value += counter.isLevel ? total : total - counter.lastReported;
+            counter.lastReported = total;
+        }
+    }
+    //Counters describe the frame that just ended, so they start at its beginning.
+    for(const auto& value : values)
+    {
+        const char* name = state.counterNames.insert(value.first).first->c_str();
+        addEvent(state, CapturedEvent{'C', 0, name, state.frameStart, value.second});
+    }
+    addEvent(state, CapturedEvent{'i', thread, "Frame", frameEnd, state.numFrames});
+    state.frameStart = frameEnd;
+    ++state.numFrames;
+}
+
+
+void Profiler::setThreadName(const std::string& name)
+{
+    std::uint32_t thread = getThreadState().thread;
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.threadNames[thread] = name;
+}
+
+
+void Profiler::setCaptureLimit(std::size_t numEvents)
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.captureLimit = numEvents;
+    while(state.capture.size() > state.captureLimit)
+        state.capture.pop_front();
+}
+
+
+void Profiler::clear()
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    drainRings(state);
+    state.capture.clear();
+}
+
+
+bool Profiler::writeChromeTrace(const std::string& filename)
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    drainRings(state);
+
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if(file == nullptr)
+        return false;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for(const auto& threadName : state.threadNames)
+    {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", threadName.first);
+        writeString(file, threadName.second.c_str());
+        std::fprintf(file, "}}");
+        first = false;
+    }
+    //Chrome trace timestamps are in microseconds.
+    for(const CapturedEvent& event : state.capture)
+    {
+        std::fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+        writeString(file, event.name);
+        if(event.phase == 'X')
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.thread, event.time / 1000.0, event.durationOrValue / 1000.0);
+        else if(event.phase == 'C')
+            std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}", event.time / 1000.0, static_cast<long long>(event.durationOrValue));
+        else
+            std::fprintf(file, ",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"frame\":%lld}}", event.thread, event.time / 1000.0, static_cast<long long>(event.durationOrValue));
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+
+std::uint64_t Profiler::getNumDroppedZones()
+{
+    State& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    std::uint64_t numDropped = state.numDroppedFromRetired;
+    for(const auto& threadState : state.threads)
+        numDropped += threadState->numDropped.load(std::memory_order_relaxed);
+    return numDropped;
+}
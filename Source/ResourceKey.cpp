@@ -0,0 +1,97 @@
+#include "ResourceKey.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <stdlib.h>  //realpath() or _fullpath()
+#include <vector>
+
+
+
+std::string ResourceKey::canonicalizePath(const std::string& filename)
+{
+#ifdef _WIN32
+    char* resolved = _fullpath(nullptr, filename.c_str(), 0);
+#else
+    char* resolved = realpath(filename.c_str(), nullptr);
+#endif
+    if(resolved == nullptr)
+        return normalizePath(filename);
+    std::string path = normalizePath(resolved);
+    std::free(resolved);
+    return path;
+}
+
+
+std::string ResourceKey::hashContents(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if(!file)
+        throw std::runtime_error("Failed to open " + filename + " in ResourceKey::hashContents().");
+    std::uint64_t hash = 14695981039346656037ull;
+    std::uint64_t size = 0;
+    std::vector<char> buffer(64 * 1024);
+    while(file)
+    {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize numRead = file.gcount();
+        for(std::streamsize i = 0; i < numRead; ++i)
+        {
+            hash ^= static_cast<unsigned char>(buffer[i]);
+            hash *= 1099511628211ull;
+        }
+        size += static_cast<std::uint64_t>(numRead);
+    }
+    if(!file.eof())
+        throw std::runtime_error("Failed to read " + filename + " in ResourceKey::hashContents().");
+
+    char digest[40];
+    std::snprintf(digest, sizeof(digest), "%llx:%016llx", static_cast<unsigned long long>(size), static_cast<unsigned long long>(hash));
+    return digest;
+}
+
+
+void ResourceKey::appendArgument(std::string& key, const std::string& argument)
+{
+    key += '\0';
+    key += argument;
+}
+
+
+void ResourceKey::appendArgument(std::string& key, const char* argument)
+{
+    key += '\0';
+    key += argument;
+}
+
+
+std::string ResourceKey::normalizePath(const std::string& filename)
+{
+    //Split into components, dropping empty ones and ".", and cancel ".." against the preceding component.
+    bool absolute = !filename.empty() && (filename[0] == '/' || filename[0] == '\\');
+    std::vector<std::string> components;
+    std::string component;
+    for(std::size_t i = 0; i <= filename.size(); ++i)
+    {
+        if(i < filename.size() && filename[i] != '/' && filename[i] != '\\')
+        {
+            component += filename[i];
+            continue;
+        }
+        if(component == ".." && !components.empty() && components.back() != "..")
+            components.pop_back();
+        else if(!component.empty() && component != "." && !(component == ".." && absolute))
+            components.push_back(component);
+        component.clear();
+    }
+
+    std::string path = absolute ? "/" : "";
+    for(std::size_t i = 0; i < components.size(); ++i)
+    {
+        if(i > 0)
+            path += '/';
+        path += components[i];
+    }
+    return path;
+}
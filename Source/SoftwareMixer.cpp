@@ -0,0 +1,572 @@
+#include "SoftwareMixer.h"
+#include <SFML/Audio/Listener.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define SOFTWAREMIXER_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define SOFTWAREMIXER_TARGET(features)
+    #else
+        #define SOFTWAREMIXER_TARGET(features) __attribute__((target(features)))
+    #endif
+#endif
+
+
+
+const std::size_t SoftwareMixer::sCommandCapacity;
+
+
+namespace
+{
+    const float sFixedPointScale = 1.0f / 4294967296.0f;
+
+
+    //Frames [begin, end) of a mono voice, where samples[index + 1] is in range for every frame.  All kernels
+    //compute positions the same way, so they produce the same mix.
+    void mixMonoFrames(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                       float* left, float* right, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            float position = firstFraction + float(i) * step;
+            int index = int(position);
+            float fraction = position - float(index);
+            float first = samples[index];
+            float sample = first + fraction * (float(samples[index + 1]) - first);
+            left[i] += sample * leftGain;
+            right[i] += sample * rightGain;
+        }
+    }
+
+
+    void mixMonoScalar(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                       float* left, float* right, std::size_t numFrames)
+    {
+        mixMonoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, 0, numFrames);
+    }
+
+
+    //Same for a stereo voice, whose interleaved channels go to their own side.
+    void mixStereoFrames(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                         float* left, float* right, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            float position = firstFraction + float(i) * step;
+            int index = int(position);
+            float fraction = position - float(index);
+            const sf::Int16* frame = samples + index * 2;
+            float firstLeft = frame[0];
+            float firstRight = frame[1];
+            left[i] += (firstLeft + fraction * (float(frame[2]) - firstLeft)) * leftGain;
+            right[i] += (firstRight + fraction * (float(frame[3]) - firstRight)) * rightGain;
+        }
+    }
+
+
+    void mixStereoScalar(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                         float* left, float* right, std::size_t numFrames)
+    {
+        mixStereoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, 0, numFrames);
+    }
+
+
+    void convertScalar(const float* left, const float* right, sf::Int16* output, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            output[i * 2] = static_cast<sf::Int16>(std::lrint(std::min(32767.0f, std::max(-32768.0f, left[i]))));
+            output[i * 2 + 1] = static_cast<sf::Int16>(std::lrint(std::min(32767.0f, std::max(-32768.0f, right[i]))));
+        }
+    }
+
+
+#ifdef SOFTWAREMIXER_X86
+    bool cpuSupportsSSE2()
+    {
+    #if defined(__x86_64__) || defined(_M_X64)
+        return true;
+    #elif defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+    #else
+        return __builtin_cpu_supports("sse2");
+    #endif
+    }
+
+
+    bool cpuSupportsAVX2()
+    {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if(info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool osSavesAvxState = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        return osSavesAvxState && (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+
+
+    SOFTWAREMIXER_TARGET("sse2") inline __m128 loadFourSamples(const sf::Int16* samples)
+    {
+        __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(samples));
+        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+    }
+
+
+    //Four interleaved stereo frames, split into their left and right samples.
+    SOFTWAREMIXER_TARGET("sse2") inline void loadFourFrames(const sf::Int16* samples, __m128& lefts, __m128& rights)
+    {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+        __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16));
+        __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16));
+        lefts = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+        rights = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+
+
+    SOFTWAREMIXER_TARGET("sse2") void mixMonoSSE2(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                                                  float* left, float* right, std::size_t numFrames)
+    {
+        const __m128 leftGains = _mm_set1_ps(leftGain);
+        const __m128 rightGains = _mm_set1_ps(rightGain);
+        std::size_t i = 0;
+        if(step == 1.0f)
+        {
+            //Unpitched voices read contiguous samples, so no gather is needed.
+            const __m128 fractions = _mm_set1_ps(firstFraction);
+            for(; i + 4 <= numFrames; i += 4)
+            {
+                __m128 first = loadFourSamples(samples + i);
+                __m128 second = loadFourSamples(samples + i + 1);
+                __m128 sample = _mm_add_ps(first, _mm_mul_ps(fractions, _mm_sub_ps(second, first)));
+                _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(sample, leftGains)));
+                _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(sample, rightGains)));
+            }
+        }
+        else
+        {
+            const __m128 firstFractions = _mm_set1_ps(firstFraction);
+            const __m128 steps = _mm_set1_ps(step);
+            const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            alignas(16) std::int32_t indices[4];
+            for(; i + 4 <= numFrames; i += 4)
+            {
+                __m128 positions = _mm_add_ps(firstFractions, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(i)), laneOffsets), steps));
+                __m128i truncated = _mm_cvttps_epi32(positions);
+                __m128 fractions = _mm_sub_ps(positions, _mm_cvtepi32_ps(truncated));
+                _mm_store_si128(reinterpret_cast<__m128i*>(indices), truncated);
+                __m128 first = _mm_set_ps(samples[indices[3]], samples[indices[2]], samples[indices[1]], samples[indices[0]]);
+                __m128 second = _mm_set_ps(samples[indices[3] + 1], samples[indices[2] + 1], samples[indices[1] + 1], samples[indices[0] + 1]);
+                __m128 sample = _mm_add_ps(first, _mm_mul_ps(fractions, _mm_sub_ps(second, first)));
+                _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(sample, leftGains)));
+                _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(sample, rightGains)));
+            }
+        }
+        mixMonoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, i, numFrames);
+    }
+
+
+    SOFTWAREMIXER_TARGET("sse2") void mixStereoSSE2(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                                                    float* left, float* right, std::size_t numFrames)
+    {
+        const __m128 leftGains = _mm_set1_ps(leftGain);
+        const __m128 rightGains = _mm_set1_ps(rightGain);
+        std::size_t i = 0;
+        if(step == 1.0f)
+        {
+            const __m128 fractions = _mm_set1_ps(firstFraction);
+            for(; i + 4 <= numFrames; i += 4)
+            {
+                __m128 firstLefts, firstRights, secondLefts, secondRights;
+                loadFourFrames(samples + i * 2, firstLefts, firstRights);
+                loadFourFrames(samples + i * 2 + 2, secondLefts, secondRights);
+                __m128 leftSample = _mm_add_ps(firstLefts, _mm_mul_ps(fractions, _mm_sub_ps(secondLefts, firstLefts)));
+                __m128 rightSample = _mm_add_ps(firstRights, _mm_mul_ps(fractions, _mm_sub_ps(secondRights, firstRights)));
+                _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(leftSample, leftGains)));
+                _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(rightSample, rightGains)));
+            }
+        }
+        else
+        {
+            const __m128 firstFractions = _mm_set1_ps(firstFraction);
+            const __m128 steps = _mm_set1_ps(step);
+            const __m128 laneOffsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+            alignas(16) std::int32_t indices[4];
+            for(; i + 4 <= numFrames; i += 4)
+            {
+                __m128 positions = _mm_add_ps(firstFractions, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(float(i)), laneOffsets), steps));
+                __m128i truncated = _mm_cvttps_epi32(positions);
+                __m128 fractions = _mm_sub_ps(positions, _mm_cvtepi32_ps(truncated));
+                _mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_add_epi32(truncated, truncated));
+                const sf::Int16* frames[4] = {samples + indices[0], samples + indices[1], samples + indices[2], samples + indices[3]};
+                __m128 firstLefts = _mm_set_ps(frames[3][0], frames[2][0], frames[1][0], frames[0][0]);
+                __m128 firstRights = _mm_set_ps(frames[3][1], frames[2][1], frames[1][1], frames[0][1]);
+                __m128 secondLefts = _mm_set_ps(frames[3][2], frames[2][2], frames[1][2], frames[0][2]);
+                __m128 secondRights = _mm_set_ps(frames[3][3], frames[2][3], frames[1][3], frames[0][3]);
+                __m128 leftSample = _mm_add_ps(firstLefts, _mm_mul_ps(fractions, _mm_sub_ps(secondLefts, firstLefts)));
+                __m128 rightSample = _mm_add_ps(firstRights, _mm_mul_ps(fractions, _mm_sub_ps(secondRights, firstRights)));
+                _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(leftSample, leftGains)));
+                _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(rightSample, rightGains)));
+            }
+        }
+        mixStereoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, i, numFrames);
+    }
+
+
+    SOFTWAREMIXER_TARGET("avx2") void mixMonoAVX2(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                                                  float* left, float* right, std::size_t numFrames)
+    {
+        const __m256 leftGains = _mm256_set1_ps(leftGain);
+        const __m256 rightGains = _mm256_set1_ps(rightGain);
+        std::size_t i = 0;
+        if(step == 1.0f)
+        {
+            const __m256 fractions = _mm256_set1_ps(firstFraction);
+            for(; i + 8 <= numFrames; i += 8)
+            {
+                __m256 first = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i))));
+                __m256 second = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 1))));
+                __m256 sample = _mm256_add_ps(first, _mm256_mul_ps(fractions, _mm256_sub_ps(second, first)));
+                _mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_mul_ps(sample, leftGains)));
+                _mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), _mm256_mul_ps(sample, rightGains)));
+            }
+        }
+        else
+        {
+            const __m256 firstFractions = _mm256_set1_ps(firstFraction);
+            const __m256 steps = _mm256_set1_ps(step);
+            const __m256 laneOffsets = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+            for(; i + 8 <= numFrames; i += 8)
+            {
+                __m256 positions = _mm256_add_ps(firstFractions, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(float(i)), laneOffsets), steps));
+                __m256i indices = _mm256_cvttps_epi32(positions);
+                __m256 fractions = _mm256_sub_ps(positions, _mm256_cvtepi32_ps(indices));
+                //Each 32-bit gather at a 16-bit stride fetches a sample and its successor at once.
+                __m256i pairs = _mm256_i32gather_epi32(reinterpret_cast<const int*>(samples), indices, 2);
+                __m256 first = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(pairs, 16), 16));
+                __m256 second = _mm256_cvtepi32_ps(_mm256_srai_epi32(pairs, 16));
+                __m256 sample = _mm256_add_ps(first, _mm256_mul_ps(fractions, _mm256_sub_ps(second, first)));
+                _mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_mul_ps(sample, leftGains)));
+                _mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), _mm256_mul_ps(sample, rightGains)));
+            }
+        }
+        mixMonoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, i, numFrames);
+    }
+
+
+    SOFTWAREMIXER_TARGET("avx2") void mixStereoAVX2(const sf::Int16* samples, float firstFraction, float step, float leftGain, float rightGain,
+                                                    float* left, float* right, std::size_t numFrames)
+    {
+        //A stereo frame is a 32-bit pair, left in the low half, so eight frames are split with shifts.
+        const __m256 leftGains = _mm256_set1_ps(leftGain);
+        const __m256 rightGains = _mm256_set1_ps(rightGain);
+        std::size_t i = 0;
+        if(step == 1.0f)
+        {
+            const __m256 fractions = _mm256_set1_ps(firstFraction);
+            for(; i + 8 <= numFrames; i += 8)
+            {
+                __m256i firstFrames = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i * 2));
+                __m256i secondFrames = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i * 2 + 2));
+                __m256 firstLefts = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(firstFrames, 16), 16));
+                __m256 firstRights = _mm256_cvtepi32_ps(_mm256_srai_epi32(firstFrames, 16));
+                __m256 secondLefts = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(secondFrames, 16), 16));
+                __m256 secondRights = _mm256_cvtepi32_ps(_mm256_srai_epi32(secondFrames, 16));
+                __m256 leftSample = _mm256_add_ps(firstLefts, _mm256_mul_ps(fractions, _mm256_sub_ps(secondLefts, firstLefts)));
+                __m256 rightSample = _mm256_add_ps(firstRights, _mm256_mul_ps(fractions, _mm256_sub_ps(secondRights, firstRights)));
+                _mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_mul_ps(leftSample, leftGains)));
+                _mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), _mm256_mul_ps(rightSample, rightGains)));
+            }
+        }
+        else
+        {
+            const __m256 firstFractions = _mm256_set1_ps(firstFraction);
+            const __m256 steps = _mm256_set1_ps(step);
+            const __m256 laneOffsets = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+            const int* frames = reinterpret_cast<const int*>(samples);
+            for(; i + 8 <= numFrames; i += 8)
+            {
+                __m256 positions = _mm256_add_ps(firstFractions, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(float(i)), laneOffsets), steps));
+                __m256i indices = _mm256_cvttps_epi32(positions);
+                __m256 fractions = _mm256_sub_ps(positions, _mm256_cvtepi32_ps(indices));
+                __m256i firstFrames = _mm256_i32gather_epi32(frames, indices, 4);
+                __m256i secondFrames = _mm256_i32gather_epi32(frames + 1, indices, 4);
+                __m256 firstLefts = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(firstFrames, 16), 16));
+                __m256 firstRights = _mm256_cvtepi32_ps(_mm256_srai_epi32(firstFrames, 16));
+                __m256 secondLefts = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(secondFrames, 16), 16));
+                __m256 secondRights = _mm256_cvtepi32_ps(_mm256_srai_epi32(secondFrames, 16));
+                __m256 leftSample = _mm256_add_ps(firstLefts, _mm256_mul_ps(fractions, _mm256_sub_ps(secondLefts, firstLefts)));
+                __m256 rightSample = _mm256_add_ps(firstRights, _mm256_mul_ps(fractions, _mm256_sub_ps(secondRights, firstRights)));
+                _mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_mul_ps(leftSample, leftGains)));
+                _mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), _mm256_mul_ps(rightSample, rightGains)));
+            }
+        }
+        mixStereoFrames(samples, firstFraction, step, leftGain, rightGain, left, right, i, numFrames);
+    }
+
+
+    SOFTWAREMIXER_TARGET("sse2") void convertSSE2(const float* left, const float* right, sf::Int16* output, std::size_t numFrames)
+    {
+        //Clamped first, since out of range floats convert to INT_MIN.
+        const __m128 maximum = _mm_set1_ps(32767.0f);
+        const __m128 minimum = _mm_set1_ps(-32768.0f);
+        std::size_t i = 0;
+        for(; i + 4 <= numFrames; i += 4)
+        {
+            __m128 leftFrames = _mm_min_ps(maximum, _mm_max_ps(minimum, _mm_loadu_ps(left + i)));
+            __m128 rightFrames = _mm_min_ps(maximum, _mm_max_ps(minimum, _mm_loadu_ps(right + i)));
+            __m128i firstHalf = _mm_cvtps_epi32(_mm_unpacklo_ps(leftFrames, rightFrames));
+            __m128i secondHalf = _mm_cvtps_epi32(_mm_unpackhi_ps(leftFrames, rightFrames));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i * 2), _mm_packs_epi32(firstHalf, secondHalf));
+        }
+        convertScalar(left, right, output, i, numFrames);
+    }
+#endif
+}
+
+
+SoftwareMixer::SoftwareMixer(std::size_t maxVoices, unsigned sampleRate, std::size_t blockSize)
+:mCommands(sCommandCapacity),
+mMaxVoices(maxVoices),
+mBlockSize(blockSize),
+mLeft(blockSize),
+mRight(blockSize),
+mOutput(blockSize * 2),
+mNumActiveVoices(0),
+mNumDroppedSounds(0),
+mKernel(Kernel::Scalar)
+{
+    assert(maxVoices > 0 && blockSize > 0 && "SoftwareMixer::SoftwareMixer() requires at least one voice and one frame per block");
+    mVoices.reserve(maxVoices);
+    if(isKernelSupported(Kernel::AVX2))
+        mKernel = Kernel::AVX2;
+    else if(isKernelSupported(Kernel::SSE2))
+        mKernel = Kernel::SSE2;
+    initialize(2, sampleRate);
+}
+
+
+SoftwareMixer::~SoftwareMixer()
+{
+    //The stream's thread calls onGetData(), so it must be stopped while this object is still whole.
+    stop();
+}
+
+
+bool SoftwareMixer::playSound(const sf::SoundBuffer& soundBuffer, float volume, float pitch, float pan)
+{
+    assert(volume >= 0 && volume <= 100 && "Volume must be between 0-100 in SoftwareMixer::playSound()");
+    assert(pitch > 0 && "Pitch must be greater than 0 in SoftwareMixer::playSound()");
+    assert(pan >= -1 && pan <= 1 && "Pan must be between -1 and 1 in SoftwareMixer::playSound()");
+    assert((soundBuffer.getChannelCount() == 1 || soundBuffer.getChannelCount() == 2) && "SoftwareMixer::playSound() only mixes mono and stereo buffers");
+
+    //Constant power panning: the gains lie on a quarter circle, so the total power does not depend on the pan.
+    float angle = (pan + 1.0f) * 0.785398163f;
+    Command command{Command::Play, &soundBuffer, std::cos(angle) * volume / 100.0f, std::sin(angle) * volume / 100.0f, pitch};
+    if(mCommands.tryPush(command))
+        return true;
+    mNumDroppedSounds.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+
+bool SoftwareMixer::playSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo)
+{
+    sf::Vector3f listenerPosition = sf::Listener::getPosition();
+    sf::Vector3f offset = soundInfo.relativeToListener ? soundInfo.position : soundInfo.position - listenerPosition;
+    float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+    float pan = std::min(1.0f, std::max(-1.0f, offset.x / std::max(distance, soundInfo.minDistance)));
+    return playSound(soundBuffer, SoundPlayer::computeAudibleVolume(soundInfo, listenerPosition), soundInfo.pitch, pan);
+}
+
+
+bool SoftwareMixer::stopAllSounds()
+{
+    return mCommands.tryPush(Command{Command::StopAll, nullptr, 0.0f, 0.0f, 1.0f});
+}
+
+
+std::size_t SoftwareMixer::getNumActiveVoices() const
+{
+    return mNumActiveVoices.load(std::memory_order_relaxed);
+}
+
+
+std::uint64_t SoftwareMixer::getNumDroppedSounds() const
+{
+    return mNumDroppedSounds.load(std::memory_order_relaxed);
+}
+
+
+bool SoftwareMixer::isKernelSupported(Kernel kernel)
+{
+    switch(kernel)
+    {
+        case Kernel::Scalar:
+            return true;
+#ifdef SOFTWAREMIXER_X86
+        case Kernel::SSE2:
+            return cpuSupportsSSE2();
+        case Kernel::AVX2:
+            return cpuSupportsAVX2();
+#endif
+        default:
+            return false;
+    }
+}
+
+
+void SoftwareMixer::setKernel(Kernel kernel)
+{
+    assert(isKernelSupported(kernel) && "SoftwareMixer::setKernel() was given a kernel that this CPU does not support");
+    mKernel.store(kernel, std::memory_order_relaxed);
+}
+
+
+SoftwareMixer::Kernel SoftwareMixer::getKernel() const
+{
+    return mKernel.load(std::memory_order_relaxed);
+}
+
+
+void SoftwareMixer::mix(sf::Int16* output, std::size_t numFrames)
+{
+    executeCommands();
+    Kernel kernel = mKernel.load(std::memory_order_relaxed);
+    VoiceKernel monoKernel = mixMonoScalar;
+    VoiceKernel stereoKernel = mixStereoScalar;
+#ifdef SOFTWAREMIXER_X86
+    if(kernel == Kernel::AVX2)
+    {
+        monoKernel = mixMonoAVX2;
+        stereoKernel = mixStereoAVX2;
+    }
+    else if(kernel == Kernel::SSE2)
+    {
+        monoKernel = mixMonoSSE2;
+        stereoKernel = mixStereoSSE2;
+    }
+#endif
+
+    for(std::size_t done = 0; done < numFrames;)
+    {
+        std::size_t count = std::min(mBlockSize, numFrames - done);
+        std::fill(mLeft.begin(), mLeft.begin() + count, 0.0f);
+        std::fill(mRight.begin(), mRight.begin() + count, 0.0f);
+        for(std::size_t i = 0; i < mVoices.size();)
+        {
+            if(mixVoice(mVoices[i], count, monoKernel, stereoKernel))
+            {
+                ++i;
+            }
+            else
+            {
+                mVoices[i] = mVoices.back();
+                mVoices.pop_back();
+            }
+        }
+#ifdef SOFTWAREMIXER_X86
+        if(kernel != Kernel::Scalar)
+            convertSSE2(mLeft.data(), mRight.data(), output + done * 2, count);
+        else
+#endif
+            convertScalar(mLeft.data(), mRight.data(), output + done * 2, 0, count);
+        done += count;
+    }
+    mNumActiveVoices.store(mVoices.size(), std::memory_order_relaxed);
+}
+
+
+bool SoftwareMixer::onGetData(Chunk& data)
+{
+    mix(mOutput.data(), mBlockSize);
+    data.samples = mOutput.data();
+    data.sampleCount = mOutput.size();
+    return true;  //the mix never ends; it plays silence when no voice is active
+}
+
+
+void SoftwareMixer::onSeek(sf::Time)
+{
+    //A mix of independent one-shots has no timeline to seek in.
+}
+
+
+void SoftwareMixer::executeCommands()
+{
+    Command command;
+    while(mCommands.tryPop(command))
+    {
+        if(command.type == Command::StopAll)
+        {
+            mVoices.clear();
+            continue;
+        }
+
+        const sf::SoundBuffer& buffer = *command.buffer;
+        std::uint32_t channelCount = buffer.getChannelCount();
+        if(mVoices.size() >= mMaxVoices || buffer.getSampleCount() == 0 || channelCount < 1 || channelCount > 2)
+        {
+            mNumDroppedSounds.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        double step = double(command.pitch) * buffer.getSampleRate() / getSampleRate();
+        mVoices.push_back(Voice{buffer.getSamples(), static_cast<std::uint32_t>(buffer.getSampleCount() / channelCount), channelCount,
+                                0, static_cast<std::uint64_t>(step * 4294967296.0), command.leftGain, command.rightGain});
+    }
+}
+
+
+bool SoftwareMixer::mixVoice(Voice& voice, std::size_t numFrames, VoiceKernel monoKernel, VoiceKernel stereoKernel)
+{
+    const std::uint64_t end = std::uint64_t(voice.numFrames) << 32;
+    if(voice.step == 0 || voice.position >= end)
+        return false;
+    std::uint64_t framesLeft = (end - voice.position + voice.step - 1) / voice.step;
+    std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(numFrames, framesLeft));
+    float* left = mLeft.data();
+    float* right = mRight.data();
+
+    //The kernels interpolate in single precision relative to the first frame, so the last two source frames
+    //are left to the exact loop below; that margin covers any rounding in the kernel's positions.
+    std::size_t numFast = 0;
+    std::uint64_t fastEnd = voice.numFrames > 2 ? std::uint64_t(voice.numFrames - 2) << 32 : 0;
+    if(voice.position < fastEnd)
+        numFast = static_cast<std::size_t>(std::min<std::uint64_t>(count, (fastEnd - voice.position + voice.step - 1) / voice.step));
+    VoiceKernel kernel = voice.channelCount == 1 ? monoKernel : stereoKernel;
+    kernel(voice.samples + (voice.position >> 32) * voice.channelCount, float(voice.position & 0xFFFFFFFF) * sFixedPointScale,
+           float(voice.step) * sFixedPointScale, voice.leftGain, voice.rightGain, left, right, numFast);
+
+    //Exact fixed point positions for the remaining frames; a missing successor sample is treated as silence.
+    for(std::size_t i = numFast; i < count; ++i)
+    {
+        std::uint64_t position = voice.position + voice.step * i;
+        std::uint32_t index = static_cast<std::uint32_t>(position >> 32);
+        float fraction = float(position & 0xFFFFFFFF) * sFixedPointScale;
+        for(std::uint32_t channel = 0; channel < voice.channelCount; ++channel)
+        {
+            float first = voice.samples[index * voice.channelCount + channel];
+            float second = index + 1 < voice.numFrames ? voice.samples[(index + 1) * voice.channelCount + channel] : 0.0f;
+            float sample = first + fraction * (second - first);
+            //Mono voices are panned; stereo voices keep their channels apart.
+            if(voice.channelCount == 1 || channel == 0)
+                left[i] += sample * voice.leftGain;
+            if(voice.channelCount == 1 || channel == 1)
+                right[i] += sample * voice.rightGain;
+        }
+    }
+
+    voice.position += voice.step * count;
+    return voice.position < end;
+}
@@ -0,0 +1,131 @@
+#include "SongCache.h"
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+
+
+SongCache::SongCache(std::size_t budget)
+:mBudget(budget),
+mSize(0)
+{
+}
+
+
+std::shared_ptr<const SongCache::Data> SongCache::load(const std::string& filename)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto found = mEntryLookup.find(filename);
+        if(found != mEntryLookup.end())
+        {
+            mEntries.splice(mEntries.begin(), mEntries, found->second);
+            ++mStatistics.numHits;
+            return found->second->data;
+        }
+        ++mStatistics.numMisses;
+    }
+
+    //Read without holding the lock, so that other songs can be looked up meanwhile.
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if(!file)
+        throw std::runtime_error("Failed to open " + filename + " in SongCache::load().");
+    std::shared_ptr<Data> data = std::make_shared<Data>(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    if(!file.read(data->data(), data->size()))
+        throw std::runtime_error("Failed to read " + filename + " in SongCache::load().");
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStatistics.numBytesRead += data->size();
+    //Another thread may have loaded the same song in the meantime.
+    auto found = mEntryLookup.find(filename);
+    if(found != mEntryLookup.end())
+        return found->second->data;
+    mEntries.push_front(Entry{filename, std::move(data), 0});
+    mEntryLookup.emplace(filename, mEntries.begin());
+    mSize += mEntries.front().data->size();
+    std::shared_ptr<const Data> loaded = mEntries.front().data;
+    evict();
+    return loaded;
+}
+
+
+bool SongCache::pin(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mEntryLookup.find(filename);
+    if(found == mEntryLookup.end())
+        return false;
+    ++found->second->numPins;
+    return true;
+}
+
+
+void SongCache::unpin(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto found = mEntryLookup.find(filename);
+    assert(found != mEntryLookup.end() && found->second->numPins > 0 && "Song is not pinned in SongCache::unpin()");
+    --found->second->numPins;
+    evict();
+}
+
+
+bool SongCache::isCached(const std::string& filename) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntryLookup.count(filename) != 0;
+}
+
+
+void SongCache::setBudget(std::size_t budget)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = budget;
+    evict();
+}
+
+
+std::size_t SongCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mBudget;
+}
+
+
+std::size_t SongCache::getSize() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSize;
+}
+
+
+SongCache::Statistics SongCache::getStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStatistics;
+}
+
+
+void SongCache::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStatistics = Statistics();
+}
+
+
+void SongCache::evict()
+{
+    for(auto iter = mEntries.end(); mSize > mBudget && iter != mEntries.begin();)
+    {
+        --iter;
+        //A song that is still played from would stay in memory anyway.
+        if(iter->numPins > 0 || iter->data.use_count() > 1)
+            continue;
+        mSize -= iter->data->size();
+        mEntryLookup.erase(iter->filename);
+        iter = mEntries.erase(iter);
+        ++mStatistics.numEvictions;
+    }
+}
@@ -0,0 +1,79 @@
+#include "SongOrder.h"
+#include <cassert>
+#include <utility>
+
+
+
+namespace
+{
+    //SplitMix64: fully specified, unlike the engines and distributions of <random>, whose
+    //std::uniform_int_distribution varies between standard libraries.
+    std::uint64_t nextRandom(std::uint64_t& state)
+    {
+        state += 0x9E3779B97F4A7C15ull;
+        std::uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+
+    //A number in [0, bound), by multiplying instead of taking a remainder.
+    std::size_t nextIndex(std::uint64_t& state, std::size_t bound)
+    {
+        return static_cast<std::size_t>(((nextRandom(state) >> 32) * bound) >> 32);
+    }
+}
+
+
+SongOrder::SongOrder()
+:mSeed(0),
+mNumSongs(0)
+{
+}
+
+
+std::size_t SongOrder::getIndex(std::uint64_t seed, std::size_t numSongs, std::size_t position)
+{
+    assert(position < numSongs && "Position out of range in SongOrder::getIndex()");
+    if(seed == 0)
+        return position;
+    if(seed != mSeed || numSongs != mNumSongs)
+        materialize(seed, numSongs);
+    return mIndices[position];
+}
+
+
+std::size_t SongOrder::getFirstIndex(std::uint64_t seed, std::size_t numSongs)
+{
+    assert(numSongs > 0 && "Empty Playlist in SongOrder::getFirstIndex()");
+    if(seed == 0)
+        return 0;
+    //The first step of the forward Fisher-Yates shuffle in materialize() settles position zero.
+    std::uint64_t state = seed;
+    return nextIndex(state, numSongs);
+}
+
+
+std::uint64_t SongOrder::getNextCycleSeed(std::uint64_t seed)
+{
+    if(seed == 0)
+        return 0;
+    std::uint64_t state = seed;
+    std::uint64_t nextSeed = nextRandom(state);
+    return nextSeed == 0 ? 1 : nextSeed;
+}
+
+
+void SongOrder::materialize(std::uint64_t seed, std::size_t numSongs)
+{
+    assert(numSongs <= 0xFFFFFFFF && "Too many songs in SongOrder::materialize()");
+    mIndices.resize(numSongs);
+    for(std::size_t i = 0; i < numSongs; ++i)
+        mIndices[i] = static_cast<std::uint32_t>(i);
+    std::uint64_t state = seed;
+    for(std::size_t i = 0; i + 1 < numSongs; ++i)
+        std::swap(mIndices[i], mIndices[i + nextIndex(state, numSongs - i)]);
+    mSeed = seed;
+    mNumSongs = numSongs;
+}
@@ -0,0 +1,31 @@
+#include "SongTable.h"
+#include <cassert>
+
+
+
+const SongTable::SongId SongTable::InvalidSongId;
+
+
+SongTable::SongId SongTable::intern(const std::string& path)
+{
+    auto inserted = mSongIds.emplace(path, static_cast<SongId>(mPaths.size()));
+    if(inserted.second)
+    {
+        assert(mPaths.size() < InvalidSongId && "Too many songs in SongTable::intern()");
+        mPaths.push_back(&inserted.first->first);
+    }
+    return inserted.first->second;
+}
+
+
+const std::string& SongTable::getPath(SongId songId) const
+{
+    assert(songId < mPaths.size() && "Invalid SongId in SongTable::getPath()");
+    return *mPaths[songId];
+}
+
+
+std::size_t SongTable::getNumSongs() const
+{
+    return mPaths.size();
+}
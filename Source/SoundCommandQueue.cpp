@@ -0,0 +1,138 @@
+#include "SoundCommandQueue.h"
+#include <algorithm>
+
+
+
+const SoundCommandQueue::Ticket SoundCommandQueue::InvalidTicket;
+
+
+SoundCommandQueue::SoundCommandQueue(std::size_t capacity, MemoryResource* memoryResource)
+:mCommands(capacity),
+mNextTicket(InvalidTicket + 1),
+mNumRejectedCommands(0),
+mPlayingSounds(0, std::hash<Ticket>(), std::equal_to<Ticket>(), memoryResource),
+mSweepThreshold(64)
+{
+}
+
+
+SoundCommandQueue::Ticket SoundCommandQueue::playSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo)
+{
+    Ticket ticket = mNextTicket.fetch_add(1, std::memory_order_relaxed);
+    return push(Command{Command::Play, ticket, &soundBuffer, soundInfo}) ? ticket : InvalidTicket;
+}
+
+
+bool SoundCommandQueue::queueSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo)
+{
+    return push(Command{Command::Queue, InvalidTicket, &soundBuffer, soundInfo});
+}
+
+
+bool SoundCommandQueue::stopSound(Ticket ticket)
+{
+    return push(Command{Command::Stop, ticket, nullptr, SoundInfo()});
+}
+
+
+bool SoundCommandQueue::setPosition(Ticket ticket, const sf::Vector3f& position)
+{
+    Command command{Command::SetPosition, ticket, nullptr, SoundInfo()};
+    command.info.position = position;
+    return push(command);
+}
+
+
+bool SoundCommandQueue::setVolume(Ticket ticket, float volume)
+{
+    Command command{Command::SetVolume, ticket, nullptr, SoundInfo()};
+    command.info.volume = volume;
+    return push(command);
+}
+
+
+bool SoundCommandQueue::setPitch(Ticket ticket, float pitch)
+{
+    Command command{Command::SetPitch, ticket, nullptr, SoundInfo()};
+    command.info.pitch = pitch;
+    return push(command);
+}
+
+
+std::uint64_t SoundCommandQueue::getNumRejectedCommands() const
+{
+    return mNumRejectedCommands.load(std::memory_order_relaxed);
+}
+
+
+std::size_t SoundCommandQueue::execute(SoundPlayer& soundPlayer)
+{
+    std::size_t numExecuted = 0;
+    Command command;
+    while(mCommands.tryPop(command))
+    {
+        ++numExecuted;
+        if(command.type == Command::Play)
+        {
+            SoundPlayer::SoundHandle handle = soundPlayer.playSound(*command.buffer, command.info);
+            if(soundPlayer.isPlaying(handle))
+                mPlayingSounds[command.ticket] = handle;
+            continue;
+        }
+        if(command.type == Command::Queue)
+        {
+            soundPlayer.queueSound(*command.buffer, command.info);
+            continue;
+        }
+
+        //Commands for sounds that were rejected or have finished are ignored.
+        auto found = mPlayingSounds.find(command.ticket);
+        if(found == mPlayingSounds.end())
+            continue;
+        switch(command.type)
+        {
+            case Command::Stop:
+                soundPlayer.stopSound(found->second);
+                mPlayingSounds.erase(found);
+                break;
+            case Command::SetPosition:
+                soundPlayer.setPosition(found->second, command.info.position);
+                break;
+            case Command::SetVolume:
+                soundPlayer.setVolume(found->second, command.info.volume);
+                break;
+            case Command::SetPitch:
+                soundPlayer.setPitch(found->second, command.info.pitch);
+                break;
+            default:
+                break;
+        }
+    }
+    forgetFinishedSounds(soundPlayer);
+    return numExecuted;
+}
+
+
+bool SoundCommandQueue::push(const Command& command)
+{
+    if(mCommands.tryPush(command))
+        return true;
+    mNumRejectedCommands.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+
+void SoundCommandQueue::forgetFinishedSounds(const SoundPlayer& soundPlayer)
+{
+    //Sweeping only when the map has doubled since the last sweep keeps the cost constant per sound played.
+    if(mPlayingSounds.size() < mSweepThreshold)
+        return;
+    for(auto iter = mPlayingSounds.begin(); iter != mPlayingSounds.end();)
+    {
+        if(soundPlayer.isPlaying(iter->second))
+            ++iter;
+        else
+            iter = mPlayingSounds.erase(iter);
+    }
+    mSweepThreshold = std::max<std::size_t>(64, mPlayingSounds.size() * 2);
+}
@@ -1,31 +1,505 @@
 #include "SoundPlayer.h"
+#include "Profiler.h"
+#include <SFML/Audio/Listener.hpp>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 
 
 
-void SoundPlayer::playSound(sf::SoundBuffer& soundBuffer, SoundInfo soundInfo)
+const SoundPlayer::SoundHandle SoundPlayer::InvalidHandle{0xFFFFFFFF, 0};
+const std::uint32_t SoundPlayer::sInvalidIndex;
+const float SoundPlayer::sHysteresis = 0.8f;
+
+
+namespace
+{
+    void assertValidSoundInfo(const SoundInfo& soundInfo)
+    {
+        assert(soundInfo.volume >= 0 && soundInfo.volume <= 100 && "Volume must be between 0-100 in SoundPlayer::playSound() or queueSound()");
+        assert(soundInfo.pitch > 0 && "Pitch must be greater than 0 in SoundPlayer::playSound() or queueSound()");
+        assert(soundInfo.minDistance > 0 && "minDistance must be greater than 0 in SoundPlayer::playSound() or queueSound()");
+        assert(soundInfo.attenuation >= 0 && "attenuation must be greater than or equal to 0 in SoundPlayer::playSound() or queueSound()");
+        (void)soundInfo;
+    }
+}
+
+
+SoundPlayer::SoundPlayer(std::size_t numVoices, StealPolicy stealPolicy, MemoryResource* memoryResource)
+:mVoices(numVoices, memoryResource),
+mVoiceStates(numVoices, memoryResource),
+mFreeVoices(memoryResource),
+mInstances(memoryResource),
+mFreeInstances(memoryResource),
+mActiveInstances(memoryResource),
+mPromotionCandidates(memoryResource),
+mBufferStates(0, std::hash<const sf::SoundBuffer*>(), std::equal_to<const sf::SoundBuffer*>(), memoryResource),
+mQueuedSounds(memoryResource),
+mStealPolicy(stealPolicy),
+mAudibilityThreshold(1.0f),
+mNumSoundsStarted(0)
+{
+    assert(numVoices > 0 && "SoundPlayer::SoundPlayer() requires at least one voice");
+    mFreeVoices.reserve(numVoices);
+    //Pushed in reverse so that voice 0 is handed out first.
+    for(std::size_t voice = numVoices; voice-- > 0;)
+        pushFreeVoice(static_cast<std::uint32_t>(voice));
+}
+
+
+SoundPlayer::~SoundPlayer()
+{
+    PROFILE_LEVEL("Voices live", -static_cast<std::int64_t>(getNumActiveVoices()));
+}
+
+
+SoundPlayer::SoundHandle SoundPlayer::playSound(const sf::SoundBuffer& soundBuffer, SoundInfo soundInfo)
+{
+    assertValidSoundInfo(soundInfo);
+    ++mStatistics.numRequests;
+    return startSound(soundBuffer, soundInfo);
+}
+
+
+void SoundPlayer::queueSound(const sf::SoundBuffer& soundBuffer, SoundInfo soundInfo)
 {
-    assert(soundInfo.volume >= 0 && soundInfo.volume <= 100 && "Volume must be between 0-100 in SoundPlayer::playSound()");
-    assert(soundInfo.pitch > 0 && "Pitch must be greater than 0 in SoundPlayer::playSound");
-    assert(soundInfo.minDistance > 0 && "minDistance must be greater than 0 in SoundPlayer::playSound");
-    assert(soundInfo.attenuation >= 0 && "attenuation must be greater than or equal to 0 in SoundPlayer::playSound");
-    
-    sf::Sound sound(soundBuffer);
-    sound.setRelativeToListener(soundInfo.relativeToListener);
-    sound.setPosition(soundInfo.position);
-    sound.setVolume(soundInfo.volume);
-    sound.setPitch(soundInfo.pitch);
-    sound.setMinDistance(soundInfo.minDistance);
-    sound.setAttenuation(soundInfo.attenuation);
-    mSounds.push_back(sf::Sound(soundBuffer));
-    mSounds.back().play();
+    assertValidSoundInfo(soundInfo);
+    ++mStatistics.numRequests;
+    mQueuedSounds.push_back(QueuedSound{&soundBuffer, soundInfo, static_cast<std::uint32_t>(mQueuedSounds.size())});
 }
 
 
-void SoundPlayer::removeStoppedSounds()
+void SoundPlayer::stopSound(SoundHandle handle)
 {
-    for(auto iter = mSounds.begin(); iter != mSounds.end(); ++iter)
+    if(isAlive(handle))
+        releaseInstance(handle.sound);
+}
+
+
+void SoundPlayer::setPosition(SoundHandle handle, const sf::Vector3f& position)
+{
+    if(isAlive(handle))
+    {
+        Instance& instance = mInstances[handle.sound];
+        instance.info.position = position;
+        if(instance.voice != sInvalidIndex)
+            mVoices[instance.voice].setPosition(position);
+    }
+}
+
+
+void SoundPlayer::setVolume(SoundHandle handle, float volume)
+{
+    assert(volume >= 0 && volume <= 100 && "Volume must be between 0-100 in SoundPlayer::setVolume()");
+    if(isAlive(handle))
     {
-        if(iter->getStatus() == sf::Sound::Status::Stopped)
-            mSounds.erase(iter);
+        Instance& instance = mInstances[handle.sound];
+        instance.info.volume = volume;
+        if(instance.voice != sInvalidIndex)
+            mVoices[instance.voice].setVolume(volume);
     }
-}
\ No newline at end of file
+}
+
+
+void SoundPlayer::setPitch(SoundHandle handle, float pitch)
+{
+    assert(pitch > 0 && "Pitch must be greater than 0 in SoundPlayer::setPitch()");
+    if(isAlive(handle))
+    {
+        Instance& instance = mInstances[handle.sound];
+        instance.info.pitch = pitch;
+        if(instance.voice != sInvalidIndex)
+            mVoices[instance.voice].setPitch(pitch);
+    }
+}
+
+
+bool SoundPlayer::isPlaying(SoundHandle handle) const
+{
+    if(isAlive(handle) == false)
+        return false;
+    const Instance& instance = mInstances[handle.sound];
+    return instance.voice == sInvalidIndex || mVoices[instance.voice].getStatus() != sf::Sound::Stopped;
+}
+
+
+bool SoundPlayer::isVirtual(SoundHandle handle) const
+{
+    return isAlive(handle) && mInstances[handle.sound].voice == sInvalidIndex;
+}
+
+
+void SoundPlayer::update(sf::Time deltaTime)
+{
+    PROFILE_ZONE("SoundPlayer::update");
+    mTime += deltaTime;
+    sf::Vector3f listenerPosition = sf::Listener::getPosition();
+    //releaseInstance() moves the last active instance into the released slot, so that slot is visited again.
+    for(std::size_t i = 0; i < mActiveInstances.size();)
+    {
+        std::uint32_t index = mActiveInstances[i];
+        Instance& instance = mInstances[index];
+        if(instance.voice != sInvalidIndex)
+        {
+            if(mVoices[instance.voice].getStatus() == sf::Sound::Stopped)
+            {
+                releaseInstance(index);
+                continue;
+            }
+            if(computeAudibleVolume(instance.info, listenerPosition) < mAudibilityThreshold * sHysteresis)
+                makeVirtual(index);
+        }
+        else
+        {
+            sf::Time duration = instance.buffer->getDuration();
+            instance.playingOffset += deltaTime * instance.info.pitch;
+            if(instance.playingOffset >= duration)
+            {
+                if(instance.info.loop == false || duration == sf::Time::Zero)
+                {
+                    releaseInstance(index);
+                    continue;
+                }
+                instance.playingOffset = sf::microseconds(instance.playingOffset.asMicroseconds() % duration.asMicroseconds());
+            }
+        }
+        ++i;
+    }
+
+    //Started after the existing sounds have been advanced, so that they begin at offset zero.
+    flushQueuedSounds();
+
+    //The most important audible virtual sounds get the free voices first, louder ones first among equals.
+    mPromotionCandidates.clear();
+    for(std::uint32_t index : mActiveInstances)
+    {
+        const Instance& instance = mInstances[index];
+        float audibleVolume = computeAudibleVolume(instance.info, listenerPosition);
+        if(instance.voice == sInvalidIndex && audibleVolume >= mAudibilityThreshold)
+            mPromotionCandidates.push_back(PromotionCandidate{computeImportance(instance, listenerPosition), audibleVolume, index});
+    }
+    std::sort(mPromotionCandidates.begin(), mPromotionCandidates.end(), [](const PromotionCandidate& first, const PromotionCandidate& second)
+    {
+        if(first.importance != second.importance)
+            return first.importance > second.importance;
+        return first.audibleVolume > second.audibleVolume;
+    });
+    //Promotion only steals from strictly less important sounds, so two equal sounds cannot trade a voice back and forth.
+    for(auto& candidate : mPromotionCandidates)
+    {
+        if(makeReal(candidate.instance, listenerPosition, false) == false)
+            break;
+    }
+}
+
+
+void SoundPlayer::setStealPolicy(StealPolicy stealPolicy)
+{
+    mStealPolicy = stealPolicy;
+}
+
+
+void SoundPlayer::setAudibilityThreshold(float volume)
+{
+    assert(volume >= 0 && volume <= 100 && "Volume must be between 0-100 in SoundPlayer::setAudibilityThreshold()");
+    mAudibilityThreshold = volume;
+}
+
+
+void SoundPlayer::setCoalescingSettings(const CoalescingSettings& settings)
+{
+    assert(settings.volumeBoostPerMerge >= 0 && "volumeBoostPerMerge must be greater than or equal to 0 in SoundPlayer::setCoalescingSettings()");
+    mCoalescingSettings = settings;
+}
+
+
+const SoundPlayer::Statistics& SoundPlayer::getStatistics() const
+{
+    return mStatistics;
+}
+
+
+void SoundPlayer::resetStatistics()
+{
+    mStatistics = Statistics();
+}
+
+
+std::size_t SoundPlayer::getNumVoices() const
+{
+    return mVoices.size();
+}
+
+
+std::size_t SoundPlayer::getNumActiveVoices() const
+{
+    return mVoices.size() - mFreeVoices.size();
+}
+
+
+std::size_t SoundPlayer::getNumVirtualVoices() const
+{
+    return mActiveInstances.size() - getNumActiveVoices();
+}
+
+
+float SoundPlayer::computeAudibleVolume(const SoundInfo& soundInfo, const sf::Vector3f& listenerPosition)
+{
+    sf::Vector3f offset = soundInfo.relativeToListener ? soundInfo.position : soundInfo.position - listenerPosition;
+    float distance = std::sqrt(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+    distance = std::max(distance, soundInfo.minDistance);
+    return soundInfo.volume * soundInfo.minDistance / (soundInfo.minDistance + soundInfo.attenuation * (distance - soundInfo.minDistance));
+}
+
+
+bool SoundPlayer::isAlive(SoundHandle handle) const
+{
+    return handle.sound < mInstances.size() && mInstances[handle.sound].generation == handle.generation;
+}
+
+
+SoundPlayer::SoundHandle SoundPlayer::startSound(const sf::SoundBuffer& soundBuffer, const SoundInfo& soundInfo)
+{
+    BufferState& bufferState = mBufferStates[&soundBuffer];
+    if(bufferState.numInstances >= mCoalescingSettings.maxInstancesPerBuffer)
+    {
+        ++mStatistics.numDropped;
+        return InvalidHandle;
+    }
+
+    std::uint32_t index;
+    if(mFreeInstances.empty())
+    {
+        index = static_cast<std::uint32_t>(mInstances.size());
+        mInstances.emplace_back();
+    }
+    else
+    {
+        index = mFreeInstances.back();
+        mFreeInstances.pop_back();
+    }
+    Instance& instance = mInstances[index];
+    instance.buffer = &soundBuffer;
+    instance.bufferState = &bufferState;
+    instance.info = soundInfo;
+    instance.playingOffset = sf::Time::Zero;
+    instance.voice = sInvalidIndex;
+    instance.activeIndex = static_cast<std::uint32_t>(mActiveInstances.size());
+    instance.startOrder = mNumSoundsStarted++;
+    mActiveInstances.push_back(index);
+    ++bufferState.numInstances;
+    bufferState.lastPlay = SoundHandle{index, instance.generation};
+    bufferState.lastPlayTime = mTime;
+    ++mStatistics.numStarted;
+
+    //On a tie with a playing sound the new one wins, since it is the one the player just caused.
+    sf::Vector3f listenerPosition = sf::Listener::getPosition();
+    if(computeAudibleVolume(soundInfo, listenerPosition) >= mAudibilityThreshold)
+        makeReal(index, listenerPosition, true);
+    return bufferState.lastPlay;
+}
+
+
+void SoundPlayer::flushQueuedSounds()
+{
+    //Group the requests by buffer, keeping each group in request order.  Ties are broken by the request order
+    //rather than by std::stable_sort, which allocates a temporary buffer.
+    std::sort(mQueuedSounds.begin(), mQueuedSounds.end(), [](const QueuedSound& first, const QueuedSound& second)
+    {
+        if(first.buffer != second.buffer)
+            return std::less<const sf::SoundBuffer*>()(first.buffer, second.buffer);
+        return first.order < second.order;
+    });
+
+    sf::Vector3f listenerPosition = sf::Listener::getPosition();
+    for(std::size_t begin = 0, end = 0; begin < mQueuedSounds.size(); begin = end)
+    {
+        const sf::SoundBuffer& buffer = *mQueuedSounds[begin].buffer;
+        end = begin + 1;
+        while(end < mQueuedSounds.size() && mQueuedSounds[end].buffer == &buffer)
+            ++end;
+        std::size_t numRequests = end - begin;
+
+        //Requests soon after a play of the same buffer make that play louder instead of starting another.
+        BufferState& bufferState = mBufferStates[&buffer];
+        if(isAlive(bufferState.lastPlay) && mTime - bufferState.lastPlayTime <= mCoalescingSettings.mergeWindow)
+        {
+            Instance& instance = mInstances[bufferState.lastPlay.sound];
+            instance.info.volume = std::min(100.0f, instance.info.volume * (1.0f + mCoalescingSettings.volumeBoostPerMerge * numRequests));
+            if(instance.voice != sInvalidIndex)
+                mVoices[instance.voice].setVolume(instance.info.volume);
+            mStatistics.numMerged += numRequests;
+            continue;
+        }
+
+        //Otherwise the loudest request is played, boosted by the others and with the highest priority among them.
+        std::size_t loudest = begin;
+        int priority = mQueuedSounds[begin].info.priority;
+        for(std::size_t i = begin + 1; i < end; ++i)
+        {
+            if(computeAudibleVolume(mQueuedSounds[i].info, listenerPosition) > computeAudibleVolume(mQueuedSounds[loudest].info, listenerPosition))
+                loudest = i;
+            priority = std::max(priority, mQueuedSounds[i].info.priority);
+        }
+        SoundInfo soundInfo = mQueuedSounds[loudest].info;
+        soundInfo.volume = std::min(100.0f, soundInfo.volume * (1.0f + mCoalescingSettings.volumeBoostPerMerge * (numRequests - 1)));
+        soundInfo.priority = priority;
+        if(isAlive(startSound(buffer, soundInfo)))
+            mStatistics.numMerged += numRequests - 1;
+        else
+            mStatistics.numDropped += numRequests - 1;
+    }
+    mQueuedSounds.clear();
+}
+
+
+bool SoundPlayer::makeReal(std::uint32_t index, const sf::Vector3f& listenerPosition, bool winsTies)
+{
+    Instance& instance = mInstances[index];
+    if(mFreeVoices.empty())
+    {
+        //A finished sound gives up its voice first; otherwise the least important real sound is made virtual.
+        std::uint32_t victim = sInvalidIndex;
+        float victimImportance = 0.0f;
+        bool victimFinished = false;
+        for(std::uint32_t activeIndex : mActiveInstances)
+        {
+            const Instance& candidate = mInstances[activeIndex];
+            if(candidate.voice == sInvalidIndex)
+                continue;
+            if(mVoices[candidate.voice].getStatus() == sf::Sound::Stopped)
+            {
+                victim = activeIndex;
+                victimFinished = true;
+                break;
+            }
+            float importance = computeImportance(candidate, listenerPosition);
+            if(victim == sInvalidIndex || importance < victimImportance
+               || (importance == victimImportance && candidate.startOrder < mInstances[victim].startOrder))
+            {
+                victim = activeIndex;
+                victimImportance = importance;
+            }
+        }
+        if(victimFinished)
+        {
+            releaseInstance(victim);
+        }
+        else
+        {
+            float importance = computeImportance(instance, listenerPosition);
+            if(importance < victimImportance || (importance == victimImportance && winsTies == false))
+                return false;
+            makeVirtual(victim);
+        }
+    }
+
+    //Prefer a voice that last played the same buffer: sf::Sound::setBuffer() re-registers the sound with its
+    //buffer, which allocates.
+    std::uint32_t voiceIndex = popFreeVoice(*instance.bufferState);
+    PROFILE_LEVEL("Voices live", 1);
+    instance.voice = voiceIndex;
+    sf::Sound& sound = mVoices[voiceIndex];
+    if(sound.getBuffer() != instance.buffer)
+    {
+        sound.setBuffer(*instance.buffer);
+        mVoiceStates[voiceIndex].bufferState = instance.bufferState;
+    }
+    sound.setRelativeToListener(instance.info.relativeToListener);
+    sound.setPosition(instance.info.position);
+    sound.setVolume(instance.info.volume);
+    sound.setPitch(instance.info.pitch);
+    sound.setMinDistance(instance.info.minDistance);
+    sound.setAttenuation(instance.info.attenuation);
+    sound.setLoop(instance.info.loop);
+    sound.setPlayingOffset(instance.playingOffset);
+    sound.play();
+    return true;
+}
+
+
+void SoundPlayer::makeVirtual(std::uint32_t index)
+{
+    Instance& instance = mInstances[index];
+    sf::Sound& sound = mVoices[instance.voice];
+    instance.playingOffset = sound.getPlayingOffset();
+    sound.stop();
+    pushFreeVoice(instance.voice);
+    PROFILE_LEVEL("Voices live", -1);
+    instance.voice = sInvalidIndex;
+}
+
+
+void SoundPlayer::releaseInstance(std::uint32_t index)
+{
+    Instance& instance = mInstances[index];
+    if(instance.voice != sInvalidIndex)
+    {
+        mVoices[instance.voice].stop();
+        pushFreeVoice(instance.voice);
+        PROFILE_LEVEL("Voices live", -1);
+        instance.voice = sInvalidIndex;
+    }
+    --instance.bufferState->numInstances;
+    mActiveInstances[instance.activeIndex] = mActiveInstances.back();
+    mInstances[mActiveInstances[instance.activeIndex]].activeIndex = instance.activeIndex;
+    mActiveInstances.pop_back();
+    ++instance.generation;  //invalidates outstanding handles
+    mFreeInstances.push_back(index);
+}
+
+
+void SoundPlayer::pushFreeVoice(std::uint32_t voice)
+{
+    VoiceState& voiceState = mVoiceStates[voice];
+    voiceState.freeIndex = static_cast<std::uint32_t>(mFreeVoices.size());
+    mFreeVoices.push_back(voice);
+    if(voiceState.bufferState)
+    {
+        voiceState.previousFree = sInvalidIndex;
+        voiceState.nextFree = voiceState.bufferState->firstFreeVoice;
+        if(voiceState.nextFree != sInvalidIndex)
+            mVoiceStates[voiceState.nextFree].previousFree = voice;
+        voiceState.bufferState->firstFreeVoice = voice;
+    }
+}
+
+
+std::uint32_t SoundPlayer::popFreeVoice(const BufferState& bufferState)
+{
+    std::uint32_t voice = bufferState.firstFreeVoice != sInvalidIndex ? bufferState.firstFreeVoice : mFreeVoices.back();
+    VoiceState& voiceState = mVoiceStates[voice];
+    if(voiceState.bufferState)
+    {
+        if(voiceState.previousFree != sInvalidIndex)
+            mVoiceStates[voiceState.previousFree].nextFree = voiceState.nextFree;
+        else
+            voiceState.bufferState->firstFreeVoice = voiceState.nextFree;
+        if(voiceState.nextFree != sInvalidIndex)
+            mVoiceStates[voiceState.nextFree].previousFree = voiceState.previousFree;
+    }
+    mFreeVoices[voiceState.freeIndex] = mFreeVoices.back();
+    mVoiceStates[mFreeVoices.back()].freeIndex = voiceState.freeIndex;
+    mFreeVoices.pop_back();
+    voiceState.freeIndex = sInvalidIndex;
+    return voice;
+}
+
+
+float SoundPlayer::computeImportance(const Instance& instance, const sf::Vector3f& listenerPosition) const
+{
+    const SoundInfo& soundInfo = instance.info;
+    switch(mStealPolicy)
+    {
+        case StealPolicy::LowestPriority:
+            return static_cast<float>(soundInfo.priority);
+        case StealPolicy::Quietest:
+            return computeAudibleVolume(soundInfo, listenerPosition);
+        case StealPolicy::Farthest:
+        {
+            sf::Vector3f offset = soundInfo.relativeToListener ? soundInfo.position : soundInfo.position - listenerPosition;
+            return -(offset.x * offset.x + offset.y * offset.y + offset.z * offset.z);
+        }
+    }
+    return 0.0f;
+}
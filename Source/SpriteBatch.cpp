@@ -0,0 +1,177 @@
+#include "SpriteBatch.h"
+#include <cstdlib>
+
+
+const std::uint32_t SpriteBatch::sVerticesPerQuad;
+const std::uint32_t SpriteBatch::sInvalidBatch;
+
+
+SpriteBatch::SpriteBatch(const AnimationSystem& animationSystem)
+:mAnimationSystem(animationSystem),
+mNumQuadsRewritten(0)
+{
+}
+
+
+void SpriteBatch::addSprite(SpriteId id, const sf::Texture& texture, const sf::Transform& transform)
+{
+    assert(mAnimationSystem.contains(id) && mAnimationSystem.hasAnimation(id) && "SpriteBatch::addSprite() requires a sprite with an animation");
+    assert(!contains(id) && "SpriteBatch::addSprite() was given a sprite that is already batched");
+    if(hasQuad(id))
+        eraseQuad(id);
+    
+    std::uint32_t batchIndex = 0;
+    while(batchIndex < mBatches.size() && mBatches[batchIndex].texture != &texture)
+        ++batchIndex;
+    if(batchIndex == mBatches.size())
+        mBatches.push_back(Batch{&texture, {}, {}, {}});
+    Batch& batch = mBatches[batchIndex];
+    
+    if(mLocations.size() <= id)
+        mLocations.resize(id + 1, Location{sInvalidBatch, 0, 0});
+    mLocations[id] = Location{batchIndex, static_cast<std::uint32_t>(batch.spriteIds.size()), mAnimationSystem.getGeneration(id)};
+    batch.spriteIds.push_back(id);
+    batch.transforms.push_back(transform);
+    batch.vertices.resize(batch.vertices.size() + sVerticesPerQuad);
+    mTransformedSprites.push_back(id);
+}
+
+
+void SpriteBatch::removeSprite(SpriteId id)
+{
+    assert(hasQuad(id) && "SpriteBatch::removeSprite() was given a sprite that is not batched");
+    eraseQuad(id);
+}
+
+
+bool SpriteBatch::contains(SpriteId id) const
+{
+    return hasQuad(id) && !isStale(id);
+}
+
+
+void SpriteBatch::setTransform(SpriteId id, const sf::Transform& transform)
+{
+    assert(contains(id) && "SpriteBatch::setTransform() was given a sprite that is not batched");
+    mBatches[mLocations[id].batch].transforms[mLocations[id].quad] = transform;
+    mTransformedSprites.push_back(id);
+}
+
+
+void SpriteBatch::update()
+{
+    //Both lists may hold duplicates or sprites removed since; rewriting a quad twice is harmless.  The
+    //AnimationSystem reports removed sprites as changed, which is when their quads are dropped.
+    mNumQuadsRewritten = 0;
+    for(SpriteId id : mAnimationSystem.getChangedSprites())
+        refreshQuad(id);
+    for(SpriteId id : mTransformedSprites)
+        refreshQuad(id);
+    mTransformedSprites.clear();
+}
+
+
+bool SpriteBatch::hasQuad(SpriteId id) const
+{
+    return id < mLocations.size() && mLocations[id].batch != sInvalidBatch;
+}
+
+
+bool SpriteBatch::isStale(SpriteId id) const
+{
+    return !mAnimationSystem.contains(id) || mAnimationSystem.getGeneration(id) != mLocations[id].generation;
+}
+
+
+void SpriteBatch::refreshQuad(SpriteId id)
+{
+    if(!hasQuad(id))
+        return;
+    if(isStale(id))
+    {
+        eraseQuad(id);
+        return;
+    }
+    writeQuad(mBatches[mLocations[id].batch], mLocations[id].quad);
+    ++mNumQuadsRewritten;
+}
+
+
+void SpriteBatch::eraseQuad(SpriteId id)
+{
+    Location location = mLocations[id];
+    Batch& batch = mBatches[location.batch];
+    std::uint32_t last = static_cast<std::uint32_t>(batch.spriteIds.size() - 1);
+    if(location.quad != last)
+    {
+        batch.spriteIds[location.quad] = batch.spriteIds[last];
+        batch.transforms[location.quad] = batch.transforms[last];
+        for(std::uint32_t vertex = 0; vertex < sVerticesPerQuad; ++vertex)
+            batch.vertices[location.quad * sVerticesPerQuad + vertex] = batch.vertices[last * sVerticesPerQuad + vertex];
+        mLocations[batch.spriteIds[location.quad]].quad = location.quad;
+    }
+    batch.spriteIds.pop_back();
+    batch.transforms.pop_back();
+    batch.vertices.resize(batch.vertices.size() - sVerticesPerQuad);
+    mLocations[id].batch = sInvalidBatch;
+}
+
+
+std::size_t SpriteBatch::getNumBatches() const
+{
+    return mBatches.size();
+}
+
+
+const sf::Texture& SpriteBatch::getTexture(std::size_t batchIndex) const
+{
+    assert(batchIndex < mBatches.size() && "batchIndex is out of bounds in SpriteBatch::getTexture()");
+    return *mBatches[batchIndex].texture;
+}
+
+
+const std::vector<sf::Vertex>& SpriteBatch::getVertices(std::size_t batchIndex) const
+{
+    assert(batchIndex < mBatches.size() && "batchIndex is out of bounds in SpriteBatch::getVertices()");
+    return mBatches[batchIndex].vertices;
+}
+
+
+std::size_t SpriteBatch::getNumQuadsRewritten() const
+{
+    return mNumQuadsRewritten;
+}
+
+
+void SpriteBatch::draw(sf::RenderTarget& target, sf::RenderStates states) const
+{
+    for(auto& batch : mBatches)
+    {
+        if(batch.vertices.empty())
+            continue;
+        states.texture = batch.texture;
+        target.draw(batch.vertices.data(), batch.vertices.size(), sf::Triangles, states);
+    }
+}
+
+
+//Same geometry as sf::Sprite: the quad is the size of the texture rect, and negative rect sizes flip the texture.
+void SpriteBatch::writeQuad(Batch& batch, std::uint32_t quad)
+{
+    const sf::IntRect& rect = mAnimationSystem.getTextureRect(batch.spriteIds[quad]);
+    const sf::Transform& transform = batch.transforms[quad];
+    float width = static_cast<float>(std::abs(rect.width));
+    float height = static_cast<float>(std::abs(rect.height));
+    float left = static_cast<float>(rect.left);
+    float right = left + rect.width;
+    float top = static_cast<float>(rect.top);
+    float bottom = top + rect.height;
+    
+    sf::Vertex* vertices = &batch.vertices[quad * sVerticesPerQuad];
+    vertices[0] = sf::Vertex(transform.transformPoint(0.0f, 0.0f), sf::Vector2f(left, top));
+    vertices[1] = sf::Vertex(transform.transformPoint(width, 0.0f), sf::Vector2f(right, top));
+    vertices[2] = sf::Vertex(transform.transformPoint(0.0f, height), sf::Vector2f(left, bottom));
+    vertices[3] = vertices[2];
+    vertices[4] = vertices[1];
+    vertices[5] = sf::Vertex(transform.transformPoint(width, height), sf::Vector2f(right, bottom));
+}
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+
+
+
+ThreadPool::ThreadPool(unsigned numThreads)
+:mStopping(false)
+{
+    if(numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    for(unsigned i = 0; i < numThreads; ++i)
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mTaskAvailable.notify_all();
+    for(auto& worker : mWorkers)
+        worker.join();
+}
+
+
+unsigned ThreadPool::getNumThreads() const
+{
+    return static_cast<unsigned>(mWorkers.size());
+}
+
+
+void ThreadPool::runJob(std::size_t count, std::size_t numChunks, ChunkFunction function, const void* body)
+{
+    assert(numChunks > 0 && "ThreadPool::parallelFor() requires at least one chunk");
+    
+    std::lock_guard<std::mutex> jobLock(mJobMutex);
+    std::size_t numSlots = std::min<std::size_t>(mWorkers.size(), numChunks - 1);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJob.function = function;
+        mJob.body = body;
+        mJob.count = count;
+        mJob.numChunks = numChunks;
+        mJob.nextChunk = 0;
+        mJob.numOpenSlots = numSlots;
+    }
+    if(numSlots > 0)
+        mTaskAvailable.notify_all();
+    runChunks();
+    
+    //Every chunk has been claimed by now, so the job is done once the helpers running the last ones leave.
+    //Workers that only wake up now must not join, since the job is about to be reused.
+    std::unique_lock<std::mutex> lock(mMutex);
+    mJob.numOpenSlots = 0;
+    mHelpersLeft.wait(lock, [this](){ return mJob.numHelpers == 0; });
+}
+
+
+void ThreadPool::runChunks()
+{
+    for(std::size_t chunk = mJob.nextChunk++; chunk < mJob.numChunks; chunk = mJob.nextChunk++)
+        mJob.function(mJob.body, chunk, mJob.count * chunk / mJob.numChunks, mJob.count * (chunk + 1) / mJob.numChunks);
+}
+
+
+void ThreadPool::workerLoop()
+{
+    for(;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTaskAvailable.wait(lock, [this](){ return mStopping || !mTasks.empty() || mJob.numOpenSlots > 0; });
+            //Helping with a parallelFor() comes first, since its caller is blocked on it.
+            if(mJob.numOpenSlots > 0)
+            {
+                --mJob.numOpenSlots;
+                ++mJob.numHelpers;
+                lock.unlock();
+                runChunks();
+                lock.lock();
+                if(--mJob.numHelpers == 0)
+                    mHelpersLeft.notify_one();
+                continue;
+            }
+            if(mTasks.empty())
+                return;
+            task = std::move(mTasks.front());
+            mTasks.pop();
+        }
+        task();
+    }
+}
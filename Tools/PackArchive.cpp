@@ -0,0 +1,191 @@
+#include "AssetArchive.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Offline archive packer.  Reads a manifest listing asset files and writes them into
+one AssetArchive, which ResourceHolder::loadFromArchive() loads from by entry name.
+
+Each manifest line is "file [stored|lz]", with files relative to the input directory;
+the file's path as written becomes its entry name.  Entries are stored uncompressed
+unless the line or --compress asks for lz.  Already compressed formats such as PNG
+and OGG gain nothing from lz, and fonts must stay uncompressed since sf::Font reads
+its data for as long as it exists.  Blank lines and lines starting with # are
+ignored.  Files are read on a ThreadPool.
+----------------------------------------------------------------------------------*/
+namespace
+{
+    struct Options
+    {
+        std::string inputDirectory;
+        std::string manifestFilename;
+        std::string outputFilename;
+        bool compress = false;
+        unsigned numThreads = 0;
+    };
+
+    struct ManifestLine
+    {
+        std::string file;
+        bool hasCompression;
+        AssetArchive::Compression compression;
+    };
+
+
+    void printUsage()
+    {
+        std::printf("usage: PackArchive <inputDirectory> <manifest> <output> [--compress] [--threads N]\n");
+    }
+
+
+    bool parseArguments(int argc, char* argv[], Options& options)
+    {
+        std::vector<std::string> positional;
+        for(int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            if(argument == "--compress")
+                options.compress = true;
+            else if(argument == "--threads")
+            {
+                if(++i >= argc)
+                    return false;
+                options.numThreads = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 10));
+            }
+            else if(argument.compare(0, 2, "--") == 0)
+                return false;
+            else
+                positional.push_back(argument);
+        }
+        if(positional.size() != 3)
+            return false;
+        options.inputDirectory = positional[0];
+        options.manifestFilename = positional[1];
+        options.outputFilename = positional[2];
+        return true;
+    }
+
+
+    bool readManifest(const std::string& filename, std::vector<ManifestLine>& lines)
+    {
+        std::ifstream manifest(filename);
+        if(!manifest)
+        {
+            std::printf("Failed to open manifest %s\n", filename.c_str());
+            return false;
+        }
+
+        std::set<std::string> files;
+        std::string line;
+        for(int lineNumber = 1; std::getline(manifest, line); ++lineNumber)
+        {
+            std::istringstream fields(line);
+            std::string file;
+            if(!(fields >> file) || file[0] == '#')
+                continue;
+
+            ManifestLine entry{file, false, AssetArchive::Stored};
+            std::string compression;
+            if(fields >> compression)
+            {
+                entry.hasCompression = true;
+                if(compression == "lz")
+                    entry.compression = AssetArchive::Lz;
+                else if(compression != "stored")
+                {
+                    std::printf("%s:%d: expected \"file [stored|lz]\"\n", filename.c_str(), lineNumber);
+                    return false;
+                }
+            }
+            if(files.insert(file).second == false)
+            {
+                std::printf("%s:%d: %s is listed twice\n", filename.c_str(), lineNumber, file.c_str());
+                return false;
+            }
+            lines.push_back(entry);
+        }
+        return true;
+    }
+
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(parseArguments(argc, argv, options) == false)
+    {
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool threadPool(options.numThreads);
+
+    std::vector<ManifestLine> lines;
+    if(readManifest(options.manifestFilename, lines) == false)
+        return 1;
+
+    std::vector<AssetArchive::SourceEntry> entries(lines.size());
+    std::vector<char> loaded(lines.size(), 0);
+    threadPool.parallelFor(lines.size(), lines.size(), [&](std::size_t, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            std::ifstream file(options.inputDirectory + "/" + lines[i].file, std::ios::binary);
+            if(!file)
+                continue;
+            entries[i].name = lines[i].file;
+            entries[i].data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            entries[i].compression = lines[i].hasCompression ? lines[i].compression : (options.compress ? AssetArchive::Lz : AssetArchive::Stored);
+            loaded[i] = true;
+        }
+    });
+    bool allLoaded = true;
+    std::size_t inputBytes = 0;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+    {
+        if(loaded[i] == false)
+        {
+            std::printf("Failed to read %s\n", lines[i].file.c_str());
+            allLoaded = false;
+        }
+        inputBytes += entries[i].data.size();
+    }
+    if(allLoaded == false)
+        return 1;
+
+    if(AssetArchive::write(options.outputFilename, entries) == false)
+    {
+        std::printf("Failed to write %s\n", options.outputFilename.c_str());
+        return 1;
+    }
+    AssetArchive archive;
+    if(archive.open(options.outputFilename) == false)
+    {
+        std::printf("Failed to reopen %s\n", options.outputFilename.c_str());
+        return 1;
+    }
+    std::size_t numCompressed = 0;
+    for(std::size_t entry = 0; entry < archive.getNumEntries(); ++entry)
+        numCompressed += archive.getCompression(entry) == AssetArchive::Lz;
+    std::ifstream output(options.outputFilename, std::ios::binary | std::ios::ate);
+
+    std::printf("Packed %zu files (%zu bytes) into %s (%lld bytes), %zu compressed, using %u thread(s)\n", entries.size(), inputBytes,
+                options.outputFilename.c_str(), static_cast<long long>(output.tellg()), numCompressed, threadPool.getNumThreads() + 1);
+    std::printf("Finished in %.3f s\n", secondsSince(start));
+    return 0;
+}
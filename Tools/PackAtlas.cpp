@@ -0,0 +1,297 @@
+#include "AnimationTable.h"
+#include "AtlasPacker.h"
+#include "ThreadPool.h"
+#include <SFML/Graphics/Image.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+/*----------------------------------------------------------------------------------
+Offline atlas packer.  Reads a manifest listing the frames of every animation, packs
+the frame images into as few atlas pages as possible with one page per object, and
+writes the pages as <output>_<page>.png next to <output>.anim, an AnimationTable
+holding the frame rects, frame durations and the page of each object.  The table is
+loaded with AnimationTable::loadFromFile() and page N with sf::Texture::loadFromFile().
+
+Each manifest line is "objectId animationId imageFile [durationMilliseconds]", with
+image files relative to the input directory.  Lines of the same animation list its
+frames in order; a frame may be listed several times and is packed once per object.
+Blank lines and lines starting with # are ignored.  Either all frames of an animation
+have a duration or none do.  Loading, compositing and saving run on a ThreadPool.
+----------------------------------------------------------------------------------*/
+namespace
+{
+    struct Options
+    {
+        std::string inputDirectory;
+        std::string manifestFilename;
+        std::string outputPrefix;
+        unsigned pageSize = 2048;
+        unsigned padding = 1;
+        unsigned numThreads = 0;
+    };
+
+    struct Frame
+    {
+        std::size_t image;  //index into the unique image list
+        int durationMilliseconds;  //negative when the manifest gave none
+    };
+
+    using Animation = std::vector<Frame>;
+    using Object = std::vector<Animation>;
+
+
+    void printUsage()
+    {
+        std::printf("usage: PackAtlas <inputDirectory> <manifest> <outputPrefix> [--page-size N] [--padding N] [--threads N]\n");
+    }
+
+
+    bool parseArguments(int argc, char* argv[], Options& options)
+    {
+        std::vector<std::string> positional;
+        for(int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            unsigned* value = nullptr;
+            if(argument == "--page-size")
+                value = &options.pageSize;
+            else if(argument == "--padding")
+                value = &options.padding;
+            else if(argument == "--threads")
+                value = &options.numThreads;
+            else if(argument.compare(0, 2, "--") == 0)
+                return false;
+
+            if(value == nullptr)
+                positional.push_back(argument);
+            else if(++i < argc)
+                *value = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 10));
+            else
+                return false;
+        }
+        if(positional.size() != 3 || options.pageSize == 0)
+            return false;
+        options.inputDirectory = positional[0];
+        options.manifestFilename = positional[1];
+        options.outputPrefix = positional[2];
+        return true;
+    }
+
+
+    bool readManifest(const std::string& filename, std::vector<Object>& objects, std::vector<std::string>& imageFiles)
+    {
+        std::ifstream manifest(filename);
+        if(!manifest)
+        {
+            std::printf("Failed to open manifest %s\n", filename.c_str());
+            return false;
+        }
+
+        std::map<std::string, std::size_t> imageIndices;
+        std::string line;
+        for(int lineNumber = 1; std::getline(manifest, line); ++lineNumber)
+        {
+            std::istringstream fields(line);
+            std::string first;
+            if(!(fields >> first) || first[0] == '#')
+                continue;
+
+            std::size_t objectId = 0;
+            std::size_t animationId = 0;
+            std::string imageFile;
+            int durationMilliseconds = -1;
+            std::istringstream objectField(first);
+            if(!(objectField >> objectId) || !(fields >> animationId >> imageFile))
+            {
+                std::printf("%s:%d: expected \"objectId animationId imageFile [durationMilliseconds]\"\n", filename.c_str(), lineNumber);
+                return false;
+            }
+            if(!(fields >> durationMilliseconds))
+                durationMilliseconds = -1;
+            else if(durationMilliseconds <= 0)
+            {
+                std::printf("%s:%d: frame durations must be positive\n", filename.c_str(), lineNumber);
+                return false;
+            }
+
+            auto inserted = imageIndices.insert(std::make_pair(imageFile, imageFiles.size()));
+            if(inserted.second)
+                imageFiles.push_back(imageFile);
+            if(objectId >= objects.size())
+                objects.resize(objectId + 1);
+            if(animationId >= objects[objectId].size())
+                objects[objectId].resize(animationId + 1);
+            Animation& animation = objects[objectId][animationId];
+            if(animation.empty() == false && (animation.back().durationMilliseconds < 0) != (durationMilliseconds < 0))
+            {
+                std::printf("%s:%d: either all frames of an animation have a duration or none do\n", filename.c_str(), lineNumber);
+                return false;
+            }
+            animation.push_back(Frame{inserted.first->second, durationMilliseconds});
+        }
+        return true;
+    }
+
+
+    double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if(parseArguments(argc, argv, options) == false)
+    {
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool threadPool(options.numThreads);
+
+    std::vector<Object> objects;
+    std::vector<std::string> imageFiles;
+    if(readManifest(options.manifestFilename, objects, imageFiles) == false)
+        return 1;
+    if(imageFiles.empty())
+    {
+        std::printf("%s lists no frames\n", options.manifestFilename.c_str());
+        return 1;
+    }
+
+    //Decoding dominates for large asset sets, so each image is its own chunk.
+    std::vector<sf::Image> images(imageFiles.size());
+    std::vector<char> loaded(imageFiles.size(), 0);
+    threadPool.parallelFor(images.size(), images.size(), [&](std::size_t, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+            loaded[i] = images[i].loadFromFile(options.inputDirectory + "/" + imageFiles[i]);
+    });
+    bool allLoaded = true;
+    for(std::size_t i = 0; i < images.size(); ++i)
+    {
+        if(loaded[i] == false)
+        {
+            std::printf("Failed to load %s\n", imageFiles[i].c_str());
+            allLoaded = false;
+        }
+    }
+    if(allLoaded == false)
+        return 1;
+    double loadSeconds = secondsSince(start);
+
+    //Objects with the most pixels are packed first, while the pages are still empty.
+    std::vector<std::vector<std::size_t>> objectImages(objects.size());
+    std::vector<std::uint64_t> objectAreas(objects.size(), 0);
+    for(std::size_t object = 0; object < objects.size(); ++object)
+    {
+        for(auto& animation : objects[object])
+        {
+            for(auto& frame : animation)
+                objectImages[object].push_back(frame.image);
+        }
+        auto& uniqueImages = objectImages[object];
+        std::sort(uniqueImages.begin(), uniqueImages.end());
+        uniqueImages.erase(std::unique(uniqueImages.begin(), uniqueImages.end()), uniqueImages.end());
+        for(std::size_t image : uniqueImages)
+            objectAreas[object] += std::uint64_t(images[image].getSize().x) * images[image].getSize().y;
+    }
+    std::vector<std::size_t> packingOrder(objects.size());
+    for(std::size_t i = 0; i < packingOrder.size(); ++i)
+        packingOrder[i] = i;
+    std::stable_sort(packingOrder.begin(), packingOrder.end(), [&objectAreas](std::size_t first, std::size_t second)
+    {
+        return objectAreas[first] > objectAreas[second];
+    });
+
+    AtlasPacker packer(sf::Vector2u(options.pageSize, options.pageSize), options.padding);
+    std::vector<std::uint32_t> texturePages(objects.size(), 0);
+    std::vector<std::map<std::size_t, sf::IntRect>> objectRects(objects.size());  //image index to packed rect
+    for(std::size_t object : packingOrder)
+    {
+        if(objectImages[object].empty())
+            continue;
+        std::vector<sf::Vector2u> sizes;
+        for(std::size_t image : objectImages[object])
+            sizes.push_back(images[image].getSize());
+        std::vector<AtlasPacker::Placement> placements;
+        if(packer.packGroup(sizes, placements) == false)
+        {
+            std::printf("The frames of object %zu do not fit on one %ux%u page\n", object, options.pageSize, options.pageSize);
+            return 1;
+        }
+        texturePages[object] = placements.front().page;
+        for(std::size_t i = 0; i < placements.size(); ++i)
+            objectRects[object][objectImages[object][i]] = placements[i].rect;
+    }
+
+    //Each page is composited and encoded independently.
+    std::vector<char> saved(packer.getNumPages(), 0);
+    threadPool.parallelFor(packer.getNumPages(), packer.getNumPages(), [&](std::size_t, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t page = begin; page < end; ++page)
+        {
+            sf::Image atlas;
+            atlas.create(packer.getUsedSize(page).x, packer.getUsedSize(page).y, sf::Color::Transparent);
+            for(std::size_t object = 0; object < objects.size(); ++object)
+            {
+                if(texturePages[object] != page)
+                    continue;
+                for(auto& imageRect : objectRects[object])
+                    atlas.copy(images[imageRect.first], unsigned(imageRect.second.left), unsigned(imageRect.second.top));
+            }
+            saved[page] = atlas.saveToFile(options.outputPrefix + "_" + std::to_string(page) + ".png");
+        }
+    });
+    for(std::size_t page = 0; page < saved.size(); ++page)
+    {
+        if(saved[page] == false)
+        {
+            std::printf("Failed to write %s_%zu.png\n", options.outputPrefix.c_str(), page);
+            return 1;
+        }
+    }
+
+    AnimationTable::NestedAnimations animations(objects.size());
+    AnimationTable::NestedFrameDurations frameDurations(objects.size());
+    std::size_t numFrames = 0;
+    for(std::size_t object = 0; object < objects.size(); ++object)
+    {
+        animations[object].resize(objects[object].size());
+        frameDurations[object].resize(objects[object].size());
+        for(std::size_t animation = 0; animation < objects[object].size(); ++animation)
+        {
+            for(auto& frame : objects[object][animation])
+            {
+                animations[object][animation].push_back(objectRects[object][frame.image]);
+                if(frame.durationMilliseconds > 0)
+                    frameDurations[object][animation].push_back(sf::milliseconds(frame.durationMilliseconds));
+            }
+            numFrames += objects[object][animation].size();
+        }
+    }
+    AnimationTable table;
+    table.build(animations, frameDurations, texturePages);
+    if(table.saveToFile(options.outputPrefix + ".anim") == false)
+    {
+        std::printf("Failed to write %s.anim\n", options.outputPrefix.c_str());
+        return 1;
+    }
+
+    std::printf("Packed %zu frames from %zu images into %zu page(s) using %u thread(s)\n", numFrames, images.size(), packer.getNumPages(), threadPool.getNumThreads() + 1);
+    for(std::size_t page = 0; page < packer.getNumPages(); ++page)
+        std::printf("  page %zu: %ux%u\n", page, packer.getUsedSize(page).x, packer.getUsedSize(page).y);
+    std::printf("Packing efficiency: %.1f%% of page area holds frame pixels\n", 100.0 * packer.getEfficiency());
+    std::printf("Loaded in %.3f s, finished in %.3f s\n", loadSeconds, secondsSince(start));
+    return 0;
+}